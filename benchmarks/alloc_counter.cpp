@@ -0,0 +1,53 @@
+#include "bench_harness.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// 替换全局operator new/delete，统计基准测试期间的内存分配
+// 可执行文件中的定义同样会替换库内部（包括共享库）的分配
+
+static std::atomic<uint64_t> g_alloc_count{0};
+static std::atomic<uint64_t> g_alloc_bytes{0};
+
+namespace bench {
+
+AllocStats allocStats() {
+    return AllocStats{g_alloc_count.load(std::memory_order_relaxed),
+                      g_alloc_bytes.load(std::memory_order_relaxed)};
+}
+
+} // namespace bench
+
+static void* countedAlloc(std::size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    return ptr;
+}
+
+void* operator new(std::size_t size) {
+    void* ptr = countedAlloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = countedAlloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
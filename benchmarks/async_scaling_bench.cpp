@@ -0,0 +1,90 @@
+#include "dns_parser.h"
+#include "bench_responder.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+// 异步解析器扩展性基准测试：不同工作线程数下对本地应答器的查询吞吐
+// 用法: async_scaling_bench [最大线程数] [每轮时长ms] [每线程在途查询数]
+
+struct BenchState {
+    zjpdns::AsyncDnsResolver* resolver;
+    std::chrono::steady_clock::time_point end;
+    std::atomic<uint64_t> next_name{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> outstanding{0};
+};
+
+static void issue(BenchState* state) {
+    if (std::chrono::steady_clock::now() >= state->end) {
+        --state->outstanding;
+        return;
+    }
+
+    std::string domain = "bench" + std::to_string(state->next_name++) + ".test";
+    state->resolver->resolveWithCallback(domain,
+        [state](const zjpdns::DnsResult& result) {
+            if (result.success) {
+                ++state->completed;
+            } else {
+                ++state->failed;
+            }
+            issue(state);
+        },
+        zjpdns::DnsRecordType::A, zjpdns::ResolveMethod::DNS_PACKET);
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                  : std::max(1u, std::thread::hardware_concurrency());
+    int duration_ms = argc > 2 ? std::atoi(argv[2]) : 1000;
+    size_t inflight = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+
+    BenchResponder responder(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::cout << "=== async resolver scaling (local responder, cache off) ===" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "qps"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+              << std::setw(10) << "failed" << std::endl;
+
+    double baseline = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        auto resolver = zjpdns::createAsyncDnsResolver(threads);
+        resolver->setDnsServer("127.0.0.1", responder.port());
+        resolver->setTimeout(2000);
+        resolver->setCacheSize(0);
+
+        BenchState state;
+        state.resolver = resolver.get();
+        auto start = std::chrono::steady_clock::now();
+        state.end = start + std::chrono::milliseconds(duration_ms);
+
+        size_t total_inflight = inflight * threads;
+        state.outstanding = total_inflight;
+        for (size_t i = 0; i < total_inflight; ++i) {
+            issue(&state);
+        }
+        while (state.outstanding > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double qps = state.completed / seconds;
+        if (threads == 1) {
+            baseline = qps;
+        }
+
+        std::cout << std::setw(8) << threads
+                  << std::setw(14) << std::fixed << std::setprecision(0) << qps
+                  << std::setw(9) << std::setprecision(2) << qps / baseline << "x"
+                  << std::setw(11) << std::setprecision(0) << 100.0 * qps / baseline / threads << "%"
+                  << std::setw(10) << state.failed.load() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 基准测试用的DNS响应语料
+// 按公共递归解析器的实际应答结构构造（记录名和域名均使用标准的压缩指针编码）
+namespace bench {
+
+// 响应数据包写入器，域名按RFC 1035后缀压缩
+class ResponseWriter {
+public:
+    enum Section { ANSWER = 6, AUTHORITY = 8, ADDITIONAL = 10 };
+
+    explicit ResponseWriter(uint16_t id, uint16_t flags = 0x8180) : data_(12, 0) {
+        put16(0, id);
+        put16(2, flags);
+    }
+
+    void question(const std::string& name, uint16_t type) {
+        writeName(name);
+        append16(type);
+        append16(1);
+        put16(4, get16(4) + 1);
+    }
+
+    // 写入RDATA为原始字节的记录
+    void record(Section section, const std::string& name, uint16_t type, uint32_t ttl,
+                const std::vector<uint8_t>& rdata) {
+        writeHeader(section, name, type, ttl);
+        append16(static_cast<uint16_t>(rdata.size()));
+        data_.insert(data_.end(), rdata.begin(), rdata.end());
+    }
+
+    // 写入A记录
+    void a(Section section, const std::string& name, uint32_t ttl,
+           uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3) {
+        record(section, name, 1, ttl, {a0, a1, a2, a3});
+    }
+
+    // 写入RDATA为域名的记录（CNAME/NS/PTR），可选的前缀字节用于MX优先级等
+    void nameRecord(Section section, const std::string& name, uint16_t type, uint32_t ttl,
+                    const std::string& target, const std::vector<uint8_t>& prefix = {}) {
+        writeHeader(section, name, type, ttl);
+        size_t length_offset = data_.size();
+        append16(0);
+        data_.insert(data_.end(), prefix.begin(), prefix.end());
+        writeName(target);
+        put16(length_offset, static_cast<uint16_t>(data_.size() - length_offset - 2));
+    }
+
+    const std::vector<uint8_t>& data() const { return data_; }
+
+private:
+    std::vector<uint8_t> data_;
+    std::unordered_map<std::string, uint16_t> names_;  // 已写入的域名后缀及其偏移
+
+    uint16_t get16(size_t offset) const {
+        return static_cast<uint16_t>((data_[offset] << 8) | data_[offset + 1]);
+    }
+
+    void put16(size_t offset, uint16_t value) {
+        data_[offset] = static_cast<uint8_t>(value >> 8);
+        data_[offset + 1] = static_cast<uint8_t>(value & 0xFF);
+    }
+
+    void append16(uint16_t value) {
+        data_.push_back(static_cast<uint8_t>(value >> 8));
+        data_.push_back(static_cast<uint8_t>(value & 0xFF));
+    }
+
+    void writeHeader(Section section, const std::string& name, uint16_t type, uint32_t ttl) {
+        writeName(name);
+        append16(type);
+        append16(1);
+        append16(static_cast<uint16_t>(ttl >> 16));
+        append16(static_cast<uint16_t>(ttl & 0xFFFF));
+        put16(section, get16(section) + 1);
+    }
+
+    void writeName(const std::string& name) {
+        std::string rest = name;
+        while (!rest.empty()) {
+            auto it = names_.find(rest);
+            if (it != names_.end()) {
+                append16(static_cast<uint16_t>(0xC000 | it->second));
+                return;
+            }
+            if (data_.size() < 0x3FFF) {
+                names_.emplace(rest, static_cast<uint16_t>(data_.size()));
+            }
+
+            size_t dot = rest.find('.');
+            std::string label = rest.substr(0, dot);
+            data_.push_back(static_cast<uint8_t>(label.size()));
+            data_.insert(data_.end(), label.begin(), label.end());
+            rest = dot == std::string::npos ? std::string() : rest.substr(dot + 1);
+        }
+        data_.push_back(0);
+    }
+};
+
+struct CorpusEntry {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// 语料：小型A应答、多地址应答、CNAME链、大量压缩指针
+inline std::vector<CorpusEntry> responseCorpus() {
+    std::vector<CorpusEntry> corpus;
+
+    {
+        ResponseWriter writer(0x1a2b);
+        writer.question("example.com", 1);
+        writer.a(ResponseWriter::ANSWER, "example.com", 3600, 93, 184, 216, 34);
+        corpus.push_back({"small_a", writer.data()});
+    }
+
+    {
+        ResponseWriter writer(0x3c4d);
+        writer.question("static.cdn-provider.net", 1);
+        for (uint8_t i = 0; i < 24; ++i) {
+            writer.a(ResponseWriter::ANSWER, "static.cdn-provider.net", 60, 151, 101, i, 133);
+        }
+        corpus.push_back({"multi_answer", writer.data()});
+    }
+
+    {
+        ResponseWriter writer(0x5e6f);
+        writer.question("www.microsoft.com", 1);
+        writer.nameRecord(ResponseWriter::ANSWER, "www.microsoft.com", 5, 3600,
+                          "www.microsoft.com-c-3.edgekey.net");
+        writer.nameRecord(ResponseWriter::ANSWER, "www.microsoft.com-c-3.edgekey.net", 5, 900,
+                          "www.microsoft.com-c-3.edgekey.net.globalredir.akadns.net");
+        writer.nameRecord(ResponseWriter::ANSWER, "www.microsoft.com-c-3.edgekey.net.globalredir.akadns.net",
+                          5, 900, "e13678.dscb.akamaiedge.net");
+        writer.a(ResponseWriter::ANSWER, "e13678.dscb.akamaiedge.net", 20, 23, 53, 41, 112);
+        writer.a(ResponseWriter::ANSWER, "e13678.dscb.akamaiedge.net", 20, 23, 53, 41, 118);
+        corpus.push_back({"cname_chain", writer.data()});
+    }
+
+    {
+        ResponseWriter writer(0x7a8b);
+        writer.question("corp.example.org", 15);
+        for (uint8_t i = 1; i <= 6; ++i) {
+            writer.nameRecord(ResponseWriter::ANSWER, "corp.example.org", 15, 300,
+                              "mx" + std::to_string(i) + ".mail.corp.example.org",
+                              {0, static_cast<uint8_t>(i * 10)});
+        }
+        for (uint8_t i = 1; i <= 4; ++i) {
+            writer.nameRecord(ResponseWriter::AUTHORITY, "corp.example.org", 2, 86400,
+                              "ns" + std::to_string(i) + ".corp.example.org");
+        }
+        for (uint8_t i = 1; i <= 6; ++i) {
+            writer.a(ResponseWriter::ADDITIONAL, "mx" + std::to_string(i) + ".mail.corp.example.org",
+                     300, 198, 51, 100, i);
+        }
+        for (uint8_t i = 1; i <= 4; ++i) {
+            writer.a(ResponseWriter::ADDITIONAL, "ns" + std::to_string(i) + ".corp.example.org",
+                     86400, 203, 0, 113, i);
+        }
+        corpus.push_back({"heavy_compression", writer.data()});
+    }
+
+    return corpus;
+}
+
+} // namespace bench
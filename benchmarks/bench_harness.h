@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// 微基准测试工具：自动确定迭代次数，统计每次操作的耗时、内存分配次数和分配字节数
+namespace bench {
+
+// 全局operator new的累计统计（由alloc_counter.cpp提供）
+struct AllocStats {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+AllocStats allocStats();
+
+// 阻止编译器优化掉基准测试中的计算结果
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+inline void printHeader() {
+    std::cout << std::left << std::setw(44) << "benchmark" << std::right
+              << std::setw(12) << "iterations" << std::setw(12) << "ns/op"
+              << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::endl;
+}
+
+inline void printResult(const Result& result) {
+    std::cout << std::left << std::setw(44) << result.name << std::right
+              << std::setw(12) << result.iterations
+              << std::setw(12) << std::fixed << std::setprecision(1) << result.ns_per_op
+              << std::setw(12) << std::setprecision(2) << result.allocs_per_op
+              << std::setw(12) << std::setprecision(1) << result.bytes_per_op << std::endl;
+}
+
+// 运行基准测试：迭代次数逐步翻倍，直到单轮耗时不少于min_time_ms，以最后一轮为结果
+template <typename Fn>
+Result run(const std::string& name, Fn&& fn, int min_time_ms) {
+    using Clock = std::chrono::steady_clock;
+
+    // 预热
+    fn();
+
+    uint64_t iterations = 1;
+    while (true) {
+        AllocStats before = allocStats();
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            fn();
+        }
+        double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        AllocStats after = allocStats();
+
+        if (elapsed_ns >= min_time_ms * 1e6 || iterations >= (1ULL << 40)) {
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.ns_per_op = elapsed_ns / iterations;
+            result.allocs_per_op = static_cast<double>(after.count - before.count) / iterations;
+            result.bytes_per_op = static_cast<double>(after.bytes - before.bytes) / iterations;
+            return result;
+        }
+
+        // 按已用时间估算下一轮次数，至多放大10倍
+        double scale = elapsed_ns > 0 ? min_time_ms * 1e6 * 1.2 / elapsed_ns : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = static_cast<uint64_t>(iterations * scale);
+    }
+}
+
+} // namespace bench
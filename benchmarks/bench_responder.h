@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+
+// 多线程本地UDP应答器（基准测试用）
+// 每个线程持有一个SO_REUSEPORT的socket，对每个查询返回一条指向127.0.0.1的A记录
+class BenchResponder {
+public:
+    explicit BenchResponder(size_t thread_count) : running_(true), port_(0) {
+        for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+            int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+            int on = 1;
+            setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+            int rcvbuf = 4 << 20;
+            setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port_);
+            bind(sockfd, (struct sockaddr*)&addr, sizeof(addr));
+
+            if (port_ == 0) {
+                socklen_t len = sizeof(addr);
+                getsockname(sockfd, (struct sockaddr*)&addr, &len);
+                port_ = ntohs(addr.sin_port);
+            }
+            sockets_.push_back(sockfd);
+        }
+
+        for (int sockfd : sockets_) {
+            threads_.emplace_back(&BenchResponder::run, this, sockfd);
+        }
+    }
+
+    ~BenchResponder() {
+        running_ = false;
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        for (int sockfd : sockets_) {
+            close(sockfd);
+        }
+    }
+
+    uint16_t port() const { return port_; }
+
+private:
+    std::atomic<bool> running_;
+    uint16_t port_;
+    std::vector<int> sockets_;
+    std::vector<std::thread> threads_;
+
+    void run(int sockfd) {
+        std::vector<uint8_t> buffer(4096);
+        while (running_) {
+            struct pollfd pfd;
+            pfd.fd = sockfd;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, 50) <= 0) continue;
+
+            while (true) {
+                struct sockaddr_in from;
+                socklen_t from_len = sizeof(from);
+                ssize_t received = recvfrom(sockfd, buffer.data(), buffer.size() - 16, MSG_DONTWAIT,
+                                            (struct sockaddr*)&from, &from_len);
+                if (received < 12) break;
+
+                size_t length = answer(buffer.data(), static_cast<size_t>(received));
+                sendto(sockfd, buffer.data(), length, 0, (struct sockaddr*)&from, from_len);
+            }
+        }
+    }
+
+    // 在查询后追加应答，原地修改缓冲区
+    static size_t answer(uint8_t* packet, size_t length) {
+        size_t offset = 12;
+        while (offset < length && packet[offset] != 0) {
+            offset += packet[offset] + 1;
+        }
+        offset = std::min(length, offset + 5);
+
+        packet[2] = 0x81;
+        packet[3] = 0x80;
+        packet[6] = 0; packet[7] = 1;
+        packet[8] = packet[9] = packet[10] = packet[11] = 0;
+
+        const uint8_t record[] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01,
+                                  0x00, 0x00, 0x01, 0x2C, 0x00, 0x04, 127, 0, 0, 1};
+        memcpy(packet + offset, record, sizeof(record));
+        return offset + sizeof(record);
+    }
+};
@@ -0,0 +1,187 @@
+#include "dns_parser.h"
+#include "dns_packet.h"
+#include "dns_packet_view.h"
+#include "dns_simd.h"
+#include "bench_harness.h"
+#include "bench_corpus.h"
+#include <cctype>
+#include <cstdlib>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// 数据包构建/解析热点路径的微基准测试
+// 用法: zjpdns_bench [名称过滤] [每项最短时长ms]
+
+using zjpdns::DnsPacketBuilder;
+
+static std::string g_filter;
+static int g_min_time_ms = 200;
+
+// 向量化之前的逐字节域名校验，作为对比基线
+static bool legacyIsValidDomain(const std::string& domain) {
+    if (domain.empty() || domain.length() > 253) {
+        return false;
+    }
+    for (char c : domain) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '-' || c == '.')) {
+            return false;
+        }
+    }
+    if (domain.front() == '.' || domain.back() == '.') {
+        return false;
+    }
+    if (domain.find("..") != std::string::npos) {
+        return false;
+    }
+    return true;
+}
+
+template <typename Fn>
+static void benchmark(const std::string& name, Fn&& fn) {
+    if (!g_filter.empty() && name.find(g_filter) == std::string::npos) {
+        return;
+    }
+    bench::printResult(bench::run(name, fn, g_min_time_ms));
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) g_filter = argv[1];
+    if (argc > 2) g_min_time_ms = std::atoi(argv[2]);
+
+    std::vector<bench::CorpusEntry> corpus = bench::responseCorpus();
+
+    bench::printHeader();
+
+    // 构建
+    benchmark("buildQueryPacket", [] {
+        bench::doNotOptimize(DnsPacketBuilder::buildQueryPacket("www.example.com", zjpdns::DnsRecordType::A,
+                                                                zjpdns::DnsRecordClass::IN, 0x1234));
+    });
+
+    benchmark("buildQueryPacket/buffer", [] {
+        uint8_t buffer[DNS_QUERY_BUFFER_SIZE];
+        size_t length = DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), "www.example.com",
+                                                           zjpdns::DnsRecordType::A,
+                                                           zjpdns::DnsRecordClass::IN, 0x1234);
+        bench::doNotOptimize(buffer);
+        bench::doNotOptimize(length);
+    });
+
+    zjpdns::DnsPacket custom = DnsPacketBuilder::parsePacket(corpus.back().data);
+    benchmark("buildCustomPacket/heavy_compression", [&custom] {
+        bench::doNotOptimize(DnsPacketBuilder::buildCustomPacket(custom));
+    });
+
+    benchmark("encodeDomain", [] {
+        bench::doNotOptimize(DnsPacketBuilder::encodeDomain("api.eu-west-1.service.example.com"));
+    });
+
+    // 解码域名：无压缩指针 / 末尾为压缩指针
+    std::vector<uint8_t> plain = DnsPacketBuilder::encodeDomain("api.eu-west-1.service.example.com");
+    benchmark("decodeDomain/plain", [&plain] {
+        size_t offset = 0;
+        bench::doNotOptimize(DnsPacketBuilder::decodeDomain(plain, offset));
+    });
+
+    std::vector<uint8_t> compressed = DnsPacketBuilder::encodeDomain("service.example.com");
+    size_t compressed_offset = compressed.size();
+    for (const char* label : {"api", "eu-west-1"}) {
+        compressed.push_back(static_cast<uint8_t>(std::string(label).size()));
+        compressed.insert(compressed.end(), label, label + std::string(label).size());
+    }
+    compressed.push_back(0xC0);
+    compressed.push_back(0x00);
+    benchmark("decodeDomain/compressed", [&compressed, compressed_offset] {
+        size_t offset = compressed_offset;
+        bench::doNotOptimize(DnsPacketBuilder::decodeDomain(compressed, offset));
+    });
+
+    // 解析
+    for (const auto& entry : corpus) {
+        const std::vector<uint8_t>& data = entry.data;
+        benchmark("parsePacket/" + entry.name, [&data] {
+            bench::doNotOptimize(DnsPacketBuilder::parsePacket(data));
+        });
+    }
+
+    for (const auto& entry : corpus) {
+        const std::vector<uint8_t>& data = entry.data;
+        benchmark("parseResponsePacket/" + entry.name, [&data] {
+            bench::doNotOptimize(DnsPacketBuilder::parseResponsePacket(data));
+        });
+    }
+
+    // pmr解析：每次使用栈上缓冲区的monotonic_buffer_resource
+    for (const auto& entry : corpus) {
+        const std::vector<uint8_t>& data = entry.data;
+        benchmark("parseResponsePacket_pmr/" + entry.name, [&data] {
+            alignas(std::max_align_t) char buffer[8192];
+            std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer));
+            bench::doNotOptimize(DnsPacketBuilder::parseResponsePacket(data.data(), data.size(), &resource));
+        });
+    }
+
+    // 零拷贝视图：遍历所有记录
+    for (const auto& entry : corpus) {
+        const std::vector<uint8_t>& data = entry.data;
+        benchmark("DnsPacketView/" + entry.name, [&data] {
+            zjpdns::DnsPacketView view(data);
+            uint32_t sum = 0;
+            for (const auto& record : view.answers()) sum += record.ttl;
+            for (const auto& record : view.authorities()) sum += record.ttl;
+            for (const auto& record : view.additionals()) sum += record.ttl;
+            bench::doNotOptimize(sum);
+        });
+    }
+
+    // 域名校验与小写转换：每次操作处理一组长度不同的域名
+    const std::vector<std::string> names = {
+        "example.com", "www.Google.com", "api.eu-west-1.service.example.com",
+        "e13678.dscb.akamaiedge.net", "www.microsoft.com-c-3.edgekey.net.globalredir.akadns.net",
+        "_sip._tcp.voip.corp.example.org", "Static.CDN-Provider.net", "1.0.168.192.in-addr.arpa"
+    };
+    std::string label = "names" + std::to_string(names.size());
+
+    benchmark("isValidDomain/legacy/" + label, [&names] {
+        for (const auto& name : names) {
+            bench::doNotOptimize(legacyIsValidDomain(name));
+        }
+    });
+
+    const zjpdns::simd::Kernel kernels[] = {zjpdns::simd::Kernel::SCALAR, zjpdns::simd::Kernel::SSE2,
+                                            zjpdns::simd::Kernel::AVX2};
+    for (zjpdns::simd::Kernel kernel : kernels) {
+        if (static_cast<int>(kernel) > static_cast<int>(zjpdns::simd::activeKernel())) continue;
+        benchmark(std::string("scanDomain/") + zjpdns::simd::kernelName(kernel) + "/" + label, [&names, kernel] {
+            for (const auto& name : names) {
+                bench::doNotOptimize(zjpdns::simd::scanDomain(kernel, name.data(), name.size()));
+            }
+        });
+    }
+
+    benchmark("tolower/legacy/" + label, [&names] {
+        char out[256];
+        for (const auto& name : names) {
+            for (size_t i = 0; i < name.size(); ++i) {
+                out[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+            }
+            bench::doNotOptimize(out);
+        }
+    });
+
+    for (zjpdns::simd::Kernel kernel : kernels) {
+        if (static_cast<int>(kernel) > static_cast<int>(zjpdns::simd::activeKernel())) continue;
+        benchmark(std::string("scanDomain+lower/") + zjpdns::simd::kernelName(kernel) + "/" + label,
+                  [&names, kernel] {
+            char out[256];
+            for (const auto& name : names) {
+                bench::doNotOptimize(zjpdns::simd::scanDomain(kernel, name.data(), name.size(), out));
+                bench::doNotOptimize(out);
+            }
+        });
+    }
+
+    return 0;
+}
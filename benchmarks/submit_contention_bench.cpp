@@ -0,0 +1,167 @@
+#include "dns_parser.h"
+#include "mpsc_queue.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+// 任务提交路径的争用基准测试：1~N个生产者线程同时提交
+// 1. 加锁队列（mutex + condition_variable，每次提交都通知）与无锁MPSC队列（消费者空闲时才唤醒）的对比
+// 2. 异步解析器的resolveWithCallback提交（无效域名，任务在工作线程中立即完成，不发送查询）
+// 用法: submit_contention_bench [最大生产者数] [每个生产者提交数] [解析器工作线程数]
+
+using Clock = std::chrono::steady_clock;
+
+struct Item : zjpdns::MpscNode {};
+
+// 加锁队列：每次提交都获取同一个互斥锁并通知消费者
+static double runLockedQueue(size_t producers, size_t per_producer) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<uint64_t> queue;
+    uint64_t total = producers * per_producer;
+
+    auto start = Clock::now();
+    std::thread consumer([&]() {
+        uint64_t received = 0;
+        while (received < total) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return !queue.empty(); });
+            received += queue.size();
+            queue.clear();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < per_producer; ++i) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queue.push_back(p * per_producer + i);
+                }
+                cv.notify_one();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 无锁队列：入队一次原子交换，消费者只在队列取空后休眠，生产者看到消费者休眠时才唤醒
+static double runMpscQueue(size_t producers, size_t per_producer) {
+    zjpdns::MpscQueue queue;
+    std::vector<Item> items(producers * per_producer);
+    uint64_t total = items.size();
+    std::atomic<bool> sleeping{false};
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto start = Clock::now();
+    std::thread consumer([&]() {
+        uint64_t received = 0;
+        while (received < total) {
+            if (queue.pop() != nullptr) {
+                ++received;
+                continue;
+            }
+
+            // 声明休眠后再检查一次队列，避免错过休眠前入队的生产者
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping = true;
+            zjpdns::MpscNode* node = queue.pop();
+            if (node == nullptr) {
+                cv.wait_for(lock, std::chrono::milliseconds(1));
+            } else {
+                ++received;
+            }
+            sleeping = false;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < per_producer; ++i) {
+                queue.push(&items[p * per_producer + i]);
+                if (sleeping.load()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    cv.notify_one();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// 解析器提交：返回所有生产者完成提交的时间
+static double runResolver(size_t producers, size_t per_producer, size_t workers) {
+    auto resolver = zjpdns::createAsyncDnsResolver(workers);
+    resolver->setQueueLimit(producers * per_producer, zjpdns::OverloadPolicy::BLOCK);
+    std::atomic<uint64_t> completed{0};
+    uint64_t total = producers * per_producer;
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < per_producer; ++i) {
+                resolver->resolveWithCallback("bench..invalid",
+                    [&completed](const zjpdns::DnsResult&) { completed.fetch_add(1, std::memory_order_relaxed); },
+                    zjpdns::DnsRecordType::A, zjpdns::ResolveMethod::DNS_PACKET);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    while (completed.load() < total) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_producers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    size_t per_producer = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    size_t workers = argc > 3 ? std::strtoul(argv[3], nullptr, 10)
+                              : std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "=== submission contention (" << per_producer << " submits per producer, "
+              << workers << " resolver workers) ===" << std::endl;
+    std::cout << std::setw(10) << "producers" << std::setw(16) << "locked Mops/s"
+              << std::setw(14) << "mpsc Mops/s" << std::setw(10) << "speedup"
+              << std::setw(18) << "resolver Mops/s" << std::setw(16) << "ns/submit" << std::endl;
+
+    for (size_t producers = 1; producers <= max_producers; producers *= 2) {
+        double total = static_cast<double>(producers * per_producer);
+        double locked = runLockedQueue(producers, per_producer);
+        double mpsc = runMpscQueue(producers, per_producer);
+        double resolver = runResolver(producers, per_producer, workers);
+
+        // ns/submit为单个生产者每次提交的平均耗时
+        std::cout << std::setw(10) << producers
+                  << std::setw(16) << std::fixed << std::setprecision(2) << total / locked / 1e6
+                  << std::setw(14) << total / mpsc / 1e6
+                  << std::setw(9) << locked / mpsc << "x"
+                  << std::setw(18) << total / resolver / 1e6
+                  << std::setw(16) << std::setprecision(0) << resolver * 1e9 / per_producer << std::endl;
+    }
+
+    return 0;
+}
@@ -60,7 +60,7 @@ int main() {
     for (const auto& domain : domains) {
         std::cout << "resolve domain: " << domain << std::endl;
         
-        // 使用gethostbyname方式
+        // 使用系统解析方式
         auto result1 = resolver->resolve(domain, zjpdns::DnsRecordType::A, 
                                        zjpdns::ResolveMethod::GETHOSTBYNAME);
         std::cout << "gethostbyname method:" << std::endl;
@@ -107,7 +107,7 @@ int main() {
         printResult(result);
     }
 
-    // 测试gethostbyname异步解析
+    // 测试系统解析方式异步解析
     std::cout << "=== gethostbyname async resolve test ===" << std::endl;
     auto gethostbyname_future = async_resolver->resolveAsync("www.google.com", zjpdns::DnsRecordType::A,
                                                             zjpdns::ResolveMethod::GETHOSTBYNAME);
@@ -153,7 +153,7 @@ int main() {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
-    // 测试gethostbyname回调式异步解析
+    // 测试系统解析方式回调式异步解析
     std::cout << "=== gethostbyname callback async resolve test ===" << std::endl;
     completed_count.store(0);
     for (const auto& domain : domains) {
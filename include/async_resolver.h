@@ -2,28 +2,49 @@
 
 #include "dns_parser.h"
 #include "dns_resolver.h"
-#include <thread>
-#include <queue>
+#include "dns_cache.h"
+#include "dns_event_loop.h"
+#include "task_executor.h"
+#include "dns_tcp.h"
+#include "dns_upstream.h"
+#include "dns_system.h"
+#include "dns_metrics.h"
+#include "mpsc_queue.h"
+#include <vector>
+#include <unordered_map>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 
 namespace zjpdns {
 
+#define DNS_TASK_PRIORITIES 2           // TaskPriority的级数，每级一个排队队列
+
 // 异步DNS解析器实现类
+// 解析任务由工作窃取执行器的多个工作线程处理，数据包方式的查询分散到多个事件循环收发；
+// 提交的任务先进入按优先级划分的有界无锁队列，工作线程总是取出优先级最高、最早排队的任务
 class AsyncDnsResolverImpl : public AsyncDnsResolver {
 public:
-    AsyncDnsResolverImpl();
+    explicit AsyncDnsResolverImpl(size_t thread_count = 1);
     ~AsyncDnsResolverImpl() override;
     
     // 异步解析接口
     std::future<DnsResult> resolveAsync(const std::string& domain,
                                        DnsRecordType type = DnsRecordType::A,
-                                       ResolveMethod method = ResolveMethod::GETHOSTBYNAME) override;
+                                       ResolveMethod method = ResolveMethod::GETHOSTBYNAME,
+                                       TaskPriority priority = TaskPriority::INTERACTIVE) override;
     
     // 使用自定义DNS数据包异步解析
     std::future<DnsResult> resolveWithPacketAsync(const DnsPacket& packet) override;
     
+    // 异步批量解析
+    std::future<std::vector<DnsResult>> resolveBatchAsync(const std::vector<DnsQuery>& queries,
+                                                          TaskPriority priority = TaskPriority::INTERACTIVE) override;
+    
+    // 异步双栈解析
+    std::future<DnsResult> resolveDualAsync(const std::string& domain,
+                                            int grace_ms = DNS_DUAL_GRACE_DELAY) override;
+    
     // 使用自定义DNS数据包异步解析（回调方式）
     void resolveWithPacketCallback(const DnsPacket& packet,
                                   std::function<void(const DnsResult&)> callback) override;
@@ -32,19 +53,45 @@ public:
     void resolveWithCallback(const std::string& domain,
                            std::function<void(const DnsResult&)> callback,
                            DnsRecordType type = DnsRecordType::A,
-                           ResolveMethod method = ResolveMethod::GETHOSTBYNAME) override;
+                           ResolveMethod method = ResolveMethod::GETHOSTBYNAME,
+                           TaskPriority priority = TaskPriority::INTERACTIVE) override;
+    
+    // 直接完成的解析，回调在事件循环线程中调用（包括截断后改用TCP的查询）
+    void resolveDirect(const std::string& domain, DnsRecordType type,
+                       DirectCompletion complete, void* context) override;
     
     // 设置DNS服务器
     void setDnsServer(const std::string& server, uint16_t port = 53) override;
     
+    // 设置多个上游服务器
+    void setDnsServers(const std::vector<DnsServer>& servers) override;
+    
+    // 开启竞速查询
+    void setHedging(bool enabled) override;
+    
+    // 设置UDP重传策略
+    void setRetryPolicy(const RetryPolicy& policy) override;
+    
     // 设置超时时间
     void setTimeout(int timeout_ms) override;
     
-    // 启动工作线程
+    // 设置应答缓存大小（0表示关闭缓存）
+    void setCacheSize(size_t max_entries) override;
+    
+    // 设置EDNS(0)通告的UDP负载大小（0表示不发送OPT记录）
+    void setEdnsPayloadSize(uint16_t payload_size) override;
+    
+    // 设置排队任务数上限和队列满时的处理方式
+    void setQueueLimit(size_t max_tasks, OverloadPolicy policy = OverloadPolicy::FAIL) override;
+    
+    // 启动工作线程和事件循环
     void start();
     
-    // 停止工作线程
+    // 停止工作线程和事件循环
     void stop();
+    
+    // 本实例的指标（同时登记在MetricsRegistry中）
+    std::shared_ptr<ResolverMetrics> metrics() const { return metrics_; }
 
 private:
     struct Task {
@@ -55,26 +102,168 @@ private:
         bool use_custom_packet;
         std::function<void(const DnsResult&)> callback;
         std::promise<DnsResult> promise;
+        std::chrono::steady_clock::time_point submitted;
+        ResolverMetrics* metrics;
         
         Task() : type(DnsRecordType::A), method(ResolveMethod::GETHOSTBYNAME), 
-                 use_custom_packet(false) {}
+                 use_custom_packet(false), metrics(nullptr) {}
+    };
+    
+    // 一次查询使用的配置快照
+    struct QueryConfig {
+        std::string servers_key;
+        int timeout_ms;
+        uint16_t edns_payload_size;
+        bool hedging;
+        RetryPolicy retry;
+    };
+    
+    // 竞速查询的状态，只在发送查询的事件循环线程中访问
+    struct Race {
+        size_t index[2];
+        DnsServer server[2];
+        std::chrono::steady_clock::time_point sent[2];
+        std::vector<uint8_t> packet;
+        int pending;
+        bool finished;
+        
+        Race() : index{0, 0}, pending(0), finished(false) {}
+    };
+    
+    // 批量查询的上游统计：整批只报告一次（与UpstreamSelector::reportBatch相同），只在发送查询的事件循环线程中访问
+    struct BatchUpstream {
+        std::chrono::steady_clock::time_point sent;
+        size_t pending;         // 尚未应答的查询数
+        bool reported;
+        
+        BatchUpstream() : pending(0), reported(false) {}
+    };
+    
+    // 双栈解析的状态：AAAA和A查询各自完成，先完成且带地址的一方启动宽限期定时器
+    struct DualTask {
+        DnsResult results[2];       // AAAA, A
+        bool done[2];
+        bool finished;
+        std::mutex mutex;
+        std::promise<DnsResult> promise;
+        
+        DualTask() : done{false, false}, finished(false) {}
     };
     
-    std::unique_ptr<DnsResolver> resolver_;
-    std::thread worker_thread_;
-    std::queue<Task> task_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_cv_;
+    // 排队等待工作线程的任务
+    struct QueuedTask : MpscNode {
+        std::function<void()> execute;
+        std::function<void(const DnsResult&)> reject;   // 因过载被拒绝或丢弃时以该结果结束任务
+        std::chrono::steady_clock::time_point submitted;
+    };
+    
+    struct BatchTask {
+        std::vector<DnsQuery> queries;
+        std::vector<DnsResult> results;
+        std::atomic<size_t> remaining;
+        std::promise<std::vector<DnsResult>> promise;
+        std::chrono::steady_clock::time_point submitted;
+        
+        BatchTask() : remaining(0) {}
+    };
+    
+    std::shared_ptr<ResolverMetrics> metrics_;
+    std::unique_ptr<SystemResolver> system_;           // 系统解析（getaddrinfo线程池）
+    std::unique_ptr<WorkStealingExecutor> executor_;   // 任务准备、阻塞式解析和结果通知
+    std::vector<std::unique_ptr<DnsEventLoop>> event_loops_;  // 数据包方式的非阻塞收发
+    std::unique_ptr<DnsCache> cache_;
+    std::unique_ptr<DnsTcpTransport> tcp_;             // 截断应答的TCP重查，连接在查询间复用
+    UpstreamSelector upstreams_;
+    std::string servers_key_;                          // 服务器列表的描述，用于在途查询合并
+    bool hedging_;
+    RetryPolicy retry_policy_;
+    int timeout_ms_;
+    uint16_t edns_payload_size_;
+    std::mutex config_mutex_;
+    std::atomic<size_t> next_loop_;
     std::atomic<bool> running_;
     
-    // 工作线程函数
-    void workerThread();
+    // 有界任务队列：生产者先占用位置再无锁入队；消费权（draining_）同一时刻只属于一个执行请求，
+    // 持有者取出一个任务后把消费权交给新的执行请求，生产者只在消费权空闲时才向执行器提交
+    MpscQueue queued_[DNS_TASK_PRIORITIES];
+    std::atomic<size_t> queued_count_;                // 已占用的位置，含正在入队的任务
+    std::atomic<size_t> queue_limit_;
+    std::atomic<OverloadPolicy> overload_policy_;
+    std::atomic<bool> draining_;
+    std::mutex pop_mutex_;                            // 出队互斥：消费者与DROP_OLDEST下丢弃任务的生产者
+    std::atomic<size_t> blocked_;                     // BLOCK策略下等待空位的生产者数
+    std::mutex space_mutex_;
+    std::condition_variable space_cv_;
+    
+    // 在途查询：同一(域名, 类型, 服务器)只发送一次，后来的任务等待同一个响应
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Task>>> inflight_;
+    std::mutex inflight_mutex_;
+    
+    // 在工作线程中执行解析任务
+    void executeTask(std::shared_ptr<Task> task);
+    
+    // 执行数据包方式的解析任务，发送交给事件循环
+    void executePacketTask(std::shared_ptr<Task> task);
+    
+    // 执行批量解析任务，所有未命中缓存的查询一次性交给事件循环发送
+    void executeBatchTask(std::shared_ptr<BatchTask> batch);
+    
+    // 发送单个查询：选择最好的上游服务器，开启竞速时延迟后向次选服务器发送；
+    // 服务器不支持EDNS时去掉OPT记录重发一次，应答被截断时改用TCP
+    // completion在事件循环线程或工作线程（TCP）中调用
+    void sendQuery(const QueryConfig& config, const std::string& domain, DnsRecordType type,
+                   uint16_t edns_payload_size, std::function<void(const DnsResult&)> completion);
+    
+    // 在工作线程中通过TCP重新查询，不阻塞事件循环；reply_loop不为空时completion回到该事件循环线程中调用
+    void queryTcp(const DnsServer& server, int timeout_ms,
+                  std::vector<uint8_t> packet, std::function<void(const DnsResult&)> completion,
+                  DnsEventLoop* reply_loop = nullptr);
+    
+    // 读取当前配置
+    QueryConfig loadConfig();
+    
+    // 轮流选择事件循环
+    DnsEventLoop* nextLoop();
     
-    // 执行解析任务
-    void executeTask(Task& task);
+    static double elapsedMs(std::chrono::steady_clock::time_point start);
+    
+    // 双栈解析中的一个地址族完成
+    void completeDualQuery(std::shared_ptr<DualTask> dual, size_t index, const DnsResult& result, int grace_ms);
+    
+    // 结束双栈解析，合并已完成的结果（只执行一次）
+    static void finishDual(DualTask& dual);
+    
+    // 批量任务中的一个查询完成，全部完成后通知promise
+    static void completeBatchQuery(BatchTask& batch, size_t count);
+    
+    // 完成任务，记录指标并通知回调和promise
+    static void completeTask(Task& task, const DnsResult& result);
     
     // 添加任务到队列
-    void addTask(Task task);
+    void addTask(Task task, TaskPriority priority = TaskPriority::INTERACTIVE);
+    
+    // 把任务放入对应优先级的队列并提交一个执行请求，队列已满时按过载策略处理
+    void enqueue(TaskPriority priority, std::function<void()> execute,
+                 std::function<void(const DnsResult&)> reject);
+    
+    // 持有消费权时取出并执行优先级最高的排队任务
+    void runQueued();
+    
+    // 释放消费权，释放后又有任务到达且重新取得消费权时返回false
+    bool releaseDrain();
+    
+    // 出队优先级最高的任务 / 优先级不高于level的最低优先级中最早的任务
+    QueuedTask* popHighest();
+    QueuedTask* popLowest(size_t level);
+    
+    // 归还一个队列位置，唤醒等待空位的生产者
+    void releaseSlot();
+    
+    // BLOCK策略下等待队列有空位
+    void waitForSpace();
+    
+    // 过载结果
+    static DnsResult overloadResult(const std::string& message);
 };
 
 } // namespace zjpdns 
\ No newline at end of file
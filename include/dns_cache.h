@@ -0,0 +1,67 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+
+namespace zjpdns {
+
+#define DNS_CACHE_SIZE 4096
+
+// DNS应答缓存：按(域名, 类型, 类)索引，依据记录TTL过期，超出容量时按LRU淘汰
+// NXDOMAIN和NODATA应答按RFC 2308进行否定缓存，时长为min(SOA TTL, SOA MINIMUM)
+class DnsCache {
+public:
+    explicit DnsCache(size_t max_entries = DNS_CACHE_SIZE);
+    ~DnsCache();
+
+    // 查找缓存，命中时返回剩余TTL已扣减的结果
+    bool lookup(const std::string& domain, DnsRecordType type,
+                DnsRecordClass class_, DnsResult& result);
+
+    // 写入缓存（结果不可缓存时忽略）
+    void insert(const std::string& domain, DnsRecordType type,
+                DnsRecordClass class_, const DnsResult& result);
+
+    // 设置最大条目数（0表示关闭缓存）
+    void setMaxEntries(size_t max_entries);
+
+    // 清空缓存
+    void clear();
+
+    // 当前条目数
+    size_t size() const;
+
+    // 生成缓存键（域名不区分大小写，忽略末尾的点）
+    static std::string makeKey(const std::string& domain, DnsRecordType type,
+                               DnsRecordClass class_);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string key;
+        DnsResult result;
+        Clock::time_point inserted;
+        Clock::time_point expires;
+    };
+
+    size_t max_entries_;
+    std::list<Entry> entries_;   // 头部为最近使用
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    mutable std::mutex mutex_;
+
+    // 计算结果的缓存时长（秒），0表示不可缓存
+    static uint32_t cacheTtl(const DnsResult& result);
+    
+    // 计算否定应答的缓存时长（秒），没有SOA记录时返回0
+    static uint32_t negativeTtl(const DnsResult& result);
+
+    // 淘汰多余条目
+    void evict();
+};
+
+} // namespace zjpdns
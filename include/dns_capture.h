@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace zjpdns {
+
+// 默认只提取该端口（源或目的）的UDP负载
+#define DNS_CAPTURE_PORT 53
+
+// 抓包读取统计
+struct DnsCaptureStats {
+    uint64_t frames;        // 读取的帧数
+    uint64_t payloads;      // 交给处理函数的DNS负载数
+    uint64_t bytes;         // DNS负载总字节数
+    uint64_t skipped;       // 非UDP、端口不匹配、分片或截断的帧数
+    double seconds;         // 耗时
+
+    DnsCaptureStats() : frames(0), payloads(0), bytes(0), skipped(0), seconds(0) {}
+
+    double packetsPerSecond() const { return seconds > 0 ? payloads / seconds : 0; }
+};
+
+// 抓包文件读取器：以mmap方式映射pcap/pcapng文件或长度前缀的原始转储，
+// 逐层解析链路层/IP/UDP头部，把指向映射内存的DNS负载直接交给处理函数，不复制数据
+//
+// 原始转储格式与DNS over TCP一致：每条消息前为2字节大端长度
+class DnsCaptureReader {
+public:
+    enum class Format { NONE, PCAP, PCAPNG, RAW };
+
+    // 负载处理函数，data指向映射内存，仅在回调期间有效
+    using PayloadHandler = std::function<void(const uint8_t* data, size_t length)>;
+
+    // 并行处理函数，worker为工作线程序号
+    using ParallelHandler = std::function<void(size_t worker, const uint8_t* data, size_t length)>;
+
+    DnsCaptureReader();
+    ~DnsCaptureReader();
+
+    DnsCaptureReader(const DnsCaptureReader&) = delete;
+    DnsCaptureReader& operator=(const DnsCaptureReader&) = delete;
+
+    // 映射文件并识别格式，失败时error()返回原因
+    bool open(const std::string& path);
+
+    // 解除映射
+    void close();
+
+    Format format() const { return format_; }
+    size_t size() const { return size_; }
+    const std::string& error() const { return error_; }
+
+    // 设置提取的UDP端口（0表示所有UDP负载），原始转储不受影响
+    void setPort(uint16_t port) { port_ = port; }
+
+    // 顺序读取所有DNS负载
+    DnsCaptureStats read(const PayloadHandler& handler) const;
+
+    // 按文件偏移把帧切分给thread_count个线程并行处理
+    DnsCaptureStats readParallel(size_t thread_count, const ParallelHandler& handler) const;
+
+private:
+    // 读取位置及所在段的解析状态（pcapng的字节序和接口链路类型随段变化）
+    struct Cursor {
+        size_t offset;
+        bool swapped;
+        uint32_t link_type;                 // pcap的链路类型
+        std::vector<uint16_t> interfaces;   // pcapng各接口的链路类型
+
+        Cursor() : offset(0), swapped(false), link_type(0) {}
+    };
+
+    const uint8_t* data_;
+    size_t size_;
+    Format format_;
+    uint16_t port_;
+    std::string error_;
+
+    // 文件第一帧的读取位置
+    Cursor begin() const;
+
+    // 从cursor开始处理到end之前的所有帧，handler为空时只移动位置（用于切分）
+    void walk(Cursor& cursor, size_t end, const PayloadHandler* handler, DnsCaptureStats& stats) const;
+
+    // 读取下一帧，返回false表示到达文件末尾或格式错误
+    bool nextFrame(Cursor& cursor, const uint8_t*& frame, size_t& length, uint32_t& link_type) const;
+
+    // 从一帧中提取UDP负载
+    bool extractPayload(uint32_t link_type, const uint8_t* frame, size_t length,
+                        const uint8_t*& payload, size_t& payload_length) const;
+
+    bool extractIp(const uint8_t* packet, size_t length,
+                   const uint8_t*& payload, size_t& payload_length) const;
+
+    uint16_t read16(const Cursor& cursor, size_t offset) const;
+    uint32_t read32(const Cursor& cursor, size_t offset) const;
+};
+
+} // namespace zjpdns
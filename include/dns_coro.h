@@ -0,0 +1,58 @@
+#pragma once
+
+// C++20协程接口（需要以C++20编译，链接zjpdns_coro目标）
+#include "dns_parser.h"
+#include <atomic>
+#include <coroutine>
+#include <string>
+#include <utility>
+
+namespace zjpdns {
+
+// 解析的等待体：co_await时发送查询并挂起，应答到达后直接在解析器的事件循环线程中恢复协程
+// （缓存命中时不挂起；截断后改用TCP时同样回到事件循环线程恢复）；协程恢复后运行在事件循环线程上，其中不应有阻塞操作
+class ResolveAwaitable {
+public:
+    ResolveAwaitable(AsyncDnsResolver& resolver, std::string domain, DnsRecordType type)
+        : resolver_(resolver), domain_(std::move(domain)), type_(type), completed_(false) {}
+
+    ResolveAwaitable(const ResolveAwaitable&) = delete;
+    ResolveAwaitable& operator=(const ResolveAwaitable&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    // 返回false表示查询已同步完成，不挂起
+    bool await_suspend(std::coroutine_handle<> handle) {
+        handle_ = handle;
+        resolver_.resolveDirect(domain_, type_, &ResolveAwaitable::complete, this);
+
+        // 先完成的一方负责继续：回调已执行时不挂起，否则由回调恢复协程
+        return !completed_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    DnsResult await_resume() { return std::move(result_); }
+
+private:
+    AsyncDnsResolver& resolver_;
+    std::string domain_;
+    DnsRecordType type_;
+    DnsResult result_;
+    std::coroutine_handle<> handle_;
+    std::atomic<bool> completed_;
+
+    static void complete(void* context, const DnsResult& result) {
+        auto* self = static_cast<ResolveAwaitable*>(context);
+        self->result_ = result;
+        if (self->completed_.exchange(true, std::memory_order_acq_rel)) {
+            self->handle_.resume();
+        }
+    }
+};
+
+// co_await resolveCo(resolver, "www.example.com", DnsRecordType::A)
+inline ResolveAwaitable resolveCo(AsyncDnsResolver& resolver, std::string domain,
+                                  DnsRecordType type = DnsRecordType::A) {
+    return ResolveAwaitable(resolver, std::move(domain), type);
+}
+
+} // namespace zjpdns
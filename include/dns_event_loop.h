@@ -0,0 +1,135 @@
+#pragma once
+
+#include "dns_parser.h"
+#include "dns_packet.h"
+#include "dns_metrics.h"
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <netinet/in.h>
+
+namespace zjpdns {
+
+// 基于epoll的DNS事件循环
+// 单个线程管理一组UDP socket上的所有在途查询，响应乱序到达时按(事务ID, 问题)匹配，
+// 每个查询的超时由定时器堆跟踪，不会阻塞其他查询
+class DnsEventLoop {
+public:
+    using Completion = std::function<void(const DnsResult&)>;
+
+    explicit DnsEventLoop(size_t socket_count = DNS_SOCKET_POOL_SIZE);
+    ~DnsEventLoop();
+
+    DnsEventLoop(const DnsEventLoop&) = delete;
+    DnsEventLoop& operator=(const DnsEventLoop&) = delete;
+
+    // 启动事件循环线程
+    bool start();
+
+    // 停止事件循环，未完成的查询以失败结束
+    void stop();
+
+    // 投递函数到事件循环线程执行（线程安全），事件循环停止后在调用线程中直接执行
+    void post(std::function<void()> fn);
+
+    // 待发送的查询
+    struct Request {
+        std::vector<uint8_t> packet;
+        Completion completion;
+    };
+
+    // 发送查询，响应到达或超时后在事件循环线程调用completion（仅限事件循环线程调用）
+    // 每次尝试超时后按重传策略更换socket和事务ID重传，timeout_ms为所有尝试的总时间
+    void sendQuery(const std::string& server, uint16_t port,
+                   std::vector<uint8_t> packet, int timeout_ms, Completion completion,
+                   const RetryPolicy& retry = RetryPolicy());
+
+    // 使用sendmmsg批量发送查询，每个查询单独完成和重传（仅限事件循环线程调用）
+    void sendQueries(const std::string& server, uint16_t port,
+                     std::vector<Request> requests, int timeout_ms,
+                     const RetryPolicy& retry = RetryPolicy());
+
+    // 延迟delay_ms后在事件循环线程执行函数（仅限事件循环线程调用），事件循环停止时尚未执行的函数被丢弃
+    void schedule(int delay_ms, std::function<void()> fn);
+
+    // 当前在途查询数
+    size_t inflight() const;
+
+    // 设置指标（启动前调用），为空时不记录
+    void setMetrics(ResolverMetrics* metrics);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Query {
+        std::string key;
+        size_t socket;
+        struct sockaddr_in server_addr;
+        Completion completion;
+        std::vector<uint8_t> packet;        // 重传时使用
+        std::vector<int> timeouts;          // 每次尝试的超时时间
+        size_t attempt;
+    };
+
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t id;
+
+        bool operator>(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    size_t socket_count_;
+    int epoll_fd_;
+    int event_fd_;
+    std::vector<int> sockets_;
+    std::vector<std::unordered_map<std::string, uint64_t>> waiters_;  // 每个socket上的等待查询
+    std::unordered_map<uint64_t, Query> queries_;
+    std::unordered_map<uint64_t, std::function<void()>> scheduled_;  // 延迟执行的函数，与查询共用定时器堆
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t next_id_;
+    std::vector<uint8_t> buffer_;
+
+    std::mutex post_mutex_;
+    std::vector<std::function<void()>> posted_;
+    bool stopped_;                                  // 停止后投递的函数直接执行
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> inflight_;
+    ResolverMetrics* metrics_;
+
+    // 事件循环线程函数
+    void run();
+
+    // 执行投递的函数
+    void runPosted();
+
+    // 读取socket上所有已到达的响应
+    void handleReadable(size_t socket);
+
+    // 处理超时的查询
+    void handleTimeouts();
+
+    // 在下一个socket上以新事务ID重传查询，并为下一次尝试设置定时器
+    void retransmit(uint64_t id, Query& query);
+
+    // 在socket上登记等待者，已有相同事务ID和问题的查询在等待时更换事务ID，返回等待键
+    std::string registerWaiter(size_t socket, std::vector<uint8_t>& packet, uint64_t id);
+
+    // 完成查询
+    void complete(uint64_t id, const DnsResult& result);
+
+    // 计算epoll_wait的等待时间
+    int nextTimeout();
+
+    // 唤醒事件循环
+    void wakeup();
+};
+
+} // namespace zjpdns
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace zjpdns {
+
+#define DNS_METRICS_SHARDS 8                // 计数器分片数，不同线程写入不同分片（缓存行对齐）
+#define DNS_METRICS_HISTOGRAM_SHARDS 4      // 直方图分片数
+#define DNS_METRICS_SUB_BUCKETS 8           // 直方图每个2的幂区间内的线性子桶数（相对误差约12.5%）
+#define DNS_METRICS_MAX_EXPONENT 31         // 直方图记录的最大值为2^32微秒
+#define DNS_METRICS_RCODES 16               // 单独计数的响应码数量，更大的扩展响应码计入"other"
+
+// 分片计数器：每个线程固定写入一个分片，读取时求和，避免多线程争用同一缓存行
+class Counter {
+public:
+    Counter();
+
+    void add(uint64_t value = 1);
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value;
+    };
+    std::array<Shard, DNS_METRICS_SHARDS> shards_;
+};
+
+// 瞬时值（队列长度、在途查询数）
+class Gauge {
+public:
+    Gauge() : value_(0) {}
+
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_;
+};
+
+// 直方图快照，桶按上界升序排列，只包含非空的桶
+struct HistogramSnapshot {
+    uint64_t count;
+    uint64_t sum_us;
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;  // (上界（微秒，含）, 数量)
+
+    HistogramSnapshot() : count(0), sum_us(0) {}
+
+    // 百分位数（0~100），返回所在桶的上界（微秒）
+    uint64_t percentile(double p) const;
+
+    // 不超过bound_us的样本数（bound_us为桶边界时精确，例如不小于DNS_METRICS_SUB_BUCKETS的2的幂）
+    uint64_t countBelow(uint64_t bound_us) const;
+
+    // 合并另一个快照
+    void merge(const HistogramSnapshot& other);
+};
+
+// HDR风格的对数-线性延迟直方图（微秒）：每个2的幂区间分为DNS_METRICS_SUB_BUCKETS个等宽子桶，
+// 记录只是一次原子加法，分片降低多线程争用；值v计入bucketIndex(v - 1)，快照中的桶为(lower, upper]，与Prometheus的le一致
+class Histogram {
+public:
+    static const size_t kBucketCount = (DNS_METRICS_MAX_EXPONENT - 1) * DNS_METRICS_SUB_BUCKETS;
+
+    Histogram();
+
+    void record(uint64_t value_us);
+    void recordSince(std::chrono::steady_clock::time_point start);
+
+    HistogramSnapshot snapshot() const;
+
+    // 值所在的桶及桶的范围[lower, upper)
+    static size_t bucketIndex(uint64_t value_us);
+    static uint64_t bucketLower(size_t index);
+    static uint64_t bucketUpper(size_t index);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum;
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// 一个解析器实例的指标快照
+struct MetricsSnapshot {
+    std::string resolver;
+    uint64_t queries;           // 发出的UDP查询（不含重传）
+    uint64_t retransmits;
+    uint64_t timeouts;          // 接收超时的查询
+    uint64_t tcp_fallbacks;     // 截断后改用TCP的查询
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t failures;          // 没有收到应答的解析（无效域名、超时、发送失败、过载等）
+    uint64_t rejected;          // 任务队列已满时被拒绝或丢弃的任务
+    std::vector<uint64_t> rcodes;   // 按响应码计数，最后一项为更大的扩展响应码
+    int64_t queue_depth;        // 等待工作线程执行的任务数
+    int64_t inflight;           // 事件循环中的在途查询数
+    HistogramSnapshot latency;      // 解析耗时（从提交到完成）
+    HistogramSnapshot queue_wait;   // 任务在执行器队列中的等待时间
+    std::map<std::string, HistogramSnapshot> upstream_rtt;  // 按"地址:端口"
+
+    MetricsSnapshot()
+        : queries(0), retransmits(0), timeouts(0), tcp_fallbacks(0), cache_hits(0), cache_misses(0),
+          failures(0), rejected(0), rcodes(DNS_METRICS_RCODES + 1, 0), queue_depth(0), inflight(0) {}
+};
+
+// 一个解析器实例的指标，由解析器及其发送器、事件循环、上游选择器共同更新
+class ResolverMetrics {
+public:
+    explicit ResolverMetrics(const std::string& name);
+
+    const std::string& name() const { return name_; }
+
+    Counter queries;
+    Counter retransmits;
+    Counter timeouts;
+    Counter tcp_fallbacks;
+    Counter cache_hits;
+    Counter cache_misses;
+    Counter failures;
+    Counter rejected;
+    Counter rcodes[DNS_METRICS_RCODES + 1];
+    Gauge queue_depth;
+    Gauge inflight;
+    Histogram latency;
+    Histogram queue_wait;
+
+    // 上游服务器的RTT直方图，不存在时创建（返回的引用在实例生存期内有效）
+    Histogram& upstreamRtt(const std::string& server);
+
+    // 记录一次解析的结果和耗时：收到应答时按响应码计数，否则计为失败
+    void recordResult(const DnsResult& result, std::chrono::steady_clock::time_point start);
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    std::string name_;
+    std::map<std::string, std::unique_ptr<Histogram>> upstream_rtt_;
+    mutable std::mutex mutex_;
+};
+
+// 全局指标注册表：每个解析器实例创建时注册，快照覆盖所有存活的实例
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    // 创建并注册指标，名称为"<kind>-<序号>"
+    std::shared_ptr<ResolverMetrics> create(const std::string& kind);
+
+    // 所有存活实例的指标快照
+    std::vector<MetricsSnapshot> snapshot();
+
+    // 以Prometheus文本格式导出所有实例的指标
+    std::string exportPrometheus();
+
+    // 把快照格式化为Prometheus文本格式
+    static std::string formatPrometheus(const std::vector<MetricsSnapshot>& snapshots);
+
+private:
+    MetricsRegistry() : next_id_(1) {}
+
+    std::vector<std::weak_ptr<ResolverMetrics>> metrics_;
+    uint64_t next_id_;
+    std::mutex mutex_;
+};
+
+} // namespace zjpdns
@@ -1,21 +1,56 @@
 #pragma once
 
 #include "dns_parser.h"
+#include "dns_pmr.h"
+#include "dns_metrics.h"
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <netinet/in.h>
 
 namespace zjpdns {
 
 #define DNS_TIMEOUT 5000
+#define DNS_SOCKET_POOL_SIZE 4
+#define DNS_SOCKET_RCVBUF (1 << 20)
+#define DNS_UDP_BUFFER_SIZE 4096
+#define DNS_MMSG_BATCH 1024         // 单次sendmmsg发送的最大数据包数
+#define DNS_MMSG_RECV_BATCH 32      // 单次recvmmsg接收的最大数据包数
+#define DNS_QUERY_BUFFER_SIZE 512   // 足以容纳任意单问题查询的缓冲区大小
+#define DNS_EDNS_PAYLOAD_SIZE 1232  // 默认通告的EDNS(0) UDP负载大小（避免IP分片）
+#define DNS_OPT_RECORD_SIZE 11      // 不带选项的OPT记录长度
 
 // DNS数据包处理类
 class DnsPacketBuilder {
 public:
-    // 构建DNS查询数据包
+    // 构建DNS查询数据包，edns_payload_size不为0时附加EDNS(0) OPT记录
+    // 域名无效（空标签、标签超过63字节、域名超过255字节）时返回空vector，发送器不会发送空数据包
     static std::vector<uint8_t> buildQueryPacket(const std::string& domain,
                                                  DnsRecordType type = DnsRecordType::A,
                                                  DnsRecordClass class_ = DnsRecordClass::IN,
-                                                 uint16_t id = 0);
+                                                 uint16_t id = 0,
+                                                 uint16_t edns_payload_size = 0);
+    
+    // 将查询数据包写入调用方提供的缓冲区，不分配内存
+    // 返回写入长度，缓冲区不足或域名无效（空标签、标签超过63字节、域名超过255字节）时返回0
+    static size_t buildQueryPacket(uint8_t* buffer, size_t capacity,
+                                   std::string_view domain,
+                                   DnsRecordType type = DnsRecordType::A,
+                                   DnsRecordClass class_ = DnsRecordClass::IN,
+                                   uint16_t id = 0,
+                                   uint16_t edns_payload_size = 0);
+    
+    // 构建EDNS(0) OPT伪记录，可加入自定义数据包的additionals
+    static DnsRecord buildOptRecord(uint16_t payload_size,
+                                    const std::vector<EdnsOption>& options = {},
+                                    bool dnssec_ok = false);
+    
+    // 解析OPT伪记录，rcode为头部中的低4位响应码，解析后加上扩展位
+    static bool parseOptRecord(const DnsRecord& record, EdnsInfo& info, uint16_t& rcode);
     
     // 构建自定义DNS数据包
     static std::vector<uint8_t> buildCustomPacket(const DnsPacket& packet);
@@ -26,6 +61,14 @@ public:
     // 解析DNS数据包
     static DnsPacket parsePacket(const std::vector<uint8_t>& data);
     
+    // 解析DNS响应数据包，结果的内存全部来自resource
+    static pmr::DnsResult parseResponsePacket(const uint8_t* data, size_t length,
+                                              std::pmr::memory_resource* resource);
+    
+    // 解析DNS数据包，结果的内存全部来自resource
+    static pmr::DnsPacket parsePacket(const uint8_t* data, size_t length,
+                                      std::pmr::memory_resource* resource);
+    
     // 生成随机事务ID
     static uint16_t generateTransactionId();
     
@@ -38,39 +81,130 @@ public:
     static std::string decodeDomain(const std::vector<uint8_t>& data, size_t& offset);
 
 private:
-    // 编码DNS记录
-    static std::vector<uint8_t> encodeRecord(const DnsRecord& record);
+    // 域名压缩表：已写入数据包的域名后缀（小写，不含末尾的点）到偏移的映射
+    using NameCompressionTable = std::unordered_map<std::string, uint16_t>;
+    
+    // 按RFC 1035压缩编码域名并追加到数据包，重复的后缀写为压缩指针
+    static void encodeName(const std::string& domain, std::vector<uint8_t>& data,
+                           NameCompressionTable& names);
+    
+    // 编码DNS记录并追加到数据包，所有者域名参与压缩
+    static void encodeRecord(const DnsRecord& record, std::vector<uint8_t>& data,
+                             NameCompressionTable& names);
     
     // 解码DNS记录
     static DnsRecord decodeRecord(const std::vector<uint8_t>& data, size_t& offset);
 };
 
+class DnsTcpTransport;
+
 // DNS数据包发送器
+// 维护一组长期存在的非阻塞UDP socket，多个并发查询可共享同一个socket，
+// 响应按(事务ID, 问题)分发给对应的等待者；UDP应答被截断（TC）时通过TCP重新查询
 class DnsPacketSender {
 public:
-    DnsPacketSender();
+    explicit DnsPacketSender(size_t pool_size = DNS_SOCKET_POOL_SIZE);
     ~DnsPacketSender();
     
+    DnsPacketSender(const DnsPacketSender&) = delete;
+    DnsPacketSender& operator=(const DnsPacketSender&) = delete;
+    
     // 发送DNS数据包
     DnsResult sendPacket(const std::string& server, uint16_t port,
                         const std::vector<uint8_t>& packet, int timeout_ms = DNS_TIMEOUT);
     
+    // 批量发送DNS数据包，使用sendmmsg/recvmmsg，结果与输入顺序一致
+    // rtts不为空时返回每个查询从（最后一次）发送到应答到达的毫秒数，没有应答的为-1
+    std::vector<DnsResult> sendBatch(const std::string& server, uint16_t port,
+                                     const std::vector<std::vector<uint8_t>>& packets,
+                                     int timeout_ms = DNS_TIMEOUT, std::vector<double>* rtts = nullptr);
+    
+    // 竞速发送：先发给primary，hedge_delay_ms内没有应答再同时发给secondary，返回先到达的应答
+    // winner返回应答来自哪个服务器（0: primary，1: secondary，-1: 都没有应答）
+    DnsResult sendPacketHedged(const DnsServer& primary, const DnsServer& secondary,
+                               const std::vector<uint8_t>& packet, int hedge_delay_ms,
+                               int timeout_ms, int& winner);
+    
+    // 通过TCP发送DNS数据包，连接在多次查询间复用
+    DnsResult sendPacketTcp(const std::string& server, uint16_t port,
+                            const std::vector<uint8_t>& packet, int timeout_ms = DNS_TIMEOUT);
+    
+    // 同时发送一组查询（如同一域名的AAAA和A），第一个带地址的应答到达后最多再等待grace_ms，
+    // 仍未应答的查询以超时结束；不重传，结果与输入顺序一致
+    std::vector<DnsResult> sendParallel(const std::string& server, uint16_t port,
+                                        const std::vector<std::vector<uint8_t>>& packets,
+                                        int grace_ms, int timeout_ms);
+    
     // 设置重试次数
     void setRetryCount(int count);
+    
+    // 设置重传策略（sendPacket/sendBatch使用，竞速发送本身即为重传，不再额外重传）
+    void setRetryPolicy(const RetryPolicy& policy);
+    RetryPolicy retryPolicy();
+    
+    // 设置指标（开始发送前调用），为空时不记录
+    void setMetrics(ResolverMetrics* metrics);
+    
+    // 生成响应分发键：事务ID + 小写化的第一个问题
+    static std::string makeWaiterKey(const uint8_t* data, size_t length);
+    
+    // 创建非阻塞UDP socket，绑定随机源端口
+    static int createSocket();
 
 private:
+    // 等待响应的查询
+    struct Waiter {
+        std::string key;
+        struct sockaddr_in server_addr;
+        std::vector<uint8_t> response;
+        std::chrono::steady_clock::time_point received;     // 应答到达时间
+        bool done;
+        
+        Waiter() : server_addr(), done(false) {}
+    };
+    
+    // 池中的socket
+    struct PooledSocket {
+        int sockfd;
+        bool reading;                       // 是否已有线程在读取该socket
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<std::string, Waiter*> waiters;
+        std::vector<uint8_t> buffer;        // recvmmsg接收缓冲区，只由持有读取权的线程使用（首次读取时分配）
+        
+        PooledSocket() : sockfd(-1), reading(false) {}
+    };
+    
     int timeout_ms_;
-    int retry_count_;
+    RetryPolicy retry_policy_;
+    size_t pool_size_;
+    ResolverMetrics* metrics_;
+    std::vector<std::unique_ptr<PooledSocket>> sockets_;
+    std::mutex pool_mutex_;
+    std::unique_ptr<DnsTcpTransport> tcp_;
     
-    // 创建UDP socket
-    int createSocket();
+    // 随机选取一个池中的socket，池中有多个socket时避开previous
+    PooledSocket* acquireSocket(PooledSocket* previous = nullptr);
     
     // 发送数据
-    bool sendData(int sockfd, const std::vector<uint8_t>& data, 
-                  const std::string& server, uint16_t port);
+    bool sendData(int sockfd, const std::vector<uint8_t>& data,
+                  const struct sockaddr_in& server_addr);
+    
+    // 在socket上注册等待者，返回实际要发送的数据包（需持有sock.mutex）
+    const std::vector<uint8_t>* registerWaiter(PooledSocket& sock, Waiter& waiter,
+                                               const std::vector<uint8_t>& packet,
+                                               std::vector<uint8_t>& rewritten);
+    
+    // 接收数据，直到所有（any为true时任一）等待者的响应到达或超时，unregister为true时返回前注销等待者
+    void receiveData(PooledSocket& sock, std::vector<Waiter*>& waiters, int timeout_ms,
+                     bool any = false, bool unregister = true);
+    
+    // 读取socket中所有已到达的数据报（调用方需持有读取权）
+    static void readDatagrams(PooledSocket& sock,
+                              std::vector<std::pair<struct sockaddr_in, std::vector<uint8_t>>>& datagrams);
     
-    // 接收数据
-    std::vector<uint8_t> receiveData(int sockfd, int timeout_ms);
+    // 将读取到的数据报分发给等待者（需持有sock.mutex）
+    void dispatch(PooledSocket& sock, std::vector<std::pair<struct sockaddr_in, std::vector<uint8_t>>>& datagrams);
 };
 
-} // namespace zjpdns 
\ No newline at end of file
+} // namespace zjpdns
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "dns_parser.h"
+#include "dns_rdata.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zjpdns {
+
+// 压缩指针最大跳转次数，防止恶意数据包构造指针环
+#define DNS_MAX_POINTER_HOPS 32
+
+// 域名视图：指向数据包中的编码域名，不复制数据，按需解码
+class DnsNameView {
+public:
+    DnsNameView() : packet_(nullptr), length_(0), offset_(0) {}
+    DnsNameView(const uint8_t* packet, size_t length, size_t offset)
+        : packet_(packet), length_(length), offset_(offset) {}
+
+    // 域名在数据包中的偏移
+    size_t offset() const { return offset_; }
+
+    // 解码为字符串（与decodeDomain格式一致，以点结尾）
+    std::string toString() const;
+
+    // 解码到调用方提供的缓冲区，返回写入长度，失败或空间不足时返回0
+    size_t decode(char* out, size_t capacity) const;
+
+    // 与普通域名比较（不区分大小写，忽略末尾的点）
+    bool equals(std::string_view name) const;
+
+    // 依次访问每个标签，fn(const uint8_t* label, uint8_t length)返回false时停止
+    // 返回域名是否完整有效
+    template <typename Fn>
+    bool forEachLabel(Fn&& fn) const {
+        if (!packet_) return false;
+
+        size_t offset = offset_;
+        int hops = 0;
+        while (offset < length_) {
+            uint8_t label_length = packet_[offset];
+            if (label_length == 0) {
+                return true;
+            }
+
+            if ((label_length & 0xC0) == 0xC0) {
+                if (offset + 1 >= length_ || ++hops > DNS_MAX_POINTER_HOPS) return false;
+                offset = (static_cast<size_t>(label_length & 0x3F) << 8) | packet_[offset + 1];
+                continue;
+            }
+
+            if ((label_length & 0xC0) != 0 || offset + 1 + label_length > length_) {
+                return false;
+            }
+            if (!fn(packet_ + offset + 1, label_length)) {
+                return true;
+            }
+            offset += 1 + label_length;
+        }
+        return false;
+    }
+
+private:
+    const uint8_t* packet_;
+    size_t length_;
+    size_t offset_;
+};
+
+// 问题视图
+struct DnsQuestionView {
+    DnsNameView name;
+    uint16_t type;
+    uint16_t class_;
+    size_t offset;          // 问题在数据包中的偏移
+
+    DnsRecordType recordType() const { return static_cast<DnsRecordType>(type); }
+};
+
+// 资源记录视图
+struct DnsRecordView {
+    DnsNameView name;
+    uint16_t type;
+    uint16_t class_;
+    uint32_t ttl;
+    size_t offset;          // 记录在数据包中的偏移
+    size_t rdata_offset;    // RDATA在数据包中的偏移
+    uint16_t rdata_length;
+    const uint8_t* rdata;   // 指向数据包中的RDATA
+    const uint8_t* packet;  // 所在数据包，RDATA中的压缩域名据此解析
+    size_t packet_length;
+
+    DnsRecordType recordType() const { return static_cast<DnsRecordType>(type); }
+
+    // 按需解码RDATA，记录类型不符或数据格式错误时返回false
+    bool mx(MxData& out) const {
+        return recordType() == DnsRecordType::MX &&
+               rdata::decodeMx(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+    bool srv(SrvData& out) const {
+        return recordType() == DnsRecordType::SRV &&
+               rdata::decodeSrv(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+    bool soa(SoaData& out) const {
+        return recordType() == DnsRecordType::SOA &&
+               rdata::decodeSoa(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+    bool txt(TxtData& out) const {
+        return recordType() == DnsRecordType::TXT &&
+               rdata::decodeTxt(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+    bool caa(CaaData& out) const {
+        return recordType() == DnsRecordType::CAA &&
+               rdata::decodeCaa(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+
+    // CNAME/NS/PTR记录的目标域名
+    bool target(std::string& out) const {
+        DnsRecordType t = recordType();
+        return (t == DnsRecordType::CNAME || t == DnsRecordType::NS || t == DnsRecordType::PTR) &&
+               rdata::decodeName(packet, packet_length, rdata_offset, rdata_length, out);
+    }
+};
+
+// DNS数据包视图：在原始字节上直接解析，不持有也不复制数据
+// 构造时只做一次结构校验并记录各部分偏移，问题和记录通过迭代器按需解析
+class DnsPacketView {
+public:
+    DnsPacketView(const uint8_t* data, size_t length);
+    explicit DnsPacketView(const std::vector<uint8_t>& data)
+        : DnsPacketView(data.data(), data.size()) {}
+
+    // 数据包结构是否完整有效
+    bool valid() const { return valid_; }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return length_; }
+
+    // 头部字段
+    uint16_t id() const { return read16(0); }
+    uint16_t flags() const { return read16(2); }
+    uint16_t qdcount() const { return read16(4); }
+    uint16_t ancount() const { return read16(6); }
+    uint16_t nscount() const { return read16(8); }
+    uint16_t arcount() const { return read16(10); }
+    bool isResponse() const { return (flags() & 0x8000) != 0; }
+    bool isTruncated() const { return (flags() & 0x0200) != 0; }
+    uint8_t rcode() const { return flags() & 0x000F; }
+
+    // 问题迭代器
+    class QuestionIterator {
+    public:
+        QuestionIterator(const DnsPacketView* view, size_t offset, size_t remaining)
+            : view_(view), offset_(offset), remaining_(remaining) {}
+
+        DnsQuestionView operator*() const { return view_->questionAt(offset_); }
+        QuestionIterator& operator++();
+        bool operator==(const QuestionIterator& other) const { return remaining_ == other.remaining_; }
+        bool operator!=(const QuestionIterator& other) const { return remaining_ != other.remaining_; }
+
+    private:
+        const DnsPacketView* view_;
+        size_t offset_;
+        size_t remaining_;
+    };
+
+    // 资源记录迭代器
+    class RecordIterator {
+    public:
+        RecordIterator(const DnsPacketView* view, size_t offset, size_t remaining)
+            : view_(view), offset_(offset), remaining_(remaining) {}
+
+        DnsRecordView operator*() const { return view_->recordAt(offset_); }
+        RecordIterator& operator++();
+        bool operator==(const RecordIterator& other) const { return remaining_ == other.remaining_; }
+        bool operator!=(const RecordIterator& other) const { return remaining_ != other.remaining_; }
+
+    private:
+        const DnsPacketView* view_;
+        size_t offset_;
+        size_t remaining_;
+    };
+
+    template <typename Iterator>
+    struct Range {
+        Iterator first;
+        Iterator last;
+
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+    };
+
+    Range<QuestionIterator> questions() const;
+    Range<RecordIterator> answers() const;
+    Range<RecordIterator> authorities() const;
+    Range<RecordIterator> additionals() const;
+
+    // 解析指定偏移处的问题和记录
+    DnsQuestionView questionAt(size_t offset) const;
+    DnsRecordView recordAt(size_t offset) const;
+
+    // 跳过指定偏移处的编码域名，返回域名之后的偏移，格式错误时返回0
+    static size_t skipName(const uint8_t* data, size_t length, size_t offset);
+
+private:
+    const uint8_t* data_;
+    size_t length_;
+    bool valid_;
+    size_t answers_offset_;
+    size_t authorities_offset_;
+    size_t additionals_offset_;
+
+    uint16_t read16(size_t offset) const {
+        return length_ >= offset + 2
+            ? static_cast<uint16_t>((data_[offset] << 8) | data_[offset + 1]) : 0;
+    }
+
+    // 跳过count条资源记录，格式错误时返回0
+    size_t skipRecords(size_t offset, size_t count) const;
+
+    Range<RecordIterator> recordRange(size_t offset, uint16_t count) const;
+};
+
+} // namespace zjpdns
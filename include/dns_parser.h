@@ -8,6 +8,13 @@
 
 namespace zjpdns {
 
+#define DNS_RETRY_COUNT 3               // 默认重传次数
+#define DNS_RETRY_INITIAL_TIMEOUT 400   // 第一次尝试的默认超时（毫秒）
+#define DNS_RETRY_BACKOFF 2.0           // 每次重传超时的倍数
+#define DNS_RETRY_JITTER 0.2            // 每次超时的随机抖动比例
+#define DNS_DUAL_GRACE_DELAY 50         // 双栈解析中第一个地址族应答后等待另一个的时间（毫秒，RFC 8305）
+#define DNS_TASK_QUEUE_LIMIT 65536      // 异步解析器默认最多排队等待工作线程的任务数
+
 // DNS记录类型
 enum class DnsRecordType : uint16_t {
     A = 1,           // IPv4地址
@@ -19,6 +26,8 @@ enum class DnsRecordType : uint16_t {
     PTR = 12,        // 指针记录
     SOA = 6,         // 起始授权
     SRV = 33,        // 服务记录
+    OPT = 41,        // EDNS(0)伪记录
+    ANY = 255,       // 所有类型（系统解析时表示同时返回IPv4和IPv6地址）
     CAA = 257        // 证书颁发机构授权
 };
 
@@ -32,20 +41,108 @@ enum class DnsRecordClass : uint16_t {
 
 // DNS解析方式
 enum class ResolveMethod {
-    GETHOSTBYNAME,   // 使用gethostbyname
+    GETHOSTBYNAME,   // 使用系统解析器（getaddrinfo，按记录类型返回IPv4/IPv6地址）
     DNS_PACKET,      // 使用DNS数据包
     CUSTOM_PACKET    // 使用自定义DNS数据包
 };
 
+// 异步任务的优先级：工作线程总是先执行排队的交互式任务
+enum class TaskPriority {
+    INTERACTIVE = 0, // 有调用方在等待结果的查询（默认）
+    BULK = 1         // 预取、批量刷新等可以延后的查询
+};
+
+// 任务队列已满时的处理方式
+enum class OverloadPolicy {
+    BLOCK,           // 提交线程等待队列有空位（工作线程中提交时按FAIL处理，避免死锁）
+    FAIL,            // 新任务立即以过载错误结束
+    DROP_OLDEST      // 丢弃最低优先级中最早排队的任务，为新任务腾出位置
+};
+
+// MX记录数据
+struct MxData {
+    uint16_t preference;
+    std::string exchange;
+    
+    MxData() : preference(0) {}
+};
+
+// SRV记录数据
+struct SrvData {
+    uint16_t priority;
+    uint16_t weight;
+    uint16_t port;
+    std::string target;
+    
+    SrvData() : priority(0), weight(0), port(0) {}
+};
+
+// SOA记录数据
+struct SoaData {
+    std::string mname;      // 主名称服务器
+    std::string rname;      // 管理员邮箱
+    uint32_t serial;
+    uint32_t refresh;
+    uint32_t retry;
+    uint32_t expire;
+    uint32_t minimum;
+    
+    SoaData() : serial(0), refresh(0), retry(0), expire(0), minimum(0) {}
+};
+
+// TXT记录数据
+struct TxtData {
+    std::vector<std::string> strings;
+};
+
+// CAA记录数据
+struct CaaData {
+    uint8_t flags;
+    std::string tag;
+    std::string value;
+    
+    CaaData() : flags(0) {}
+};
+
 // DNS记录结构
 struct DnsRecord {
     std::string name;
     DnsRecordType type;
     DnsRecordClass class_;
     uint32_t ttl;
-    std::string data;
+    std::string data;       // RDATA，解析响应时其中的压缩域名已展开
     
     DnsRecord() : type(DnsRecordType::A), class_(DnsRecordClass::IN), ttl(0) {}
+    
+    // 按需解码RDATA，记录类型不符或数据格式错误时返回false
+    bool mx(MxData& out) const;
+    bool srv(SrvData& out) const;
+    bool soa(SoaData& out) const;
+    bool txt(TxtData& out) const;
+    bool caa(CaaData& out) const;
+    
+    // CNAME/NS/PTR记录的目标域名
+    bool target(std::string& out) const;
+};
+
+// EDNS(0)选项
+struct EdnsOption {
+    uint16_t code;
+    std::string data;
+    
+    EdnsOption() : code(0) {}
+    EdnsOption(uint16_t code, const std::string& data) : code(code), data(data) {}
+};
+
+// EDNS(0)信息（OPT伪记录）
+struct EdnsInfo {
+    bool present;                        // 响应中是否带有OPT记录
+    uint16_t payload_size;               // 对端通告的UDP负载大小
+    uint8_t version;
+    bool dnssec_ok;                      // DO位
+    std::vector<EdnsOption> options;
+    
+    EdnsInfo() : present(false), payload_size(0), version(0), dnssec_ok(false) {}
 };
 
 // DNS解析结果
@@ -53,10 +150,15 @@ struct DnsResult {
     std::vector<std::string> domains;
     std::vector<std::string> addresses;  // IP地址列表
     std::vector<DnsRecord> records;      // 完整DNS记录
+    std::vector<DnsRecord> authorities;  // 权威记录（否定应答时包含SOA）
     bool success;
+    uint16_t rcode;                      // 响应码，含EDNS扩展位（0: NOERROR, 3: NXDOMAIN）
+    bool truncated;                      // TC位，应答被截断
+    EdnsInfo edns;
+    bool overloaded;                     // 解析器过载，任务被拒绝或丢弃，没有发送查询
     std::string error_message;
     
-    DnsResult() : success(false) {}
+    DnsResult() : success(false), rcode(0), truncated(false), overloaded(false) {}
 };
 
 // DNS数据包结构
@@ -75,6 +177,41 @@ struct DnsPacket {
     DnsPacket() : id(0), flags(0), qdcount(0), ancount(0), nscount(0), arcount(0) {}
 };
 
+// 批量解析中的单个查询
+struct DnsQuery {
+    std::string domain;
+    DnsRecordType type;
+    
+    DnsQuery() : type(DnsRecordType::A) {}
+    DnsQuery(const std::string& domain, DnsRecordType type = DnsRecordType::A)
+        : domain(domain), type(type) {}
+};
+
+// 上游DNS服务器
+struct DnsServer {
+    std::string address;
+    uint16_t port;
+    
+    DnsServer() : port(53) {}
+    DnsServer(const std::string& address, uint16_t port = 53) : address(address), port(port) {}
+};
+
+// UDP重传策略：总超时被拆分为多次尝试，每次尝试的超时按backoff指数增长并加上随机抖动，
+// 最后一次尝试使用剩余的全部时间；每次重传更换事务ID和源端口
+struct RetryPolicy {
+    int retries;               // 超时后的重传次数（0表示不重传）
+    int initial_timeout_ms;    // 第一次尝试的超时
+    double backoff;            // 每次重传超时的倍数
+    double jitter;             // 超时的随机抖动比例（0~1）
+    
+    RetryPolicy()
+        : retries(DNS_RETRY_COUNT), initial_timeout_ms(DNS_RETRY_INITIAL_TIMEOUT),
+          backoff(DNS_RETRY_BACKOFF), jitter(DNS_RETRY_JITTER) {}
+    
+    // 把总超时拆分为每次尝试的超时，总和等于timeout_ms
+    std::vector<int> attemptTimeouts(int timeout_ms) const;
+};
+
 // DNS解析器接口
 class DnsResolver {
 public:
@@ -88,11 +225,33 @@ public:
     // 使用自定义DNS数据包解析
     virtual DnsResult resolveWithPacket(const DnsPacket& packet) = 0;
     
+    // 批量解析（DNS数据包方式，sendmmsg/recvmmsg收发），结果与输入顺序一致
+    virtual std::vector<DnsResult> resolveBatch(const std::vector<DnsQuery>& queries) = 0;
+    
+    // 双栈解析：同时发送AAAA和A查询，合并为一个结果（地址按IPv6、IPv4交替排列）；
+    // 第一个地址族返回地址后最多再等待grace_ms，另一个仍未应答时只返回已有的地址
+    virtual DnsResult resolveDual(const std::string& domain, int grace_ms = DNS_DUAL_GRACE_DELAY) = 0;
+    
     // 设置DNS服务器
     virtual void setDnsServer(const std::string& server, uint16_t port = 53) = 0;
     
+    // 设置多个上游服务器，每个查询发给平滑RTT和失败记录最好的服务器
+    virtual void setDnsServers(const std::vector<DnsServer>& servers) = 0;
+    
+    // 开启竞速查询：首选服务器在自适应延迟内没有应答时，同时向次选服务器发送，取先到达的应答
+    virtual void setHedging(bool enabled) = 0;
+    
+    // 设置UDP重传策略
+    virtual void setRetryPolicy(const RetryPolicy& policy) = 0;
+    
     // 设置超时时间
     virtual void setTimeout(int timeout_ms) = 0;
+    
+    // 设置应答缓存大小（0表示关闭缓存）
+    virtual void setCacheSize(size_t max_entries) = 0;
+    
+    // 设置EDNS(0)通告的UDP负载大小（默认1232，0表示不发送OPT记录）
+    virtual void setEdnsPayloadSize(uint16_t payload_size) = 0;
 };
 
 // 异步DNS解析器接口
@@ -103,30 +262,67 @@ public:
     // 异步解析接口
     virtual std::future<DnsResult> resolveAsync(const std::string& domain,
                                                DnsRecordType type = DnsRecordType::A,
-                                               ResolveMethod method = ResolveMethod::GETHOSTBYNAME) = 0;
+                                               ResolveMethod method = ResolveMethod::GETHOSTBYNAME,
+                                               TaskPriority priority = TaskPriority::INTERACTIVE) = 0;
     
     // 使用自定义DNS数据包异步解析
     virtual std::future<DnsResult> resolveWithPacketAsync(const DnsPacket& packet) = 0;
     
+    // 异步批量解析（DNS数据包方式，sendmmsg/recvmmsg收发），结果与输入顺序一致
+    virtual std::future<std::vector<DnsResult>> resolveBatchAsync(const std::vector<DnsQuery>& queries,
+                                                                  TaskPriority priority = TaskPriority::INTERACTIVE) = 0;
+    
+    // 异步双栈解析，与同步接口相同
+    virtual std::future<DnsResult> resolveDualAsync(const std::string& domain,
+                                                    int grace_ms = DNS_DUAL_GRACE_DELAY) = 0;
+    
     // 使用自定义DNS数据包异步解析（回调方式）
     virtual void resolveWithPacketCallback(const DnsPacket& packet,
                                          std::function<void(const DnsResult&)> callback) = 0;
     
-    // 回调式异步解析
+    // 回调式异步解析（任务被拒绝时回调可能在提交线程中调用）
     virtual void resolveWithCallback(const std::string& domain,
                                    std::function<void(const DnsResult&)> callback,
                                    DnsRecordType type = DnsRecordType::A,
-                                   ResolveMethod method = ResolveMethod::GETHOSTBYNAME) = 0;
+                                   ResolveMethod method = ResolveMethod::GETHOSTBYNAME,
+                                   TaskPriority priority = TaskPriority::INTERACTIVE) = 0;
+    
+    // 直接完成的解析（DNS数据包方式）：complete(context, result)在事件循环线程中调用（缓存命中或出错时在调用线程中调用），
+    // UDP应答不经过工作线程（截断后改用的TCP查询在工作线程中执行，应答再交回事件循环线程），也不分配future/promise；
+    // 不与其他在途查询合并。回调中不应阻塞。供协程等适配层使用
+    using DirectCompletion = void (*)(void* context, const DnsResult& result);
+    virtual void resolveDirect(const std::string& domain, DnsRecordType type,
+                               DirectCompletion complete, void* context) = 0;
     
     // 设置DNS服务器
     virtual void setDnsServer(const std::string& server, uint16_t port = 53) = 0;
     
+    // 设置多个上游服务器，每个查询发给平滑RTT和失败记录最好的服务器
+    virtual void setDnsServers(const std::vector<DnsServer>& servers) = 0;
+    
+    // 开启竞速查询：首选服务器在自适应延迟内没有应答时，同时向次选服务器发送，取先到达的应答
+    virtual void setHedging(bool enabled) = 0;
+    
+    // 设置UDP重传策略
+    virtual void setRetryPolicy(const RetryPolicy& policy) = 0;
+    
     // 设置超时时间
     virtual void setTimeout(int timeout_ms) = 0;
+    
+    // 设置应答缓存大小（0表示关闭缓存）
+    virtual void setCacheSize(size_t max_entries) = 0;
+    
+    // 设置EDNS(0)通告的UDP负载大小（默认1232，0表示不发送OPT记录）
+    virtual void setEdnsPayloadSize(uint16_t payload_size) = 0;
+    
+    // 设置排队任务数上限（默认DNS_TASK_QUEUE_LIMIT）和队列满时的处理方式，
+    // 被拒绝或丢弃的任务以overloaded结果结束；resolveDirect不经过任务队列
+    virtual void setQueueLimit(size_t max_tasks, OverloadPolicy policy = OverloadPolicy::FAIL) = 0;
 };
 
 // 工厂函数
 std::unique_ptr<DnsResolver> createDnsResolver();
-std::unique_ptr<AsyncDnsResolver> createAsyncDnsResolver();
+// thread_count: 异步解析器的工作线程数
+std::unique_ptr<AsyncDnsResolver> createAsyncDnsResolver(size_t thread_count = 1);
 
 } // namespace zjpdns 
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace zjpdns {
+namespace pmr {
+
+// 使用std::pmr分配器的DNS结构，成员内存全部来自构造时传入的memory_resource
+// 批量解析时可以把一批数据包解析到同一个monotonic_buffer_resource中，一次性释放
+
+// DNS记录结构
+struct DnsRecord {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    std::pmr::string name;
+    DnsRecordType type;
+    DnsRecordClass class_;
+    uint32_t ttl;
+    std::pmr::string data;
+
+    explicit DnsRecord(const allocator_type& alloc = {})
+        : name(alloc), type(DnsRecordType::A), class_(DnsRecordClass::IN), ttl(0), data(alloc) {}
+    DnsRecord(const DnsRecord& other, const allocator_type& alloc)
+        : name(other.name, alloc), type(other.type), class_(other.class_), ttl(other.ttl),
+          data(other.data, alloc) {}
+    DnsRecord(DnsRecord&& other, const allocator_type& alloc)
+        : name(std::move(other.name), alloc), type(other.type), class_(other.class_), ttl(other.ttl),
+          data(std::move(other.data), alloc) {}
+    DnsRecord(const DnsRecord& other) = default;
+    DnsRecord(DnsRecord&& other) = default;
+    DnsRecord& operator=(const DnsRecord& other) = default;
+    DnsRecord& operator=(DnsRecord&& other) = default;
+};
+
+// DNS解析结果
+struct DnsResult {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    std::pmr::vector<std::pmr::string> domains;
+    std::pmr::vector<std::pmr::string> addresses;  // IP地址列表
+    std::pmr::vector<DnsRecord> records;           // 完整DNS记录
+    std::pmr::vector<DnsRecord> authorities;       // 权威记录
+    bool success;
+    uint16_t rcode;                                // 响应码，含EDNS扩展位
+    bool truncated;                                // TC标志
+    std::pmr::string error_message;
+
+    explicit DnsResult(const allocator_type& alloc = {})
+        : domains(alloc), addresses(alloc), records(alloc), authorities(alloc),
+          success(false), rcode(0), truncated(false), error_message(alloc) {}
+};
+
+// DNS数据包结构
+struct DnsPacket {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+    std::pmr::vector<std::pmr::string> questions;
+    std::pmr::vector<DnsRecord> answers;
+    std::pmr::vector<DnsRecord> authorities;
+    std::pmr::vector<DnsRecord> additionals;
+
+    explicit DnsPacket(const allocator_type& alloc = {})
+        : id(0), flags(0), qdcount(0), ancount(0), nscount(0), arcount(0),
+          questions(alloc), answers(alloc), authorities(alloc), additionals(alloc) {}
+};
+
+} // namespace pmr
+} // namespace zjpdns
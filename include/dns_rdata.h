@@ -0,0 +1,25 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace zjpdns {
+namespace rdata {
+
+// RDATA解码：rdata_offset/rdata_length指定RDATA在数据包中的位置，
+// 其中的域名（可能是压缩指针）在整个数据包范围内解析，结果以点结尾，与decodeDomain一致
+// 数据格式错误或越过RDATA末尾时返回false
+
+bool decodeMx(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, MxData& out);
+bool decodeSrv(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, SrvData& out);
+bool decodeSoa(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, SoaData& out);
+bool decodeTxt(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, TxtData& out);
+bool decodeCaa(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, CaaData& out);
+
+// CNAME/NS/PTR等RDATA只含一个域名的记录
+bool decodeName(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, std::string& out);
+
+} // namespace rdata
+} // namespace zjpdns
@@ -2,6 +2,9 @@
 
 #include "dns_parser.h"
 #include "dns_packet.h"
+#include "dns_cache.h"
+#include "dns_upstream.h"
+#include "dns_metrics.h"
 #include <string>
 #include <memory>
 
@@ -25,26 +28,68 @@ public:
     // 使用自定义DNS数据包解析
     DnsResult resolveWithPacket(const DnsPacket& packet) override;
     
+    // 批量解析
+    std::vector<DnsResult> resolveBatch(const std::vector<DnsQuery>& queries) override;
+    
+    // 双栈解析
+    DnsResult resolveDual(const std::string& domain, int grace_ms = DNS_DUAL_GRACE_DELAY) override;
+    
     // 设置DNS服务器
     void setDnsServer(const std::string& server, uint16_t port = 53) override;
     
+    // 设置多个上游服务器
+    void setDnsServers(const std::vector<DnsServer>& servers) override;
+    
+    // 开启竞速查询
+    void setHedging(bool enabled) override;
+    
+    // 设置UDP重传策略
+    void setRetryPolicy(const RetryPolicy& policy) override;
+    
     // 设置超时时间
     void setTimeout(int timeout_ms) override;
+    
+    // 设置应答缓存大小（0表示关闭缓存）
+    void setCacheSize(size_t max_entries) override;
+    
+    // 设置EDNS(0)通告的UDP负载大小（0表示不发送OPT记录）
+    void setEdnsPayloadSize(uint16_t payload_size) override;
+    
+    // 验证域名格式
+    static bool isValidDomain(const std::string& domain);
+    
+    // 将EDNS负载大小限制在[512, DNS_UDP_BUFFER_SIZE]，0保持不变
+    static uint16_t clampEdnsPayloadSize(uint16_t payload_size);
+    
+    // 服务器不支持EDNS：带OPT的查询返回FORMERR/NOTIMP且应答中没有OPT记录，应去掉OPT重试
+    static bool needsEdnsFallback(const DnsResult& result);
+    
+    // 合并AAAA和A的结果：地址按IPv6、IPv4交替排列（RFC 8305），任一成功即为成功
+    static DnsResult mergeDualResults(const DnsResult& aaaa, const DnsResult& a);
+    
+    // 应答中包含地址
+    static bool hasAddresses(const DnsResult& result);
+    
+    // 本实例的指标（同时登记在MetricsRegistry中）
+    std::shared_ptr<ResolverMetrics> metrics() const { return metrics_; }
 
 private:
-    std::string dns_server_;
-    uint16_t dns_port_;
+    std::shared_ptr<ResolverMetrics> metrics_;
+    UpstreamSelector upstreams_;
+    bool hedging_;
     int timeout_ms_;
+    uint16_t edns_payload_size_;
     std::unique_ptr<DnsPacketSender> sender_;
+    std::unique_ptr<DnsCache> cache_;
     
-    // 使用gethostbyname解析
-    DnsResult resolveWithGethostbyname(const std::string& domain);
+    // 使用系统解析器（getaddrinfo）解析
+    DnsResult resolveWithSystem(const std::string& domain, DnsRecordType type);
     
     // 使用DNS数据包解析
     DnsResult resolveWithDnsPacket(const std::string& domain, DnsRecordType type);
     
-    // 验证域名格式
-    bool isValidDomain(const std::string& domain);
+    // 把数据包发给最好的上游服务器（开启竞速时同时使用次选服务器），并记录RTT
+    DnsResult sendToUpstream(const std::vector<uint8_t>& packet);
     
     // 获取默认DNS服务器
     std::string getDefaultDnsServer();
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+namespace zjpdns {
+namespace simd {
+
+// 域名扫描内核：一次遍历完成字符集校验、标签边界查找、标签长度检查，并可同时输出小写形式
+// x86-64上运行时选择AVX2或SSE2实现，其他平台使用标量实现
+//
+// 校验规则与DnsResolverImpl::isValidDomain一致：长度1~253，只含字母、数字、'-'和'.'，
+// 不以点开头或结尾，没有空标签，每个标签不超过63字节
+
+enum class Kernel { SCALAR, SSE2, AVX2 };
+
+// 使用当前平台最快的内核扫描域名，lowered不为空时写入length字节的小写结果
+bool scanDomain(const char* name, size_t length, char* lowered = nullptr);
+
+// 使用指定内核扫描域名（平台不支持时退回标量实现），用于测试和基准对比
+bool scanDomain(Kernel kernel, const char* name, size_t length, char* lowered = nullptr);
+
+// ASCII小写转换（不做校验），用于缓存键
+void toLowerAscii(const char* in, size_t length, char* out);
+void toLowerAscii(Kernel kernel, const char* in, size_t length, char* out);
+
+// 当前平台选择的内核
+Kernel activeKernel();
+
+// 内核名称
+const char* kernelName(Kernel kernel);
+
+} // namespace simd
+} // namespace zjpdns
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zjpdns {
+
+#define DNS_SYSTEM_RESOLVER_THREADS 8   // 系统解析线程数上限
+#define DNS_SYSTEM_RESOLVER_TTL 300     // 系统解析不提供TTL，记录使用的默认TTL（秒）
+
+// 系统解析器（getaddrinfo，遵循/etc/hosts和nsswitch配置）
+// getaddrinfo可重入，多个查询在有界线程池中并发执行；线程在有查询排队且没有空闲线程时按需创建，不超过thread_count个
+class SystemResolver {
+public:
+    using Completion = std::function<void(const DnsResult&)>;
+
+    explicit SystemResolver(size_t thread_count = DNS_SYSTEM_RESOLVER_THREADS);
+    ~SystemResolver();
+
+    SystemResolver(const SystemResolver&) = delete;
+    SystemResolver& operator=(const SystemResolver&) = delete;
+
+    // 在调用线程中解析：A只返回IPv4地址，AAAA只返回IPv6地址，其他类型同时返回两个地址族
+    static DnsResult lookup(const std::string& domain, DnsRecordType type);
+
+    // 提交到线程池解析，completion在解析线程中调用（线程安全）；停止后在调用线程中直接解析
+    void resolve(const std::string& domain, DnsRecordType type, Completion completion);
+
+    // 允许再次提交（停止后重新启动）
+    void start();
+
+    // 停止线程池，已提交的查询会全部执行完毕
+    void stop();
+
+    // 当前线程数
+    size_t threadCount();
+
+private:
+    struct Job {
+        std::string domain;
+        DnsRecordType type;
+        Completion completion;
+    };
+
+    size_t max_threads_;
+    std::vector<std::thread> threads_;
+    std::deque<Job> jobs_;
+    size_t idle_;
+    bool stopped_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // 解析线程函数
+    void workerThread();
+};
+
+} // namespace zjpdns
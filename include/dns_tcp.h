@@ -0,0 +1,88 @@
+#pragma once
+
+#include "dns_parser.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+namespace zjpdns {
+
+#define DNS_TCP_READ_BUFFER_SIZE 65536  // 单次从TCP连接读取的最大字节数
+
+// DNS over TCP传输（RFC 7766）
+// 每个服务器维护一条长期连接，消息以2字节长度前缀分帧；多个查询可在同一连接上流水线发送，
+// 响应可能乱序到达，按(事务ID, 问题)分发给对应的等待者。连接被服务器关闭后下次查询自动重连
+class DnsTcpTransport {
+public:
+    DnsTcpTransport();
+    ~DnsTcpTransport();
+
+    DnsTcpTransport(const DnsTcpTransport&) = delete;
+    DnsTcpTransport& operator=(const DnsTcpTransport&) = delete;
+
+    // 通过TCP发送一个查询
+    DnsResult query(const std::string& server, uint16_t port,
+                    const std::vector<uint8_t>& packet, int timeout_ms);
+
+    // 在同一连接上流水线发送一组查询，结果与输入顺序一致
+    std::vector<DnsResult> queryBatch(const std::string& server, uint16_t port,
+                                      const std::vector<std::vector<uint8_t>>& packets,
+                                      int timeout_ms);
+
+    // 当前保持的连接数
+    size_t connectionCount();
+
+    // 关闭所有连接
+    void closeAll();
+
+private:
+    // 等待响应的查询
+    struct Waiter {
+        std::string key;
+        std::vector<uint8_t> response;
+        bool done;
+        bool failed;    // 连接在响应到达前断开
+
+        Waiter() : done(false), failed(false) {}
+    };
+
+    // 到某个服务器的连接
+    struct Connection {
+        int sockfd;
+        bool reading;                       // 是否已有线程在读取该连接
+        bool broken;                        // 连接已断开，不再使用
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<std::string, Waiter*> waiters;
+        std::vector<uint8_t> stream;        // 尚未组成完整消息的数据（仅读取线程访问）
+        std::mutex write_mutex;             // 串行化多个线程的写入，避免消息交错
+
+        Connection() : sockfd(-1), reading(false), broken(false) {}
+        ~Connection();
+    };
+
+    std::unordered_map<std::string, std::shared_ptr<Connection>> connections_;
+    std::mutex mutex_;
+
+    // 获取到服务器的连接，没有可用连接时新建；reused表示是否复用了已有连接
+    std::shared_ptr<Connection> acquireConnection(const std::string& server, uint16_t port,
+                                                  int timeout_ms, bool& reused);
+
+    // 非阻塞连接服务器，超时或失败返回-1
+    static int connectServer(const std::string& server, uint16_t port, int timeout_ms);
+
+    // 注册等待者并发送所有查询，失败时注销等待者
+    bool sendQueries(Connection& conn, const std::vector<const std::vector<uint8_t>*>& packets,
+                     std::vector<Waiter*>& waiters, int timeout_ms);
+
+    // 接收响应，直到所有等待者完成、连接断开或超时，返回前注销等待者
+    void receiveData(Connection& conn, std::vector<Waiter*>& waiters, int timeout_ms);
+
+    // 读取连接上已到达的数据并拆分出完整消息，连接关闭或出错时返回false
+    static bool readMessages(Connection& conn, std::vector<std::vector<uint8_t>>& messages);
+};
+
+} // namespace zjpdns
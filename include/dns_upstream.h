@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dns_parser.h"
+#include "dns_metrics.h"
+#include <vector>
+#include <string>
+#include <mutex>
+
+namespace zjpdns {
+
+#define DNS_UPSTREAM_SRTT_DECAY 0.98        // 未被选中的服务器每次选择后SRTT的衰减系数
+#define DNS_UPSTREAM_FAILURE_PENALTY 200    // 失败时SRTT增加的毫秒数（在翻倍之后）
+#define DNS_UPSTREAM_MAX_SRTT 10000         // SRTT上限（毫秒）
+#define DNS_HEDGE_DEFAULT_DELAY 100         // 首选服务器尚无RTT样本时的竞速延迟（毫秒）
+#define DNS_HEDGE_MIN_DELAY 5               // 竞速延迟下限（毫秒）
+
+// 上游服务器选择器（线程安全）
+// 每个服务器维护平滑RTT（SRTT）、RTT偏差和连续失败次数，总是选择SRTT最小的服务器；
+// 失败时SRTT翻倍并加上惩罚值，未被选中的服务器SRTT逐渐衰减，使慢速或失败过的服务器之后仍有机会被重新探测
+class UpstreamSelector {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    explicit UpstreamSelector(const std::vector<DnsServer>& servers = {});
+
+    // 设置指标，RTT样本同时记入每个服务器的直方图（在setServers之前或之后调用均可）
+    void setMetrics(ResolverMetrics* metrics);
+
+    // 替换服务器列表，统计数据重新开始
+    void setServers(const std::vector<DnsServer>& servers);
+    std::vector<DnsServer> servers() const;
+    size_t size() const;
+
+    // 选择SRTT最小的服务器（尚无样本的服务器优先），exclude为排除的下标；没有可选服务器时返回npos
+    size_t select(size_t exclude = npos);
+
+    // 获取服务器地址，下标越界时返回空地址
+    DnsServer server(size_t index) const;
+
+    // 记录一次应答的RTT / 一次失败（超时、SERVFAIL、REFUSED）
+    void reportRtt(size_t index, double rtt_ms);
+    void reportFailure(size_t index);
+
+    // 根据结果记录：服务器故障时记为失败，否则记录RTT
+    void report(size_t index, const DnsResult& result, double rtt_ms);
+
+    // 整批查询只记录一次：全部是服务器故障时记一次失败，否则取最早的有效应答记一个RTT样本
+    // rtts为每个查询从发送到应答到达的毫秒数（与results一一对应）
+    void reportBatch(size_t index, const std::vector<DnsResult>& results, const std::vector<double>& rtts);
+
+    // 竞速延迟：SRTT + 4 * RTT偏差，限制在[DNS_HEDGE_MIN_DELAY, timeout_ms / 2]
+    int hedgeDelay(size_t index, int timeout_ms) const;
+
+    double srtt(size_t index) const;
+    uint32_t failures(size_t index) const;
+
+    // 服务器没有给出有效应答：超时或发送失败、SERVFAIL、REFUSED
+    static bool isServerFailure(const DnsResult& result);
+
+private:
+    struct Upstream {
+        DnsServer server;
+        double srtt;
+        double rttvar;
+        uint32_t samples;
+        uint32_t failures;
+        Histogram* rtt;
+
+        explicit Upstream(const DnsServer& server)
+            : server(server), srtt(0), rttvar(0), samples(0), failures(0), rtt(nullptr) {}
+    };
+
+    std::vector<Upstream> upstreams_;
+    ResolverMetrics* metrics_ = nullptr;
+    mutable std::mutex mutex_;
+};
+
+} // namespace zjpdns
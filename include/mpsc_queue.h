@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+namespace zjpdns {
+
+// 侵入式队列节点，入队的对象继承该结构
+struct MpscNode {
+    std::atomic<MpscNode*> next;
+
+    MpscNode() : next(nullptr) {}
+};
+
+// 侵入式无锁多生产者单消费者队列（Vyukov）
+// 入队只有一次原子交换，任意多个线程可同时入队；出队同一时刻只能由一个线程执行（由调用方保证），
+// 队列不持有节点，节点的分配和释放由调用方负责
+class MpscQueue {
+public:
+    MpscQueue();
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 入队（线程安全，无锁）
+    void push(MpscNode* node);
+
+    // 出队最早的节点；队列为空，或最后一个节点的生产者尚未完成入队时返回nullptr（仅限单个消费者）
+    MpscNode* pop();
+
+private:
+    std::atomic<MpscNode*> head_;   // 最近入队的节点，生产者在此交换
+    MpscNode* tail_;                // 最早入队的节点，只由消费者访问
+    MpscNode stub_;                 // 队列为空时的占位节点
+};
+
+} // namespace zjpdns
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zjpdns {
+
+// 多线程工作窃取执行器
+// 每个工作线程拥有自己的双端队列：本线程从尾部取任务，空闲线程从其他队列头部窃取
+class WorkStealingExecutor {
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkStealingExecutor(size_t thread_count = 1);
+    ~WorkStealingExecutor();
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    // 启动工作线程
+    void start();
+
+    // 停止工作线程，已提交的任务会全部执行完毕
+    void stop();
+
+    // 提交任务（线程安全），执行器停止后任务在调用线程中直接执行
+    void submit(Job job);
+
+    // 工作线程数
+    size_t threadCount() const;
+
+    // 当前线程是否为本执行器的工作线程
+    bool inWorkerThread() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        bool closed;
+        std::thread thread;
+
+        Worker() : closed(false) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_worker_;
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> sleepers_;
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    std::atomic<bool> running_;
+
+    // 工作线程函数
+    void workerThread(size_t index);
+
+    // 从本线程队列尾部取任务
+    bool popLocal(size_t index, Job& job);
+
+    // 从其他线程队列头部窃取任务
+    bool steal(size_t index, Job& job);
+
+    // 唤醒一个空闲线程
+    void notifyIdle();
+};
+
+} // namespace zjpdns
@@ -1,20 +1,43 @@
 #include "async_resolver.h"
 #include "dns_resolver.h"
-#include <chrono>
 
 namespace zjpdns {
 
-AsyncDnsResolverImpl::AsyncDnsResolverImpl() : running_(false) {
-    resolver_ = std::make_unique<DnsResolverImpl>();
+AsyncDnsResolverImpl::AsyncDnsResolverImpl(size_t thread_count)
+    : metrics_(MetricsRegistry::instance().create("async")),
+      upstreams_({DnsServer(DNS_SERVER, DNS_PORT)}), servers_key_(std::string(DNS_SERVER) + ":" + std::to_string(DNS_PORT)),
+      hedging_(false), timeout_ms_(DNS_TIMEOUT),
+      edns_payload_size_(DNS_EDNS_PAYLOAD_SIZE), next_loop_(0), running_(false),
+      queued_count_(0), queue_limit_(DNS_TASK_QUEUE_LIMIT), overload_policy_(OverloadPolicy::FAIL),
+      draining_(false), blocked_(0) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    
+    system_ = std::make_unique<SystemResolver>();
+    executor_ = std::make_unique<WorkStealingExecutor>(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        event_loops_.push_back(std::make_unique<DnsEventLoop>());
+        event_loops_.back()->setMetrics(metrics_.get());
+    }
+    cache_ = std::make_unique<DnsCache>(DNS_CACHE_SIZE);
+    tcp_ = std::make_unique<DnsTcpTransport>();
+    upstreams_.setMetrics(metrics_.get());
 }
 
 AsyncDnsResolverImpl::~AsyncDnsResolverImpl() {
     stop();
+    
+    // 停止时执行请求已取出所有任务，这里只回收残留的节点
+    while (QueuedTask* task = popHighest()) {
+        delete task;
+    }
 }
 
 std::future<DnsResult> AsyncDnsResolverImpl::resolveAsync(const std::string& domain,
                                                          DnsRecordType type,
-                                                         ResolveMethod method) {
+                                                         ResolveMethod method,
+                                                         TaskPriority priority) {
     std::promise<DnsResult> promise;
     std::future<DnsResult> future = promise.get_future();
     
@@ -25,7 +48,7 @@ std::future<DnsResult> AsyncDnsResolverImpl::resolveAsync(const std::string& dom
     task.use_custom_packet = false;
     task.promise = std::move(promise);
     
-    addTask(std::move(task));
+    addTask(std::move(task), priority);
     return future;
 }
 
@@ -42,10 +65,52 @@ std::future<DnsResult> AsyncDnsResolverImpl::resolveWithPacketAsync(const DnsPac
     return future;
 }
 
+std::future<std::vector<DnsResult>> AsyncDnsResolverImpl::resolveBatchAsync(const std::vector<DnsQuery>& queries,
+                                                                            TaskPriority priority) {
+    auto batch = std::make_shared<BatchTask>();
+    batch->queries = queries;
+    batch->results.resize(queries.size());
+    batch->remaining = queries.size();
+    batch->submitted = std::chrono::steady_clock::now();
+    std::future<std::vector<DnsResult>> future = batch->promise.get_future();
+    
+    if (queries.empty()) {
+        batch->promise.set_value(std::vector<DnsResult>());
+        return future;
+    }
+    
+    // 整批作为一个任务排队，被拒绝时所有查询以同一个过载结果结束
+    enqueue(priority, [this, batch]() { executeBatchTask(batch); },
+        [this, batch](const DnsResult& result) {
+            for (size_t i = 0; i < batch->queries.size(); ++i) {
+                batch->results[i] = result;
+                batch->results[i].domains.push_back(batch->queries[i].domain);
+                metrics_->recordResult(batch->results[i], batch->submitted);
+            }
+            batch->promise.set_value(std::move(batch->results));
+        });
+    return future;
+}
+
+std::future<DnsResult> AsyncDnsResolverImpl::resolveDualAsync(const std::string& domain, int grace_ms) {
+    auto dual = std::make_shared<DualTask>();
+    std::future<DnsResult> future = dual->promise.get_future();
+    
+    // 两个查询各自走缓存和在途合并，同时发送
+    const DnsRecordType types[2] = {DnsRecordType::AAAA, DnsRecordType::A};
+    for (size_t i = 0; i < 2; ++i) {
+        resolveWithCallback(domain, [this, dual, i, grace_ms](const DnsResult& result) {
+            completeDualQuery(dual, i, result, grace_ms);
+        }, types[i], ResolveMethod::DNS_PACKET);
+    }
+    return future;
+}
+
 void AsyncDnsResolverImpl::resolveWithCallback(const std::string& domain,
                                              std::function<void(const DnsResult&)> callback,
                                              DnsRecordType type,
-                                             ResolveMethod method) {
+                                             ResolveMethod method,
+                                             TaskPriority priority) {
     Task task;
     task.domain = domain;
     task.type = type;
@@ -53,7 +118,36 @@ void AsyncDnsResolverImpl::resolveWithCallback(const std::string& domain,
     task.use_custom_packet = false;
     task.callback = callback;
     
-    addTask(std::move(task));
+    addTask(std::move(task), priority);
+}
+
+void AsyncDnsResolverImpl::resolveDirect(const std::string& domain, DnsRecordType type,
+                                         DirectCompletion complete, void* context) {
+    DnsResult result;
+    result.domains.push_back(domain);
+    auto start = std::chrono::steady_clock::now();
+    if (!DnsResolverImpl::isValidDomain(domain)) {
+        result.error_message = "无效的域名格式";
+        metrics_->recordResult(result, start);
+        complete(context, result);
+        return;
+    }
+    if (cache_->lookup(domain, type, DnsRecordClass::IN, result)) {
+        metrics_->cache_hits.add();
+        metrics_->recordResult(result, start);
+        complete(context, result);
+        return;
+    }
+    metrics_->cache_misses.add();
+    
+    // 直接在事件循环线程中写入缓存并完成（TCP重查的应答由sendQuery交回事件循环线程）
+    QueryConfig config = loadConfig();
+    sendQuery(config, domain, type, config.edns_payload_size,
+        [this, domain, type, start, complete, context](const DnsResult& response) {
+            cache_->insert(domain, type, DnsRecordClass::IN, response);
+            metrics_->recordResult(response, start);
+            complete(context, response);
+        });
 }
 
 void AsyncDnsResolverImpl::resolveWithPacketCallback(const DnsPacket& packet,
@@ -67,69 +161,439 @@ void AsyncDnsResolverImpl::resolveWithPacketCallback(const DnsPacket& packet,
 }
 
 void AsyncDnsResolverImpl::setDnsServer(const std::string& server, uint16_t port) {
-    if (resolver_) {
-        resolver_->setDnsServer(server, port);
+    setDnsServers({DnsServer(server, port)});
+}
+
+void AsyncDnsResolverImpl::setDnsServers(const std::vector<DnsServer>& servers) {
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        upstreams_.setServers(servers);
+        servers_key_.clear();
+        for (const auto& server : servers) {
+            servers_key_ += server.address + ":" + std::to_string(server.port) + ",";
+        }
     }
+    cache_->clear();
+}
+
+void AsyncDnsResolverImpl::setHedging(bool enabled) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    hedging_ = enabled;
+}
+
+void AsyncDnsResolverImpl::setRetryPolicy(const RetryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    retry_policy_ = policy;
 }
 
 void AsyncDnsResolverImpl::setTimeout(int timeout_ms) {
-    if (resolver_) {
-        resolver_->setTimeout(timeout_ms);
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    timeout_ms_ = timeout_ms;
+}
+
+void AsyncDnsResolverImpl::setCacheSize(size_t max_entries) {
+    cache_->setMaxEntries(max_entries);
+}
+
+void AsyncDnsResolverImpl::setEdnsPayloadSize(uint16_t payload_size) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    edns_payload_size_ = DnsResolverImpl::clampEdnsPayloadSize(payload_size);
+}
+
+void AsyncDnsResolverImpl::setQueueLimit(size_t max_tasks, OverloadPolicy policy) {
+    {
+        std::lock_guard<std::mutex> lock(space_mutex_);
+        queue_limit_ = std::max<size_t>(max_tasks, 1);
+        overload_policy_ = policy;
     }
+    space_cv_.notify_all();
 }
 
 void AsyncDnsResolverImpl::start() {
     if (!running_) {
+        for (auto& loop : event_loops_) {
+            loop->start();
+        }
+        executor_->start();
+        system_->start();
+        
+        // 执行器启动后才把消费权交给新的执行请求，之前提交的任务在执行请求中依次执行
         running_ = true;
-        worker_thread_ = std::thread(&AsyncDnsResolverImpl::workerThread, this);
     }
 }
 
 void AsyncDnsResolverImpl::stop() {
     if (running_) {
         running_ = false;
-        queue_cv_.notify_all();
         
-        if (worker_thread_.joinable()) {
-            worker_thread_.join();
+        // 先执行完已提交的任务，再结束事件循环中的在途查询
+        executor_->stop();
+        system_->stop();
+        for (auto& loop : event_loops_) {
+            loop->stop();
         }
     }
 }
 
-void AsyncDnsResolverImpl::workerThread() {
-    while (running_) {
-        Task task;
+void AsyncDnsResolverImpl::executeTask(std::shared_ptr<Task> task) {
+    if (task->use_custom_packet || task->method == ResolveMethod::DNS_PACKET) {
+        executePacketTask(std::move(task));
+        return;
+    }
+    
+    // 系统解析在独立的线程池中执行，不阻塞工作线程
+    if (!DnsResolverImpl::isValidDomain(task->domain)) {
+        DnsResult result;
+        result.domains.push_back(task->domain);
+        result.error_message = "无效的域名格式";
+        completeTask(*task, result);
+        return;
+    }
+    system_->resolve(task->domain, task->type, [this, task](const DnsResult& result) {
+        executor_->submit([task, result]() { completeTask(*task, result); });
+    });
+}
+
+void AsyncDnsResolverImpl::executePacketTask(std::shared_ptr<Task> task) {
+    QueryConfig config = loadConfig();
+    
+    if (task->use_custom_packet) {
+        // 自定义数据包按原样发给最好的服务器，不合并、不竞速也不缓存
+        size_t upstream = upstreams_.select();
+        if (upstream == UpstreamSelector::npos) {
+            DnsResult result;
+            result.error_message = "未设置DNS服务器";
+            completeTask(*task, result);
+            return;
+        }
+        std::vector<uint8_t> packet = DnsPacketBuilder::buildCustomPacket(task->custom_packet);
+        DnsServer server = upstreams_.server(upstream);
+        DnsEventLoop* loop = nextLoop();
+        loop->post([this, loop, task, upstream, server, config, packet = std::move(packet)]() mutable {
+            auto start = std::chrono::steady_clock::now();
+            loop->sendQuery(server.address, server.port, std::move(packet), config.timeout_ms,
+                [this, task, upstream, server, start, config](const DnsResult& result) {
+                    upstreams_.report(upstream, result, elapsedMs(start));
+                    auto finish = [this, task](const DnsResult& response) {
+                        executor_->submit([task, response]() { completeTask(*task, response); });
+                    };
+                    if (result.truncated) {
+                        queryTcp(server, config.timeout_ms, DnsPacketBuilder::buildCustomPacket(task->custom_packet),
+                                 finish);
+                        return;
+                    }
+                    finish(result);
+                }, config.retry);
+        });
+        return;
+    }
+    
+    DnsResult result;
+    result.domains.push_back(task->domain);
+    
+    // 验证域名格式
+    if (!DnsResolverImpl::isValidDomain(task->domain)) {
+        result.error_message = "无效的域名格式";
+        completeTask(*task, result);
+        return;
+    }
+    
+    // 优先使用缓存结果
+    if (cache_->lookup(task->domain, task->type, DnsRecordClass::IN, result)) {
+        metrics_->cache_hits.add();
+        completeTask(*task, result);
+        return;
+    }
+    metrics_->cache_misses.add();
+    
+    // 相同的查询已在途时合并到该查询，不再重复发送
+    std::string flight_key = DnsCache::makeKey(task->domain, task->type, DnsRecordClass::IN) +
+                             "@" + config.servers_key;
+    {
+        std::lock_guard<std::mutex> lock(inflight_mutex_);
+        auto& waiting = inflight_[flight_key];
+        waiting.push_back(task);
+        if (waiting.size() > 1) {
+            return;
+        }
+    }
+    
+    // 响应到达或超时后回到工作线程完成任务
+    sendQuery(config, task->domain, task->type, config.edns_payload_size,
+        [this, task, flight_key](const DnsResult& result) {
+            executor_->submit([this, task, flight_key, result]() {
+                // 先写入缓存再结束在途查询，之后到达的任务可以直接命中缓存
+                cache_->insert(task->domain, task->type, DnsRecordClass::IN, result);
+                std::vector<std::shared_ptr<Task>> waiting;
+                {
+                    std::lock_guard<std::mutex> lock(inflight_mutex_);
+                    auto it = inflight_.find(flight_key);
+                    if (it != inflight_.end()) {
+                        waiting.swap(it->second);
+                        inflight_.erase(it);
+                    }
+                }
+                for (auto& waiter : waiting) {
+                    completeTask(*waiter, result);
+                }
+            });
+        });
+}
+
+void AsyncDnsResolverImpl::sendQuery(const QueryConfig& config, const std::string& domain, DnsRecordType type,
+                                     uint16_t edns_payload_size, std::function<void(const DnsResult&)> completion) {
+    DnsResult result;
+    size_t primary = upstreams_.select();
+    if (primary == UpstreamSelector::npos) {
+        result.error_message = "未设置DNS服务器";
+        completion(result);
+        return;
+    }
+    
+    auto race = std::make_shared<Race>();
+    race->index[0] = primary;
+    race->server[0] = upstreams_.server(primary);
+    race->packet = DnsPacketBuilder::buildQueryPacket(domain, type, DnsRecordClass::IN, 0, edns_payload_size);
+    
+    // 两个查询都在同一个事件循环中完成，Race的状态只在该线程访问
+    // 服务器没有有效应答且另一个查询仍在途时继续等待，否则以先到达的结果结束
+    DnsEventLoop* loop = nextLoop();
+    auto settle = [this, loop, race, config, domain, type, edns_payload_size, completion](int which,
+                                                                                           const DnsResult& result) {
+        upstreams_.report(race->index[which], result, elapsedMs(race->sent[which]));
+        --race->pending;
+        if (race->finished || (UpstreamSelector::isServerFailure(result) && race->pending > 0)) {
+            return;
+        }
+        race->finished = true;
         
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_cv_.wait(lock, [this] { return !task_queue_.empty() || !running_; });
-            
-            if (!running_ && task_queue_.empty()) {
-                break;
-            }
+        // 次选服务器先应答时首选服务器至少慢于当前耗时，先记下这个下限
+        if (which == 1 && race->pending > 0) {
+            upstreams_.reportRtt(race->index[0], elapsedMs(race->sent[0]));
+        }
+        
+        if (edns_payload_size && DnsResolverImpl::needsEdnsFallback(result)) {
+            sendQuery(config, domain, type, 0, completion);
+            return;
+        }
+        if (result.truncated) {
+            // TCP查询在工作线程中执行，应答回到事件循环线程中完成（resolveDirect依赖这一点）
+            queryTcp(race->server[which], config.timeout_ms, std::move(race->packet), completion, loop);
+            return;
+        }
+        completion(result);
+    };
+    
+    loop->post([this, loop, race, config, settle]() {
+        race->sent[0] = std::chrono::steady_clock::now();
+        race->pending = 1;
+        loop->sendQuery(race->server[0].address, race->server[0].port, race->packet, config.timeout_ms,
+                        [settle](const DnsResult& result) { settle(0, result); }, config.retry);
+        
+        // 竞速：首选服务器在自适应延迟内没有应答时向次选服务器发送同一查询
+        if (!config.hedging || race->finished) {
+            return;
+        }
+        int delay = upstreams_.hedgeDelay(race->index[0], config.timeout_ms);
+        loop->schedule(delay, [this, loop, race, config, delay, settle]() {
+            if (race->finished) return;
+            size_t secondary = upstreams_.select(race->index[0]);
+            if (secondary == UpstreamSelector::npos) return;
             
-            if (!task_queue_.empty()) {
-                task = std::move(task_queue_.front());
-                task_queue_.pop();
-            }
+            race->index[1] = secondary;
+            race->server[1] = upstreams_.server(secondary);
+            race->sent[1] = std::chrono::steady_clock::now();
+            ++race->pending;
+            loop->sendQuery(race->server[1].address, race->server[1].port, race->packet,
+                            std::max(config.timeout_ms - delay, 1),
+                            [settle](const DnsResult& result) { settle(1, result); }, config.retry);
+        });
+    });
+}
+
+void AsyncDnsResolverImpl::queryTcp(const DnsServer& server, int timeout_ms,
+                                    std::vector<uint8_t> packet, std::function<void(const DnsResult&)> completion,
+                                    DnsEventLoop* reply_loop) {
+    metrics_->tcp_fallbacks.add();
+    executor_->submit([this, server, timeout_ms, packet = std::move(packet), completion, reply_loop]() {
+        DnsResult result = tcp_->query(server.address, server.port, packet, timeout_ms);
+        if (reply_loop) {
+            reply_loop->post([completion, result]() { completion(result); });
+            return;
+        }
+        completion(result);
+    });
+}
+
+void AsyncDnsResolverImpl::executeBatchTask(std::shared_ptr<BatchTask> batch) {
+    QueryConfig config = loadConfig();
+    
+    // 整批使用同一个上游服务器
+    size_t upstream = upstreams_.select();
+    DnsServer server = upstreams_.server(upstream);
+    auto state = std::make_shared<BatchUpstream>();
+    
+    std::vector<DnsEventLoop::Request> requests;
+    size_t finished = 0;
+    for (size_t i = 0; i < batch->queries.size(); ++i) {
+        const DnsQuery& query = batch->queries[i];
+        DnsResult& result = batch->results[i];
+        result.domains.push_back(query.domain);
+        
+        // 验证域名格式
+        if (!DnsResolverImpl::isValidDomain(query.domain)) {
+            result.error_message = "无效的域名格式";
+            metrics_->recordResult(result, batch->submitted);
+            ++finished;
+            continue;
         }
         
-        // 对于自定义数据包任务，不需要检查domain是否为空
-        // if (!task.use_custom_packet && task.domain.empty()) {
-        //     continue;
-        // }
+        // 优先使用缓存结果
+        if (cache_->lookup(query.domain, query.type, DnsRecordClass::IN, result)) {
+            metrics_->cache_hits.add();
+            metrics_->recordResult(result, batch->submitted);
+            ++finished;
+            continue;
+        }
+        metrics_->cache_misses.add();
         
-        executeTask(task);
+        if (upstream == UpstreamSelector::npos) {
+            result.error_message = "未设置DNS服务器";
+            metrics_->recordResult(result, batch->submitted);
+            ++finished;
+            continue;
+        }
+        
+        DnsEventLoop::Request request;
+        request.packet = DnsPacketBuilder::buildQueryPacket(query.domain, query.type, DnsRecordClass::IN,
+                                                            0, config.edns_payload_size);
+        std::function<void(const DnsResult&)> finish = [this, batch, i](const DnsResult& response) {
+            executor_->submit([this, batch, i, response]() {
+                const DnsQuery& query = batch->queries[i];
+                cache_->insert(query.domain, query.type, DnsRecordClass::IN, response);
+                metrics_->recordResult(response, batch->submitted);
+                batch->results[i] = response;
+                completeBatchQuery(*batch, 1);
+            });
+        };
+        request.completion = [this, upstream, server, state, config, query, finish](const DnsResult& response) {
+            // 第一个有效应答记一个RTT样本，全部是服务器故障时记一次失败
+            if (!state->reported) {
+                --state->pending;
+                if (!UpstreamSelector::isServerFailure(response)) {
+                    upstreams_.reportRtt(upstream, elapsedMs(state->sent));
+                    state->reported = true;
+                } else if (state->pending == 0) {
+                    upstreams_.reportFailure(upstream);
+                    state->reported = true;
+                }
+            }
+            if (config.edns_payload_size && DnsResolverImpl::needsEdnsFallback(response)) {
+                sendQuery(config, query.domain, query.type, 0, finish);
+                return;
+            }
+            if (response.truncated) {
+                queryTcp(server, config.timeout_ms,
+                         DnsPacketBuilder::buildQueryPacket(query.domain, query.type, DnsRecordClass::IN,
+                                                            0, config.edns_payload_size),
+                         finish);
+                return;
+            }
+            finish(response);
+        };
+        requests.push_back(std::move(request));
     }
+    
+    if (finished > 0) {
+        completeBatchQuery(*batch, finished);
+    }
+    if (requests.empty()) {
+        return;
+    }
+    
+    state->pending = requests.size();
+    DnsEventLoop* loop = nextLoop();
+    loop->post([loop, server, config, state, requests = std::move(requests)]() mutable {
+        state->sent = std::chrono::steady_clock::now();
+        loop->sendQueries(server.address, server.port, std::move(requests), config.timeout_ms, config.retry);
+    });
 }
 
-void AsyncDnsResolverImpl::executeTask(Task& task) {
-    DnsResult result;
+void AsyncDnsResolverImpl::completeDualQuery(std::shared_ptr<DualTask> dual, size_t index,
+                                             const DnsResult& result, int grace_ms) {
+    bool both_done;
+    bool start_grace;
+    {
+        std::lock_guard<std::mutex> lock(dual->mutex);
+        if (dual->finished) return;
+        dual->results[index] = result;
+        dual->done[index] = true;
+        both_done = dual->done[1 - index];
+        start_grace = !both_done && DnsResolverImpl::hasAddresses(result);
+    }
     
-    if (task.use_custom_packet) {
-        result = resolver_->resolveWithPacket(task.custom_packet);
-    } else {
-        result = resolver_->resolve(task.domain, task.type, task.method);
+    if (both_done) {
+        finishDual(*dual);
+        return;
+    }
+    if (!start_grace) {
+        return;
+    }
+    
+    // 第一个带地址的应答：宽限期后另一个地址族仍未应答则只返回已有的地址
+    DnsEventLoop* loop = nextLoop();
+    loop->post([this, loop, dual, grace_ms]() {
+        loop->schedule(grace_ms, [this, dual]() {
+            executor_->submit([dual]() { finishDual(*dual); });
+        });
+    });
+}
+
+void AsyncDnsResolverImpl::finishDual(DualTask& dual) {
+    DnsResult result;
+    {
+        std::lock_guard<std::mutex> lock(dual.mutex);
+        if (dual.finished) return;
+        dual.finished = true;
+        for (size_t i = 0; i < 2; ++i) {
+            if (!dual.done[i]) {
+                dual.results[i].error_message = "Receive DNS response timeout";
+            }
+        }
+        result = DnsResolverImpl::mergeDualResults(dual.results[0], dual.results[1]);
+    }
+    dual.promise.set_value(result);
+}
+
+AsyncDnsResolverImpl::QueryConfig AsyncDnsResolverImpl::loadConfig() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    QueryConfig config;
+    config.servers_key = servers_key_;
+    config.timeout_ms = timeout_ms_;
+    config.edns_payload_size = edns_payload_size_;
+    config.hedging = hedging_;
+    config.retry = retry_policy_;
+    return config;
+}
+
+DnsEventLoop* AsyncDnsResolverImpl::nextLoop() {
+    // 轮流选择事件循环发送
+    return event_loops_[next_loop_.fetch_add(1, std::memory_order_relaxed) % event_loops_.size()].get();
+}
+
+double AsyncDnsResolverImpl::elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AsyncDnsResolverImpl::completeBatchQuery(BatchTask& batch, size_t count) {
+    if (batch.remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        batch.promise.set_value(std::move(batch.results));
+    }
+}
+
+void AsyncDnsResolverImpl::completeTask(Task& task, const DnsResult& result) {
+    if (task.metrics) {
+        task.metrics->recordResult(result, task.submitted);
     }
     
     // 处理回调
@@ -141,12 +605,150 @@ void AsyncDnsResolverImpl::executeTask(Task& task) {
     task.promise.set_value(result);
 }
 
-void AsyncDnsResolverImpl::addTask(Task task) {
-    {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        task_queue_.push(std::move(task));
+void AsyncDnsResolverImpl::addTask(Task task, TaskPriority priority) {
+    auto shared = std::make_shared<Task>(std::move(task));
+    shared->submitted = std::chrono::steady_clock::now();
+    shared->metrics = metrics_.get();
+    
+    enqueue(priority, [this, shared]() { executeTask(shared); },
+            [shared](const DnsResult& result) {
+                DnsResult response = result;
+                response.domains.push_back(shared->domain);
+                completeTask(*shared, response);
+            });
+}
+
+void AsyncDnsResolverImpl::enqueue(TaskPriority priority, std::function<void()> execute,
+                                   std::function<void(const DnsResult&)> reject) {
+    size_t level = static_cast<size_t>(priority);
+    std::unique_ptr<QueuedTask> dropped;
+    
+    // 先占用一个位置，队列已满时按过载策略处理
+    while (queued_count_.fetch_add(1) >= queue_limit_.load(std::memory_order_relaxed)) {
+        OverloadPolicy policy = overload_policy_.load(std::memory_order_relaxed);
+        if (policy == OverloadPolicy::DROP_OLDEST) {
+            // 被丢弃任务的位置让给新任务，不为新任务丢弃优先级更高的任务
+            dropped.reset(popLowest(level));
+            if (dropped) {
+                queued_count_.fetch_sub(1);
+                break;
+            }
+        }
+        releaseSlot();
+        if (policy == OverloadPolicy::BLOCK && !executor_->inWorkerThread()) {
+            waitForSpace();
+            continue;
+        }
+        
+        // 拒绝的任务在提交线程中结束
+        metrics_->rejected.add();
+        reject(overloadResult("解析任务队列已满"));
+        return;
+    }
+    
+    // 入队只有一次原子交换，生产者之间不争用锁
+    QueuedTask* task = new QueuedTask;
+    task->execute = std::move(execute);
+    task->reject = std::move(reject);
+    task->submitted = std::chrono::steady_clock::now();
+    metrics_->queue_depth.add(1);
+    queued_[level].push(task);
+    
+    if (dropped) {
+        metrics_->rejected.add();
+        metrics_->queue_depth.add(-1);
+        dropped->reject(overloadResult("解析任务因队列已满被丢弃"));
+    }
+    
+    // 消费权空闲时提交执行请求，否则由持有者取出；先读再交换，避免每次提交都写同一缓存行
+    if (!draining_.load() && !draining_.exchange(true)) {
+        executor_->submit([this]() { runQueued(); });
+    }
+}
+
+void AsyncDnsResolverImpl::runQueued() {
+    while (true) {
+        std::unique_ptr<QueuedTask> task(popHighest());
+        if (!task) {
+            // 位置已被占用但节点还没有链接上：等待生产者完成入队
+            if (queued_count_.load() > 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (releaseDrain()) {
+                return;
+            }
+            continue;
+        }
+        releaseSlot();
+        metrics_->queue_depth.add(-1);
+        metrics_->queue_wait.recordSince(task->submitted);
+        
+        // 停止过程中（执行器直接在调用线程中执行）在本线程中依次执行，避免执行请求递归
+        if (!running_) {
+            task->execute();
+            continue;
+        }
+        
+        // 还有任务时把消费权交给新的执行请求，空闲的工作线程窃取它并行取出后续任务
+        if (queued_count_.load() > 0 || !releaseDrain()) {
+            executor_->submit([this]() { runQueued(); });
+        }
+        task->execute();
+        return;
     }
-    queue_cv_.notify_one();
 }
 
-} // namespace zjpdns 
\ No newline at end of file
+bool AsyncDnsResolverImpl::releaseDrain() {
+    // 释放后再检查：生产者可能在释放前看到消费权仍被持有而没有提交执行请求
+    draining_.store(false);
+    return queued_count_.load() == 0 || draining_.exchange(true);
+}
+
+AsyncDnsResolverImpl::QueuedTask* AsyncDnsResolverImpl::popHighest() {
+    std::lock_guard<std::mutex> lock(pop_mutex_);
+    for (auto& queue : queued_) {
+        if (MpscNode* node = queue.pop()) {
+            return static_cast<QueuedTask*>(node);
+        }
+    }
+    return nullptr;
+}
+
+AsyncDnsResolverImpl::QueuedTask* AsyncDnsResolverImpl::popLowest(size_t level) {
+    std::lock_guard<std::mutex> lock(pop_mutex_);
+    for (size_t i = DNS_TASK_PRIORITIES; i-- > level;) {
+        if (MpscNode* node = queued_[i].pop()) {
+            return static_cast<QueuedTask*>(node);
+        }
+    }
+    return nullptr;
+}
+
+void AsyncDnsResolverImpl::releaseSlot() {
+    queued_count_.fetch_sub(1);
+    if (blocked_.load() > 0) {
+        {
+            std::lock_guard<std::mutex> lock(space_mutex_);
+        }
+        space_cv_.notify_one();
+    }
+}
+
+void AsyncDnsResolverImpl::waitForSpace() {
+    std::unique_lock<std::mutex> lock(space_mutex_);
+    ++blocked_;
+    space_cv_.wait(lock, [this] {
+        return queued_count_.load() < queue_limit_.load() || overload_policy_.load() != OverloadPolicy::BLOCK;
+    });
+    --blocked_;
+}
+
+DnsResult AsyncDnsResolverImpl::overloadResult(const std::string& message) {
+    DnsResult result;
+    result.overloaded = true;
+    result.error_message = message;
+    return result;
+}
+
+} // namespace zjpdns
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "dns_cache.h"
+#include "dns_simd.h"
+#include <algorithm>
+
+namespace zjpdns {
+
+DnsCache::DnsCache(size_t max_entries) : max_entries_(max_entries) {}
+
+DnsCache::~DnsCache() = default;
+
+bool DnsCache::lookup(const std::string& domain, DnsRecordType type,
+                      DnsRecordClass class_, DnsResult& result) {
+    std::string key = makeKey(domain, type, class_);
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+
+    // 已过期的条目直接删除
+    if (now >= it->second->expires) {
+        entries_.erase(it->second);
+        index_.erase(it);
+        return false;
+    }
+
+    // 移动到链表头部
+    entries_.splice(entries_.begin(), entries_, it->second);
+
+    const Entry& entry = *it->second;
+    uint32_t elapsed = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(now - entry.inserted).count());
+
+    result = entry.result;
+    for (auto& record : result.records) {
+        record.ttl = record.ttl > elapsed ? record.ttl - elapsed : 0;
+    }
+    for (auto& record : result.authorities) {
+        record.ttl = record.ttl > elapsed ? record.ttl - elapsed : 0;
+    }
+    return true;
+}
+
+void DnsCache::insert(const std::string& domain, DnsRecordType type,
+                      DnsRecordClass class_, const DnsResult& result) {
+    uint32_t ttl = cacheTtl(result);
+    if (ttl == 0) {
+        return;
+    }
+
+    std::string key = makeKey(domain, type, class_);
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_entries_ == 0) {
+        return;
+    }
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.result = result;
+    entry.inserted = now;
+    entry.expires = now + std::chrono::seconds(ttl);
+
+    entries_.push_front(std::move(entry));
+    index_[key] = entries_.begin();
+    evict();
+}
+
+void DnsCache::setMaxEntries(size_t max_entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_entries_ = max_entries;
+    evict();
+}
+
+void DnsCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+}
+
+size_t DnsCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::string DnsCache::makeKey(const std::string& domain, DnsRecordType type,
+                              DnsRecordClass class_) {
+    std::string key;
+    key.reserve(domain.length() + 12);
+
+    size_t length = domain.length();
+    if (length > 0 && domain.back() == '.') {
+        --length;
+    }
+    key.resize(length);
+    simd::toLowerAscii(domain.data(), length, &key[0]);
+
+    key += '/';
+    key += std::to_string(static_cast<uint16_t>(type));
+    key += '/';
+    key += std::to_string(static_cast<uint16_t>(class_));
+    return key;
+}
+
+uint32_t DnsCache::cacheTtl(const DnsResult& result) {
+    // NXDOMAIN
+    if (result.rcode == 3) {
+        return negativeTtl(result);
+    }
+
+    // 其他错误（SERVFAIL、超时等）和截断的应答不缓存
+    if (!result.success || result.rcode != 0 || result.truncated) {
+        return 0;
+    }
+
+    // NODATA：成功但没有应答记录
+    if (result.records.empty()) {
+        return negativeTtl(result);
+    }
+
+    // 肯定应答，时长取所有记录TTL的最小值
+    uint32_t ttl = result.records.front().ttl;
+    for (const auto& record : result.records) {
+        ttl = std::min(ttl, record.ttl);
+    }
+    return ttl;
+}
+
+uint32_t DnsCache::negativeTtl(const DnsResult& result) {
+    for (const auto& record : result.authorities) {
+        if (record.type != DnsRecordType::SOA) {
+            continue;
+        }
+
+        // SOA RDATA: MNAME, RNAME, SERIAL, REFRESH, RETRY, EXPIRE, MINIMUM
+        // 两个域名之后是5个32位整数，MINIMUM位于RDATA的最后4字节
+        const std::string& rdata = record.data;
+        if (rdata.length() < 22) {
+            continue;
+        }
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(rdata.data()) + rdata.length() - 4;
+        uint32_t minimum = (static_cast<uint32_t>(p[0]) << 24) |
+                           (static_cast<uint32_t>(p[1]) << 16) |
+                           (static_cast<uint32_t>(p[2]) << 8) |
+                           static_cast<uint32_t>(p[3]);
+        return std::min(record.ttl, minimum);
+    }
+    return 0;
+}
+
+void DnsCache::evict() {
+    while (entries_.size() > max_entries_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+} // namespace zjpdns
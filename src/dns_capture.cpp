@@ -0,0 +1,383 @@
+#include "dns_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace zjpdns {
+
+// 链路类型
+static const uint32_t kLinkNull = 0;        // BSD loopback
+static const uint32_t kLinkEthernet = 1;
+static const uint32_t kLinkRawAlt1 = 12;    // 部分平台上的DLT_RAW
+static const uint32_t kLinkRawAlt2 = 14;
+static const uint32_t kLinkRaw = 101;
+static const uint32_t kLinkLinuxSll = 113;
+static const uint32_t kLinkIpv4 = 228;
+static const uint32_t kLinkIpv6 = 229;
+static const uint32_t kLinkLinuxSll2 = 276;
+static const uint32_t kLinkDnsMessage = UINT32_MAX;  // 原始转储中的DNS消息
+static const uint32_t kLinkUnknown = UINT32_MAX - 1;
+
+// pcapng块类型
+static const uint32_t kBlockSectionHeader = 0x0A0D0D0A;
+static const uint32_t kBlockInterface = 1;
+static const uint32_t kBlockPacket = 2;
+static const uint32_t kBlockSimplePacket = 3;
+static const uint32_t kBlockEnhancedPacket = 6;
+
+static uint16_t readBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+DnsCaptureReader::DnsCaptureReader()
+    : data_(nullptr), size_(0), format_(Format::NONE), port_(DNS_CAPTURE_PORT) {}
+
+DnsCaptureReader::~DnsCaptureReader() {
+    close();
+}
+
+bool DnsCaptureReader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = "Open capture file failed";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < 2) {
+        ::close(fd);
+        error_ = "Capture file is empty";
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error_ = "Map capture file failed";
+        return false;
+    }
+    madvise(mapped, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    data_ = static_cast<const uint8_t*>(mapped);
+    size_ = static_cast<size_t>(st.st_size);
+
+    // 根据文件头识别格式
+    uint32_t magic = size_ >= 4
+        ? (static_cast<uint32_t>(data_[0]) << 24) | (data_[1] << 16) | (data_[2] << 8) | data_[3] : 0;
+    if ((magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1 || magic == 0xA1B2C3D4 || magic == 0xA1B23C4D)) {
+        if (size_ < 24) {
+            error_ = "Truncated pcap header";
+            close();
+            return false;
+        }
+        format_ = Format::PCAP;
+    } else if (magic == kBlockSectionHeader) {
+        format_ = Format::PCAPNG;
+    } else if (readBe16(data_) >= 12 && static_cast<size_t>(readBe16(data_)) + 2 <= size_) {
+        format_ = Format::RAW;
+    } else {
+        error_ = "Unknown capture format";
+        close();
+        return false;
+    }
+
+    error_.clear();
+    return true;
+}
+
+void DnsCaptureReader::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    format_ = Format::NONE;
+}
+
+DnsCaptureStats DnsCaptureReader::read(const PayloadHandler& handler) const {
+    auto start = std::chrono::steady_clock::now();
+
+    DnsCaptureStats stats;
+    Cursor cursor = begin();
+    walk(cursor, size_, &handler, stats);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+DnsCaptureStats DnsCaptureReader::readParallel(size_t thread_count, const ParallelHandler& handler) const {
+    if (thread_count <= 1) {
+        return read([&handler](const uint8_t* data, size_t length) { handler(0, data, length); });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // pcap没有同步标记，先只跳过帧头确定每个线程的起始帧
+    std::vector<Cursor> starts;
+    Cursor cursor = begin();
+    starts.push_back(cursor);
+    for (size_t i = 1; i < thread_count; ++i) {
+        DnsCaptureStats ignored;
+        walk(cursor, size_ / thread_count * i, nullptr, ignored);
+        starts.push_back(cursor);
+    }
+
+    std::vector<DnsCaptureStats> partial(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i, thread_count, &starts, &partial, &handler]() {
+            PayloadHandler worker = [&handler, i](const uint8_t* data, size_t length) {
+                handler(i, data, length);
+            };
+            Cursor local = starts[i];
+            size_t end = i + 1 < thread_count ? starts[i + 1].offset : size_;
+            walk(local, end, &worker, partial[i]);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    DnsCaptureStats stats;
+    for (const auto& part : partial) {
+        stats.frames += part.frames;
+        stats.payloads += part.payloads;
+        stats.bytes += part.bytes;
+        stats.skipped += part.skipped;
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+DnsCaptureReader::Cursor DnsCaptureReader::begin() const {
+    Cursor cursor;
+    if (format_ == Format::PCAP) {
+        // 小端文件的魔数以0xD4或0x4D开头
+        cursor.swapped = data_[0] == 0xA1;
+        cursor.link_type = read32(cursor, 20) & 0xFFFF;
+        cursor.offset = 24;
+    }
+    return cursor;
+}
+
+void DnsCaptureReader::walk(Cursor& cursor, size_t end, const PayloadHandler* handler,
+                            DnsCaptureStats& stats) const {
+    const uint8_t* frame;
+    size_t length;
+    uint32_t link_type;
+
+    while (cursor.offset < end && nextFrame(cursor, frame, length, link_type)) {
+        if (!handler) continue;
+
+        ++stats.frames;
+        const uint8_t* payload;
+        size_t payload_length;
+        if (!extractPayload(link_type, frame, length, payload, payload_length)) {
+            ++stats.skipped;
+            continue;
+        }
+
+        ++stats.payloads;
+        stats.bytes += payload_length;
+        (*handler)(payload, payload_length);
+    }
+}
+
+bool DnsCaptureReader::nextFrame(Cursor& cursor, const uint8_t*& frame, size_t& length,
+                                 uint32_t& link_type) const {
+    switch (format_) {
+    case Format::PCAP: {
+        if (cursor.offset + 16 > size_) return false;
+        uint32_t captured = read32(cursor, cursor.offset + 8);
+        if (captured > size_ - cursor.offset - 16) return false;
+
+        frame = data_ + cursor.offset + 16;
+        length = captured;
+        link_type = cursor.link_type;
+        cursor.offset += 16 + captured;
+        return true;
+    }
+
+    case Format::PCAPNG:
+        while (cursor.offset + 12 <= size_) {
+            size_t offset = cursor.offset;
+
+            // 段头块的字节序标记决定本段所有块的字节序
+            if (readBe16(data_ + offset) == 0x0A0D && readBe16(data_ + offset + 2) == 0x0D0A) {
+                if (data_[offset + 8] == 0x4D) {
+                    cursor.swapped = false;
+                } else if (data_[offset + 8] == 0x1A) {
+                    cursor.swapped = true;
+                } else {
+                    return false;
+                }
+                cursor.interfaces.clear();
+            }
+
+            uint32_t type = read32(cursor, offset);
+            uint32_t total = read32(cursor, offset + 4);
+            if (total < 12 || total % 4 != 0 || total > size_ - offset) return false;
+            cursor.offset += total;
+
+            if (type == kBlockInterface && total >= 20) {
+                cursor.interfaces.push_back(read16(cursor, offset + 8));
+            } else if ((type == kBlockEnhancedPacket || type == kBlockPacket) && total >= 32) {
+                uint32_t interface = type == kBlockEnhancedPacket
+                    ? read32(cursor, offset + 8) : read16(cursor, offset + 8);
+                uint32_t captured = read32(cursor, offset + 20);
+                if (captured > total - 32) return false;
+
+                frame = data_ + offset + 28;
+                length = captured;
+                link_type = interface < cursor.interfaces.size() ? cursor.interfaces[interface] : kLinkUnknown;
+                return true;
+            } else if (type == kBlockSimplePacket && total >= 16) {
+                uint32_t original = read32(cursor, offset + 8);
+
+                frame = data_ + offset + 12;
+                length = std::min<size_t>(original, total - 16);
+                link_type = cursor.interfaces.empty() ? kLinkUnknown : cursor.interfaces[0];
+                return true;
+            }
+        }
+        return false;
+
+    case Format::RAW: {
+        if (cursor.offset + 2 > size_) return false;
+        uint16_t message_length = readBe16(data_ + cursor.offset);
+        if (message_length > size_ - cursor.offset - 2) return false;
+
+        frame = data_ + cursor.offset + 2;
+        length = message_length;
+        link_type = kLinkDnsMessage;
+        cursor.offset += 2 + message_length;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+bool DnsCaptureReader::extractPayload(uint32_t link_type, const uint8_t* frame, size_t length,
+                                      const uint8_t*& payload, size_t& payload_length) const {
+    switch (link_type) {
+    case kLinkDnsMessage:
+        payload = frame;
+        payload_length = length;
+        return length > 0;
+
+    case kLinkEthernet: {
+        if (length < 14) return false;
+        size_t offset = 12;
+        uint16_t ethertype = readBe16(frame + offset);
+
+        // 跳过VLAN标签
+        while (ethertype == 0x8100 || ethertype == 0x88A8) {
+            offset += 4;
+            if (offset + 2 > length) return false;
+            ethertype = readBe16(frame + offset);
+        }
+        offset += 2;
+        if (ethertype != 0x0800 && ethertype != 0x86DD) return false;
+        return extractIp(frame + offset, length - offset, payload, payload_length);
+    }
+
+    case kLinkNull:
+        if (length < 4) return false;
+        return extractIp(frame + 4, length - 4, payload, payload_length);
+
+    case kLinkRaw:
+    case kLinkRawAlt1:
+    case kLinkRawAlt2:
+    case kLinkIpv4:
+    case kLinkIpv6:
+        return extractIp(frame, length, payload, payload_length);
+
+    case kLinkLinuxSll:
+        if (length < 16) return false;
+        return extractIp(frame + 16, length - 16, payload, payload_length);
+
+    case kLinkLinuxSll2:
+        if (length < 20) return false;
+        return extractIp(frame + 20, length - 20, payload, payload_length);
+
+    default:
+        return false;
+    }
+}
+
+bool DnsCaptureReader::extractIp(const uint8_t* packet, size_t length,
+                                 const uint8_t*& payload, size_t& payload_length) const {
+    if (length < 1) return false;
+
+    const uint8_t* udp;
+    size_t udp_length;
+    uint8_t version = packet[0] >> 4;
+
+    if (version == 4) {
+        size_t header_length = (packet[0] & 0x0F) * 4;
+        if (header_length < 20 || length < header_length) return false;
+
+        // 去掉以太网填充，抓包截断的帧跳过
+        size_t total_length = readBe16(packet + 2);
+        if (total_length < header_length || total_length > length) return false;
+
+        // 分片只有第一片带UDP头，整体跳过
+        if ((readBe16(packet + 6) & 0x3FFF) != 0) return false;
+        if (packet[9] != 17) return false;
+
+        udp = packet + header_length;
+        udp_length = total_length - header_length;
+    } else if (version == 6) {
+        if (length < 40) return false;
+        size_t end = 40 + static_cast<size_t>(readBe16(packet + 4));
+        if (end > length) return false;
+
+        // 跳过逐跳选项、路由和目的选项扩展头
+        uint8_t next = packet[6];
+        size_t offset = 40;
+        while (next == 0 || next == 43 || next == 60) {
+            if (offset + 8 > end) return false;
+            next = packet[offset];
+            offset += (static_cast<size_t>(packet[offset + 1]) + 1) * 8;
+        }
+        if (next != 17 || offset > end) return false;
+
+        udp = packet + offset;
+        udp_length = end - offset;
+    } else {
+        return false;
+    }
+
+    if (udp_length < 8) return false;
+    size_t datagram_length = readBe16(udp + 4);
+    if (datagram_length <= 8 || datagram_length > udp_length) return false;
+
+    if (port_ != 0 && readBe16(udp) != port_ && readBe16(udp + 2) != port_) return false;
+
+    payload = udp + 8;
+    payload_length = datagram_length - 8;
+    return true;
+}
+
+uint16_t DnsCaptureReader::read16(const Cursor& cursor, size_t offset) const {
+    const uint8_t* p = data_ + offset;
+    return cursor.swapped ? static_cast<uint16_t>((p[0] << 8) | p[1])
+                          : static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t DnsCaptureReader::read32(const Cursor& cursor, size_t offset) const {
+    const uint8_t* p = data_ + offset;
+    return cursor.swapped
+        ? (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3]
+        : p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace zjpdns
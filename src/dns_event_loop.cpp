@@ -0,0 +1,458 @@
+#include "dns_event_loop.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace zjpdns {
+
+// eventfd在epoll中的标识
+static const uint64_t kWakeupToken = UINT64_MAX;
+
+DnsEventLoop::DnsEventLoop(size_t socket_count)
+    : socket_count_(socket_count > 0 ? socket_count : 1), epoll_fd_(-1), event_fd_(-1),
+      next_id_(1), buffer_(DNS_MMSG_RECV_BATCH * DNS_UDP_BUFFER_SIZE), stopped_(false), running_(false), inflight_(0),
+      metrics_(nullptr) {}
+
+DnsEventLoop::~DnsEventLoop() {
+    stop();
+
+    for (int sockfd : sockets_) {
+        close(sockfd);
+    }
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+    }
+}
+
+bool DnsEventLoop::start() {
+    if (running_) {
+        return true;
+    }
+
+    if (epoll_fd_ < 0) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) return false;
+
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0) return false;
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeupToken;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev);
+
+        for (size_t i = 0; i < socket_count_; ++i) {
+            int sockfd = DnsPacketSender::createSocket();
+            if (sockfd < 0) continue;
+
+            ev.events = EPOLLIN;
+            ev.data.u64 = sockets_.size();
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+                close(sockfd);
+                continue;
+            }
+            sockets_.push_back(sockfd);
+        }
+        waiters_.resize(sockets_.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        stopped_ = false;
+    }
+    running_ = true;
+    thread_ = std::thread(&DnsEventLoop::run, this);
+    return true;
+}
+
+void DnsEventLoop::stop() {
+    if (running_) {
+        running_ = false;
+        wakeup();
+
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+}
+
+void DnsEventLoop::post(std::function<void()> fn) {
+    bool accepted = false;
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        if (!stopped_) {
+            posted_.push_back(std::move(fn));
+            accepted = true;
+        }
+    }
+
+    // 事件循环已停止，直接在调用线程中执行
+    if (!accepted) {
+        fn();
+        return;
+    }
+    wakeup();
+}
+
+void DnsEventLoop::sendQuery(const std::string& server, uint16_t port,
+                             std::vector<uint8_t> packet, int timeout_ms, Completion completion,
+                             const RetryPolicy& retry) {
+    std::vector<Request> requests(1);
+    requests[0].packet = std::move(packet);
+    requests[0].completion = std::move(completion);
+    sendQueries(server, port, std::move(requests), timeout_ms, retry);
+}
+
+void DnsEventLoop::sendQueries(const std::string& server, uint16_t port,
+                               std::vector<Request> requests, int timeout_ms,
+                               const RetryPolicy& retry) {
+    DnsResult result;
+
+    if (!running_ || sockets_.empty()) {
+        result.error_message = sockets_.empty() ? "Create socket failed" : "DNS event loop stopped";
+        for (auto& request : requests) {
+            request.completion(result);
+        }
+        return;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
+        result.error_message = "Send DNS packet failed";
+        for (auto& request : requests) {
+            request.completion(result);
+        }
+        return;
+    }
+
+    // 不足头部长度的数据包（如buildQueryPacket拒绝域名时返回的空数据包）不发送，直接完成
+    size_t valid = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].packet.size() < 12) {
+            result.error_message = "Invalid DNS query packet";
+            requests[i].completion(result);
+            continue;
+        }
+        if (valid != i) {
+            requests[valid] = std::move(requests[i]);
+        }
+        ++valid;
+    }
+    requests.resize(valid);
+    if (requests.empty()) {
+        return;
+    }
+
+    // 同一批查询使用同一个随机选择的socket
+    static thread_local std::mt19937 gen(std::random_device{}());
+    size_t socket = gen() % sockets_.size();
+    auto& waiters = waiters_[socket];
+
+    size_t count = requests.size();
+    std::vector<std::string> keys(count);
+    std::vector<struct iovec> iovs(count);
+    std::vector<struct mmsghdr> msgs(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::vector<uint8_t>& packet = requests[i].packet;
+        keys[i] = registerWaiter(socket, packet, 0);
+
+        iovs[i].iov_base = packet.data();
+        iovs[i].iov_len = packet.size();
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = &server_addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(server_addr);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // 批量发送，发送缓冲区满时短暂等待可写
+    size_t sent = 0;
+    int stalls = 0;
+    while (sent < count) {
+        unsigned int batch = static_cast<unsigned int>(std::min<size_t>(count - sent, DNS_MMSG_BATCH));
+        int n = sendmmsg(sockets_[socket], &msgs[sent], batch, 0);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            break;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = sockets_[socket];
+        pfd.events = POLLOUT;
+        if (++stalls > 10 || poll(&pfd, 1, 10) <= 0) {
+            break;
+        }
+    }
+
+    // 登记已发送的查询，定时器为第一次尝试的超时
+    std::vector<int> timeouts = retry.attemptTimeouts(timeout_ms);
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeouts[0]);
+    for (size_t i = 0; i < sent; ++i) {
+        uint64_t id = next_id_++;
+        waiters[keys[i]] = id;
+        timers_.push(Timer{deadline, id});
+
+        Query query;
+        query.key = std::move(keys[i]);
+        query.socket = socket;
+        query.server_addr = server_addr;
+        query.completion = std::move(requests[i].completion);
+        query.attempt = 0;
+        if (timeouts.size() > 1) {
+            query.packet = std::move(requests[i].packet);
+            query.timeouts = timeouts;
+        }
+        queries_.emplace(id, std::move(query));
+        ++inflight_;
+    }
+    if (metrics_) {
+        metrics_->queries.add(sent);
+        metrics_->inflight.add(static_cast<int64_t>(sent));
+    }
+
+    // 未能发送的查询直接失败
+    result.error_message = "Send DNS packet failed";
+    for (size_t i = sent; i < count; ++i) {
+        waiters.erase(keys[i]);
+    }
+    for (size_t i = sent; i < count; ++i) {
+        requests[i].completion(result);
+    }
+}
+
+void DnsEventLoop::schedule(int delay_ms, std::function<void()> fn) {
+    uint64_t id = next_id_++;
+    timers_.push(Timer{Clock::now() + std::chrono::milliseconds(delay_ms), id});
+    scheduled_.emplace(id, std::move(fn));
+}
+
+size_t DnsEventLoop::inflight() const {
+    return inflight_;
+}
+
+void DnsEventLoop::setMetrics(ResolverMetrics* metrics) {
+    metrics_ = metrics;
+}
+
+void DnsEventLoop::run() {
+    std::vector<struct epoll_event> events(64);
+
+    while (running_) {
+        int count = epoll_wait(epoll_fd_, events.data(), static_cast<int>(events.size()), nextTimeout());
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == kWakeupToken) {
+                uint64_t value;
+                while (read(event_fd_, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            handleReadable(static_cast<size_t>(events[i].data.u64));
+        }
+
+        runPosted();
+        handleTimeouts();
+    }
+
+    // 停止后执行剩余的投递函数，之后的投递在调用线程中直接执行
+    while (true) {
+        std::vector<std::function<void()>> posted;
+        {
+            std::lock_guard<std::mutex> lock(post_mutex_);
+            if (posted_.empty()) {
+                stopped_ = true;
+                break;
+            }
+            posted.swap(posted_);
+        }
+        for (auto& fn : posted) {
+            fn();
+        }
+    }
+
+    // 结束所有在途查询
+    DnsResult result;
+    result.error_message = "DNS event loop stopped";
+    while (!queries_.empty()) {
+        complete(queries_.begin()->first, result);
+    }
+    scheduled_.clear();
+    timers_ = decltype(timers_)();
+}
+
+void DnsEventLoop::runPosted() {
+    std::vector<std::function<void()>> posted;
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        posted.swap(posted_);
+    }
+
+    for (auto& fn : posted) {
+        fn();
+    }
+}
+
+void DnsEventLoop::handleReadable(size_t socket) {
+    struct mmsghdr msgs[DNS_MMSG_RECV_BATCH];
+    struct iovec iovs[DNS_MMSG_RECV_BATCH];
+    struct sockaddr_in addrs[DNS_MMSG_RECV_BATCH];
+
+    while (true) {
+        // 使用recvmmsg一次读取多个响应
+        for (size_t i = 0; i < DNS_MMSG_RECV_BATCH; ++i) {
+            iovs[i].iov_base = buffer_.data() + i * DNS_UDP_BUFFER_SIZE;
+            iovs[i].iov_len = DNS_UDP_BUFFER_SIZE;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int count = recvmmsg(sockets_[socket], msgs, DNS_MMSG_RECV_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) break;
+
+        for (int i = 0; i < count; ++i) {
+            const uint8_t* data = static_cast<const uint8_t*>(iovs[i].iov_base);
+            size_t length = msgs[i].msg_len;
+
+            auto& waiters = waiters_[socket];
+            auto it = waiters.find(DnsPacketSender::makeWaiterKey(data, length));
+            if (it == waiters.end()) {
+                continue; // 迟到或伪造的响应
+            }
+
+            const Query& query = queries_[it->second];
+            if (addrs[i].sin_addr.s_addr != query.server_addr.sin_addr.s_addr ||
+                addrs[i].sin_port != query.server_addr.sin_port) {
+                continue;
+            }
+
+            std::vector<uint8_t> response(data, data + length);
+            complete(it->second, DnsPacketBuilder::parseResponsePacket(response));
+        }
+
+        if (count < static_cast<int>(DNS_MMSG_RECV_BATCH)) break;
+    }
+}
+
+void DnsEventLoop::handleTimeouts() {
+    Clock::time_point now = Clock::now();
+
+    while (!timers_.empty() && timers_.top().deadline <= now) {
+        uint64_t id = timers_.top().id;
+        timers_.pop();
+
+        auto scheduled = scheduled_.find(id);
+        if (scheduled != scheduled_.end()) {
+            std::function<void()> fn = std::move(scheduled->second);
+            scheduled_.erase(scheduled);
+            fn();
+            continue;
+        }
+
+        // 已完成的查询留下的定时器直接忽略
+        auto it = queries_.find(id);
+        if (it == queries_.end()) continue;
+
+        if (metrics_) metrics_->timeouts.add();
+        if (it->second.attempt + 1 < it->second.timeouts.size()) {
+            retransmit(id, it->second);
+            continue;
+        }
+
+        DnsResult result;
+        result.error_message = "Receive DNS response timeout";
+        complete(id, result);
+    }
+}
+
+void DnsEventLoop::retransmit(uint64_t id, Query& query) {
+    // 更换socket（源端口）和事务ID，旧尝试迟到的响应不再匹配
+    waiters_[query.socket].erase(query.key);
+    query.socket = (query.socket + 1) % sockets_.size();
+    if (query.packet.size() >= 12) {
+        uint16_t transaction_id = DnsPacketBuilder::generateTransactionId();
+        query.packet[0] = static_cast<uint8_t>(transaction_id >> 8);
+        query.packet[1] = static_cast<uint8_t>(transaction_id & 0xFF);
+    }
+    query.key = registerWaiter(query.socket, query.packet, id);
+
+    // 发送失败时不立即结束，等待下一次尝试
+    sendto(sockets_[query.socket], query.packet.data(), query.packet.size(), 0,
+           reinterpret_cast<const struct sockaddr*>(&query.server_addr), sizeof(query.server_addr));
+
+    ++query.attempt;
+    if (metrics_) metrics_->retransmits.add();
+    timers_.push(Timer{Clock::now() + std::chrono::milliseconds(query.timeouts[query.attempt]), id});
+}
+
+std::string DnsEventLoop::registerWaiter(size_t socket, std::vector<uint8_t>& packet, uint64_t id) {
+    auto& waiters = waiters_[socket];
+
+    // 已有相同事务ID和问题的查询在等待时更换事务ID，避免响应串包
+    std::string key = DnsPacketSender::makeWaiterKey(packet.data(), packet.size());
+    while (waiters.count(key) && packet.size() >= 12) {
+        uint16_t transaction_id = DnsPacketBuilder::generateTransactionId();
+        packet[0] = static_cast<uint8_t>(transaction_id >> 8);
+        packet[1] = static_cast<uint8_t>(transaction_id & 0xFF);
+        key = DnsPacketSender::makeWaiterKey(packet.data(), packet.size());
+    }
+    waiters[key] = id;
+    return key;
+}
+
+void DnsEventLoop::complete(uint64_t id, const DnsResult& result) {
+    auto it = queries_.find(id);
+    if (it == queries_.end()) {
+        return;
+    }
+
+    Query query = std::move(it->second);
+    queries_.erase(it);
+    waiters_[query.socket].erase(query.key);
+    --inflight_;
+    if (metrics_) metrics_->inflight.add(-1);
+
+    query.completion(result);
+}
+
+int DnsEventLoop::nextTimeout() {
+    // 丢弃已完成查询的定时器
+    while (!timers_.empty() && queries_.count(timers_.top().id) == 0 &&
+           scheduled_.count(timers_.top().id) == 0) {
+        timers_.pop();
+    }
+
+    if (timers_.empty()) {
+        return -1;
+    }
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        timers_.top().deadline - Clock::now()).count();
+    return remaining > 0 ? static_cast<int>(remaining) + 1 : 0;
+}
+
+void DnsEventLoop::wakeup() {
+    uint64_t value = 1;
+    ssize_t written = write(event_fd_, &value, sizeof(value));
+    (void)written;
+}
+
+} // namespace zjpdns
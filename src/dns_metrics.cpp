@@ -0,0 +1,340 @@
+#include "dns_metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace zjpdns {
+
+// 当前线程写入的分片，首次使用时轮流分配
+static size_t currentShard() {
+    static std::atomic<size_t> next_shard(0);
+    static thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+}
+
+Counter::Counter() {
+    for (auto& shard : shards_) {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Counter::add(uint64_t value) {
+    shards_[currentShard() % DNS_METRICS_SHARDS].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+    rank = std::min(std::max<uint64_t>(rank, 1), count);
+
+    uint64_t seen = 0;
+    for (const auto& bucket : buckets) {
+        seen += bucket.second;
+        if (seen >= rank) {
+            return bucket.first;
+        }
+    }
+    return buckets.back().first;
+}
+
+uint64_t HistogramSnapshot::countBelow(uint64_t bound_us) const {
+    uint64_t total = 0;
+    for (const auto& bucket : buckets) {
+        if (bucket.first > bound_us) break;
+        total += bucket.second;
+    }
+    return total;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    count += other.count;
+    sum_us += other.sum_us;
+
+    std::vector<std::pair<uint64_t, uint64_t>> merged;
+    merged.reserve(buckets.size() + other.buckets.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < buckets.size() || j < other.buckets.size()) {
+        if (j == other.buckets.size() || (i < buckets.size() && buckets[i].first < other.buckets[j].first)) {
+            merged.push_back(buckets[i++]);
+        } else if (i == buckets.size() || other.buckets[j].first < buckets[i].first) {
+            merged.push_back(other.buckets[j++]);
+        } else {
+            merged.emplace_back(buckets[i].first, buckets[i].second + other.buckets[j].second);
+            ++i;
+            ++j;
+        }
+    }
+    buckets.swap(merged);
+}
+
+Histogram::Histogram() : shards_(new Shard[DNS_METRICS_HISTOGRAM_SHARDS]) {
+    for (size_t s = 0; s < DNS_METRICS_HISTOGRAM_SHARDS; ++s) {
+        for (auto& bucket : shards_[s].buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        shards_[s].count.store(0, std::memory_order_relaxed);
+        shards_[s].sum.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::bucketIndex(uint64_t value_us) {
+    // 小于DNS_METRICS_SUB_BUCKETS的值每个值一个桶，之后每个2的幂区间分为等宽子桶
+    if (value_us < DNS_METRICS_SUB_BUCKETS) {
+        return static_cast<size_t>(value_us);
+    }
+    const int sub_bits = __builtin_ctz(DNS_METRICS_SUB_BUCKETS);
+    int exponent = 63 - __builtin_clzll(value_us);
+    if (exponent > DNS_METRICS_MAX_EXPONENT) {
+        return kBucketCount - 1;
+    }
+    size_t sub = static_cast<size_t>(value_us >> (exponent - sub_bits)) - DNS_METRICS_SUB_BUCKETS;
+    return static_cast<size_t>(exponent - sub_bits + 1) * DNS_METRICS_SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketLower(size_t index) {
+    if (index < DNS_METRICS_SUB_BUCKETS) {
+        return index;
+    }
+    const int sub_bits = __builtin_ctz(DNS_METRICS_SUB_BUCKETS);
+    int exponent = static_cast<int>(index / DNS_METRICS_SUB_BUCKETS) + sub_bits - 1;
+    uint64_t sub = index % DNS_METRICS_SUB_BUCKETS;
+    return (DNS_METRICS_SUB_BUCKETS + sub) << (exponent - sub_bits);
+}
+
+uint64_t Histogram::bucketUpper(size_t index) {
+    if (index < DNS_METRICS_SUB_BUCKETS) {
+        return index + 1;
+    }
+    const int sub_bits = __builtin_ctz(DNS_METRICS_SUB_BUCKETS);
+    int exponent = static_cast<int>(index / DNS_METRICS_SUB_BUCKETS) + sub_bits - 1;
+    return bucketLower(index) + (uint64_t(1) << (exponent - sub_bits));
+}
+
+void Histogram::record(uint64_t value_us) {
+    Shard& shard = shards_[currentShard() % DNS_METRICS_HISTOGRAM_SHARDS];
+    shard.buckets[bucketIndex(value_us > 0 ? value_us - 1 : 0)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value_us, std::memory_order_relaxed);
+}
+
+void Histogram::recordSince(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    record(elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        uint64_t count = 0;
+        for (size_t s = 0; s < DNS_METRICS_HISTOGRAM_SHARDS; ++s) {
+            count += shards_[s].buckets[i].load(std::memory_order_relaxed);
+        }
+        if (count > 0) {
+            snapshot.buckets.emplace_back(bucketUpper(i), count);
+        }
+    }
+    for (size_t s = 0; s < DNS_METRICS_HISTOGRAM_SHARDS; ++s) {
+        snapshot.count += shards_[s].count.load(std::memory_order_relaxed);
+        snapshot.sum_us += shards_[s].sum.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+ResolverMetrics::ResolverMetrics(const std::string& name) : name_(name) {}
+
+Histogram& ResolverMetrics::upstreamRtt(const std::string& server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& histogram = upstream_rtt_[server];
+    if (!histogram) {
+        histogram = std::make_unique<Histogram>();
+    }
+    return *histogram;
+}
+
+void ResolverMetrics::recordResult(const DnsResult& result, std::chrono::steady_clock::time_point start) {
+    latency.recordSince(start);
+
+    // 失败且没有响应码表示没有收到应答
+    if (!result.success && result.rcode == 0) {
+        failures.add();
+        return;
+    }
+    rcodes[std::min<size_t>(result.rcode, DNS_METRICS_RCODES)].add();
+}
+
+MetricsSnapshot ResolverMetrics::snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.resolver = name_;
+    snapshot.queries = queries.value();
+    snapshot.retransmits = retransmits.value();
+    snapshot.timeouts = timeouts.value();
+    snapshot.tcp_fallbacks = tcp_fallbacks.value();
+    snapshot.cache_hits = cache_hits.value();
+    snapshot.cache_misses = cache_misses.value();
+    snapshot.failures = failures.value();
+    snapshot.rejected = rejected.value();
+    for (size_t i = 0; i <= DNS_METRICS_RCODES; ++i) {
+        snapshot.rcodes[i] = rcodes[i].value();
+    }
+    snapshot.queue_depth = queue_depth.value();
+    snapshot.inflight = inflight.value();
+    snapshot.latency = latency.snapshot();
+    snapshot.queue_wait = queue_wait.snapshot();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& upstream : upstream_rtt_) {
+        snapshot.upstream_rtt[upstream.first] = upstream.second->snapshot();
+    }
+    return snapshot;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<ResolverMetrics> MetricsRegistry::create(const std::string& kind) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // 顺便清理已销毁实例留下的条目
+    metrics_.erase(std::remove_if(metrics_.begin(), metrics_.end(),
+                                  [](const std::weak_ptr<ResolverMetrics>& m) { return m.expired(); }),
+                   metrics_.end());
+
+    auto metrics = std::make_shared<ResolverMetrics>(kind + "-" + std::to_string(next_id_++));
+    metrics_.push_back(metrics);
+    return metrics;
+}
+
+std::vector<MetricsSnapshot> MetricsRegistry::snapshot() {
+    std::vector<std::shared_ptr<ResolverMetrics>> alive;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& weak : metrics_) {
+            if (auto metrics = weak.lock()) {
+                alive.push_back(std::move(metrics));
+            }
+        }
+    }
+
+    std::vector<MetricsSnapshot> snapshots;
+    for (const auto& metrics : alive) {
+        snapshots.push_back(metrics->snapshot());
+    }
+    return snapshots;
+}
+
+std::string MetricsRegistry::exportPrometheus() {
+    return formatPrometheus(snapshot());
+}
+
+// 输出一组同名指标的HELP和TYPE行
+static void writeHeader(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+// 按2的幂微秒为边界输出累积桶（le含边界值），直方图的桶边界与之对齐，计数是精确的
+static void writeHistogram(std::ostringstream& out, const char* name, const std::string& labels,
+                           const HistogramSnapshot& histogram) {
+    char le[32];
+    for (int exponent = 6; exponent <= 25; ++exponent) {
+        // 边界以秒为单位输出精确的十进制值（微秒精度），去掉末尾的0
+        uint64_t bound = uint64_t(1) << exponent;
+        int length = snprintf(le, sizeof(le), "%llu.%06llu", static_cast<unsigned long long>(bound / 1000000),
+                              static_cast<unsigned long long>(bound % 1000000));
+        while (le[length - 1] == '0') {
+            le[--length] = '\0';
+        }
+        if (le[length - 1] == '.') {
+            le[--length] = '\0';
+        }
+        out << name << "_bucket{" << labels << ",le=\"" << le << "\"} " << histogram.countBelow(bound) << "\n";
+    }
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count << "\n";
+    char sum[32];
+    snprintf(sum, sizeof(sum), "%.6f", histogram.sum_us / 1e6);
+    out << name << "_sum{" << labels << "} " << sum << "\n";
+    out << name << "_count{" << labels << "} " << histogram.count << "\n";
+}
+
+std::string MetricsRegistry::formatPrometheus(const std::vector<MetricsSnapshot>& snapshots) {
+    std::ostringstream out;
+
+    struct CounterField {
+        const char* name;
+        const char* help;
+        uint64_t MetricsSnapshot::*field;
+    };
+    const CounterField counters[] = {
+        {"zjpdns_queries_total", "UDP queries sent upstream, excluding retransmissions", &MetricsSnapshot::queries},
+        {"zjpdns_retransmits_total", "UDP queries retransmitted after a timeout", &MetricsSnapshot::retransmits},
+        {"zjpdns_timeouts_total", "UDP queries that received no response in time", &MetricsSnapshot::timeouts},
+        {"zjpdns_tcp_fallbacks_total", "Truncated responses retried over TCP", &MetricsSnapshot::tcp_fallbacks},
+        {"zjpdns_cache_hits_total", "Answer cache hits", &MetricsSnapshot::cache_hits},
+        {"zjpdns_cache_misses_total", "Answer cache misses", &MetricsSnapshot::cache_misses},
+        {"zjpdns_failures_total", "Resolutions that failed without a response code", &MetricsSnapshot::failures},
+        {"zjpdns_rejected_total", "Tasks rejected or dropped because the task queue was full", &MetricsSnapshot::rejected},
+    };
+    for (const auto& counter : counters) {
+        writeHeader(out, counter.name, "counter", counter.help);
+        for (const auto& snapshot : snapshots) {
+            out << counter.name << "{resolver=\"" << snapshot.resolver << "\"} " << snapshot.*counter.field << "\n";
+        }
+    }
+
+    writeHeader(out, "zjpdns_responses_total", "counter", "Responses by RCODE");
+    for (const auto& snapshot : snapshots) {
+        for (size_t i = 0; i < snapshot.rcodes.size(); ++i) {
+            if (snapshot.rcodes[i] == 0) continue;
+            out << "zjpdns_responses_total{resolver=\"" << snapshot.resolver << "\",rcode=\""
+                << (i < DNS_METRICS_RCODES ? std::to_string(i) : std::string("other")) << "\"} "
+                << snapshot.rcodes[i] << "\n";
+        }
+    }
+
+    writeHeader(out, "zjpdns_queue_depth", "gauge", "Tasks waiting for a worker thread");
+    for (const auto& snapshot : snapshots) {
+        out << "zjpdns_queue_depth{resolver=\"" << snapshot.resolver << "\"} " << snapshot.queue_depth << "\n";
+    }
+    writeHeader(out, "zjpdns_inflight", "gauge", "Queries waiting for a response in the event loops");
+    for (const auto& snapshot : snapshots) {
+        out << "zjpdns_inflight{resolver=\"" << snapshot.resolver << "\"} " << snapshot.inflight << "\n";
+    }
+
+    writeHeader(out, "zjpdns_resolve_latency_seconds", "histogram", "Time from submission to completion");
+    for (const auto& snapshot : snapshots) {
+        writeHistogram(out, "zjpdns_resolve_latency_seconds", "resolver=\"" + snapshot.resolver + "\"",
+                       snapshot.latency);
+    }
+    writeHeader(out, "zjpdns_queue_wait_seconds", "histogram", "Time tasks wait in the executor queue");
+    for (const auto& snapshot : snapshots) {
+        writeHistogram(out, "zjpdns_queue_wait_seconds", "resolver=\"" + snapshot.resolver + "\"",
+                       snapshot.queue_wait);
+    }
+    writeHeader(out, "zjpdns_upstream_rtt_seconds", "histogram", "Round-trip time per upstream server");
+    for (const auto& snapshot : snapshots) {
+        for (const auto& upstream : snapshot.upstream_rtt) {
+            // 没有样本的服务器（例如已被替换的默认服务器）不输出
+            if (upstream.second.count == 0) continue;
+            writeHistogram(out, "zjpdns_upstream_rtt_seconds",
+                           "resolver=\"" + snapshot.resolver + "\",upstream=\"" + upstream.first + "\"",
+                           upstream.second);
+        }
+    }
+    return out.str();
+}
+
+} // namespace zjpdns
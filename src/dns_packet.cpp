@@ -1,5 +1,9 @@
 #include "dns_packet.h"
+#include "dns_packet_view.h"
+#include "dns_simd.h"
+#include "dns_tcp.h"
 #include <cstring>
+#include <cstdio>
 #include <random>
 #include <algorithm>
 #include <sys/socket.h>
@@ -8,6 +12,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <cerrno>
+#include <chrono>
 
 namespace zjpdns {
 
@@ -15,41 +21,137 @@ namespace zjpdns {
 std::vector<uint8_t> DnsPacketBuilder::buildQueryPacket(const std::string& domain,
                                                         DnsRecordType type,
                                                         DnsRecordClass class_,
-                                                        uint16_t id) {
-    std::vector<uint8_t> packet;
+                                                        uint16_t id,
+                                                        uint16_t edns_payload_size) {
+    // 头部12字节 + 编码域名（最多比域名长2字节）+ 类型和类4字节 + OPT记录
+    std::vector<uint8_t> packet(12 + domain.size() + 2 + 4 + (edns_payload_size ? DNS_OPT_RECORD_SIZE : 0));
+    packet.resize(buildQueryPacket(packet.data(), packet.size(), domain, type, class_, id, edns_payload_size));
+    return packet;
+}
+
+size_t DnsPacketBuilder::buildQueryPacket(uint8_t* buffer, size_t capacity,
+                                          std::string_view domain,
+                                          DnsRecordType type,
+                                          DnsRecordClass class_,
+                                          uint16_t id,
+                                          uint16_t edns_payload_size) {
+    if (!domain.empty() && domain.back() == '.') {
+        domain.remove_suffix(1);
+    }
+    
+    // 编码后的域名：每个标签前一个长度字节，末尾一个结束标记
+    size_t name_length = domain.empty() ? 1 : domain.size() + 2;
+    size_t length = 12 + name_length + 4 + (edns_payload_size ? DNS_OPT_RECORD_SIZE : 0);
+    if (name_length > 255 || length > capacity) {
+        return 0;
+    }
     
     // 生成事务ID
     if (id == 0) {
         id = generateTransactionId();
     }
     
-    // DNS头部 (12字节)
-    uint16_t network_id = ::htons(id);
-    uint16_t flags = ::htons(buildFlags(true, true));
-    uint16_t qdcount = ::htons(1);
-    uint16_t ancount = ::htons(0);
-    uint16_t nscount = ::htons(0);
-    uint16_t arcount = ::htons(0);
-    
-    packet.insert(packet.end(), (uint8_t*)&network_id, (uint8_t*)&network_id + 2);
-    packet.insert(packet.end(), (uint8_t*)&flags, (uint8_t*)&flags + 2);
-    packet.insert(packet.end(), (uint8_t*)&qdcount, (uint8_t*)&qdcount + 2);
-    packet.insert(packet.end(), (uint8_t*)&ancount, (uint8_t*)&ancount + 2);
-    packet.insert(packet.end(), (uint8_t*)&nscount, (uint8_t*)&nscount + 2);
-    packet.insert(packet.end(), (uint8_t*)&arcount, (uint8_t*)&arcount + 2);
+    // DNS头部 (12字节)，一次写入
+    uint16_t flags = buildFlags(true, true);
+    const uint8_t header[12] = {
+        static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id & 0xFF),
+        static_cast<uint8_t>(flags >> 8), static_cast<uint8_t>(flags & 0xFF),
+        0, 1,   // qdcount
+        0, 0,   // ancount
+        0, 0,   // nscount
+        0, static_cast<uint8_t>(edns_payload_size ? 1 : 0)    // arcount
+    };
+    memcpy(buffer, header, sizeof(header));
     
     // 编码域名
-    std::vector<uint8_t> encoded_domain = encodeDomain(domain);
-    packet.insert(packet.end(), encoded_domain.begin(), encoded_domain.end());
+    uint8_t* out = buffer + 12;
+    size_t start = 0;
+    while (start < domain.size()) {
+        size_t end = domain.find('.', start);
+        if (end == std::string_view::npos) {
+            end = domain.size();
+        }
+        
+        size_t label_length = end - start;
+        if (label_length == 0 || label_length > 63) {
+            return 0;
+        }
+        *out++ = static_cast<uint8_t>(label_length);
+        memcpy(out, domain.data() + start, label_length);
+        out += label_length;
+        start = end + 1;
+    }
+    *out++ = 0; // 结束标记
     
     // 查询类型和类
-    uint16_t network_type = ::htons(static_cast<uint16_t>(type));
-    uint16_t network_class = ::htons(static_cast<uint16_t>(class_));
+    uint16_t qtype = static_cast<uint16_t>(type);
+    uint16_t qclass = static_cast<uint16_t>(class_);
+    out[0] = static_cast<uint8_t>(qtype >> 8);
+    out[1] = static_cast<uint8_t>(qtype & 0xFF);
+    out[2] = static_cast<uint8_t>(qclass >> 8);
+    out[3] = static_cast<uint8_t>(qclass & 0xFF);
+    out += 4;
+    
+    // EDNS(0) OPT记录：根域名、类型41、类为UDP负载大小、TTL为扩展响应码/版本/标志、无选项
+    if (edns_payload_size) {
+        const uint8_t opt[DNS_OPT_RECORD_SIZE] = {
+            0, 0, 41,
+            static_cast<uint8_t>(edns_payload_size >> 8), static_cast<uint8_t>(edns_payload_size & 0xFF),
+            0, 0, 0, 0,
+            0, 0
+        };
+        memcpy(out, opt, sizeof(opt));
+    }
+    
+    return length;
+}
+
+DnsRecord DnsPacketBuilder::buildOptRecord(uint16_t payload_size,
+                                           const std::vector<EdnsOption>& options,
+                                           bool dnssec_ok) {
+    DnsRecord record;
+    record.name = "";
+    record.type = DnsRecordType::OPT;
+    record.class_ = static_cast<DnsRecordClass>(payload_size);
+    record.ttl = dnssec_ok ? 0x8000 : 0;
+    
+    for (const auto& option : options) {
+        record.data.push_back(static_cast<char>(option.code >> 8));
+        record.data.push_back(static_cast<char>(option.code & 0xFF));
+        record.data.push_back(static_cast<char>(option.data.size() >> 8));
+        record.data.push_back(static_cast<char>(option.data.size() & 0xFF));
+        record.data += option.data;
+    }
+    return record;
+}
+
+bool DnsPacketBuilder::parseOptRecord(const DnsRecord& record, EdnsInfo& info, uint16_t& rcode) {
+    if (record.type != DnsRecordType::OPT) {
+        return false;
+    }
     
-    packet.insert(packet.end(), (uint8_t*)&network_type, (uint8_t*)&network_type + 2);
-    packet.insert(packet.end(), (uint8_t*)&network_class, (uint8_t*)&network_class + 2);
+    info.present = true;
+    info.payload_size = static_cast<uint16_t>(record.class_);
+    info.version = static_cast<uint8_t>((record.ttl >> 16) & 0xFF);
+    info.dnssec_ok = (record.ttl & 0x8000) != 0;
+    rcode = static_cast<uint16_t>(((record.ttl >> 24) << 4) | (rcode & 0x0F));
     
-    return packet;
+    // 选项：代码(2) 长度(2) 数据
+    info.options.clear();
+    const std::string& data = record.data;
+    size_t offset = 0;
+    while (offset + 4 <= data.size()) {
+        uint16_t code = static_cast<uint16_t>((static_cast<uint8_t>(data[offset]) << 8) |
+                                              static_cast<uint8_t>(data[offset + 1]));
+        size_t length = (static_cast<uint8_t>(data[offset + 2]) << 8) | static_cast<uint8_t>(data[offset + 3]);
+        offset += 4;
+        if (length > data.size() - offset) {
+            return false;
+        }
+        info.options.emplace_back(code, data.substr(offset, length));
+        offset += length;
+    }
+    return offset == data.size();
 }
 
 std::vector<uint8_t> DnsPacketBuilder::buildCustomPacket(const DnsPacket& packet) {
@@ -70,10 +172,10 @@ std::vector<uint8_t> DnsPacketBuilder::buildCustomPacket(const DnsPacket& packet
     data.insert(data.end(), (uint8_t*)&network_nscount, (uint8_t*)&network_nscount + 2);
     data.insert(data.end(), (uint8_t*)&network_arcount, (uint8_t*)&network_arcount + 2);
     
-    // 问题部分
+    // 问题部分（问题和记录中的域名共用一张压缩表）
+    NameCompressionTable names;
     for (const auto& question : packet.questions) {
-        std::vector<uint8_t> encoded_domain = encodeDomain(question);
-        data.insert(data.end(), encoded_domain.begin(), encoded_domain.end());
+        encodeName(question, data, names);
         
         // 添加查询类型和类（默认为A记录和IN类）
         uint16_t network_type = ::htons(static_cast<uint16_t>(DnsRecordType::A));
@@ -84,18 +186,15 @@ std::vector<uint8_t> DnsPacketBuilder::buildCustomPacket(const DnsPacket& packet
     
     // 记录部分
     for (const auto& record : packet.answers) {
-        std::vector<uint8_t> encoded_record = encodeRecord(record);
-        data.insert(data.end(), encoded_record.begin(), encoded_record.end());
+        encodeRecord(record, data, names);
     }
     
     for (const auto& record : packet.authorities) {
-        std::vector<uint8_t> encoded_record = encodeRecord(record);
-        data.insert(data.end(), encoded_record.begin(), encoded_record.end());
+        encodeRecord(record, data, names);
     }
     
     for (const auto& record : packet.additionals) {
-        std::vector<uint8_t> encoded_record = encodeRecord(record);
-        data.insert(data.end(), encoded_record.begin(), encoded_record.end());
+        encodeRecord(record, data, names);
     }
     
     return data;
@@ -138,10 +237,7 @@ DnsResult DnsPacketBuilder::parseResponsePacket(const std::vector<uint8_t>& data
         return result;
     }
     
-    if (responseCode != 0) {
-        result.error_message = "DNS响应错误，错误码: " + std::to_string(responseCode);
-        return result;
-    }
+    result.rcode = responseCode;
     
     // 解析问题部分，提取查询的域名
     for (uint16_t i = 0; i < qdcount; ++i) {
@@ -155,7 +251,6 @@ DnsResult DnsPacketBuilder::parseResponsePacket(const std::vector<uint8_t>& data
     for (uint16_t i = 0; i < ancount; ++i) {
         if (offset >= data.size()) break;
         DnsRecord record = decodeRecord(data, offset);
-        result.records.push_back(record);
         
         // 提取IP地址
         if (record.type == DnsRecordType::A && record.data.length() == 4) {
@@ -167,6 +262,35 @@ DnsResult DnsPacketBuilder::parseResponsePacket(const std::vector<uint8_t>& data
             inet_ntop(AF_INET6, record.data.c_str(), ip, INET6_ADDRSTRLEN);
             result.addresses.push_back(ip);
         }
+        result.records.push_back(std::move(record));
+    }
+    
+    // 解析权威部分，否定应答的SOA记录用于否定缓存
+    for (uint16_t i = 0; i < nscount; ++i) {
+        if (offset >= data.size()) break;
+        result.authorities.push_back(decodeRecord(data, offset));
+    }
+    
+    // 附加部分只提取EDNS(0) OPT记录，扩展响应码并入rcode
+    result.truncated = isTruncated;
+    for (uint16_t i = 0; i < arcount; ++i) {
+        if (offset >= data.size()) break;
+        
+        // 其余记录只跳过所有者域名和RDATA，不解码
+        size_t fixed = DnsPacketView::skipName(data.data(), data.size(), offset);
+        if (fixed == 0 || fixed + 10 > data.size()) break;
+        DnsRecordType type = static_cast<DnsRecordType>(::ntohs(*reinterpret_cast<const uint16_t*>(&data[fixed])));
+        if (type == DnsRecordType::OPT && !result.edns.present) {
+            DnsRecord record = decodeRecord(data, offset);
+            parseOptRecord(record, result.edns, result.rcode);
+        } else {
+            offset = fixed + 10 + ::ntohs(*reinterpret_cast<const uint16_t*>(&data[fixed + 8]));
+        }
+    }
+    
+    if (result.rcode != 0) {
+        result.error_message = "DNS响应错误，错误码: " + std::to_string(result.rcode);
+        return result;
     }
     
     result.success = true;
@@ -221,10 +345,220 @@ DnsPacket DnsPacketBuilder::parsePacket(const std::vector<uint8_t>& data) {
     return packet;
 }
 
+// 展开后的RDATA最大长度：SRV的6字节前缀，或SOA的两个域名加20字节
+static const size_t kExpandedRdataSize = 6 + 2 * 255 + 20;
+
+// 把offset处的域名按未压缩的线路格式写入buffer[written]，域名必须在end之前结束
+static bool expandName(const uint8_t* packet, size_t packet_length, size_t& offset, size_t end,
+                       uint8_t* buffer, size_t& written) {
+    size_t next = DnsPacketView::skipName(packet, packet_length, offset);
+    if (next == 0 || next > end) {
+        return false;
+    }
+    
+    size_t position = offset;
+    size_t name_length = 0;
+    for (size_t hops = 0; hops <= DNS_MAX_POINTER_HOPS; ) {
+        uint8_t length = packet[position];
+        if ((length & 0xC0) == 0xC0) {
+            if (position + 1 >= packet_length) return false;
+            position = ((length & 0x3F) << 8) | packet[position + 1];
+            ++hops;
+            continue;
+        }
+        if ((length & 0xC0) != 0 || position + 1 + length > packet_length) return false;
+        
+        name_length += length + 1;
+        if (name_length > 255) return false;
+        memcpy(buffer + written, packet + position, length + 1);
+        written += length + 1;
+        if (length == 0) {
+            offset = next;
+            return true;
+        }
+        position += 1 + length;
+    }
+    return false;
+}
+
+// 把RDATA中的压缩域名展开到buffer（至少kExpandedRdataSize字节），使记录数据不依赖原始数据包
+// 返回展开后的长度；不含域名的类型或格式错误时返回0
+static size_t expandRecordData(DnsRecordType type, const uint8_t* packet, size_t packet_length,
+                               size_t offset, size_t length, uint8_t* buffer) {
+    // 域名之前的定长字段，SOA的两个域名之后还有20字节
+    size_t prefix = 0;
+    size_t names = 1;
+    size_t suffix = 0;
+    switch (type) {
+        case DnsRecordType::CNAME:
+        case DnsRecordType::NS:
+        case DnsRecordType::PTR:
+            break;
+        case DnsRecordType::MX:
+            prefix = 2;
+            break;
+        case DnsRecordType::SRV:
+            prefix = 6;
+            break;
+        case DnsRecordType::SOA:
+            names = 2;
+            suffix = 20;
+            break;
+        default:
+            return 0;
+    }
+    
+    size_t end = offset + length;
+    if (length < prefix + names + suffix || end > packet_length) return 0;
+    
+    memcpy(buffer, packet + offset, prefix);
+    size_t written = prefix;
+    offset += prefix;
+    for (size_t i = 0; i < names; ++i) {
+        if (!expandName(packet, packet_length, offset, end, buffer, written)) return 0;
+    }
+    if (offset + suffix != end) return 0;
+    
+    memcpy(buffer + written, packet + offset, suffix);
+    return written + suffix;
+}
+
+// 将记录视图转换为pmr记录，RDATA中的压缩域名与decodeRecord一样展开
+static void copyRecord(const DnsRecordView& view, pmr::DnsRecord& record) {
+    char name[256];
+    record.name.assign(name, view.name.decode(name, sizeof(name)));
+    record.type = static_cast<DnsRecordType>(view.type);
+    record.class_ = static_cast<DnsRecordClass>(view.class_);
+    record.ttl = view.ttl;
+    
+    uint8_t expanded[kExpandedRdataSize];
+    size_t expanded_length = expandRecordData(record.type, view.packet, view.packet_length,
+                                              view.rdata_offset, view.rdata_length, expanded);
+    if (expanded_length > 0) {
+        record.data.assign(reinterpret_cast<const char*>(expanded), expanded_length);
+    } else {
+        record.data.assign(reinterpret_cast<const char*>(view.rdata), view.rdata_length);
+    }
+}
+
+pmr::DnsResult DnsPacketBuilder::parseResponsePacket(const uint8_t* data, size_t length,
+                                                     std::pmr::memory_resource* resource) {
+    pmr::DnsResult result{pmr::DnsResult::allocator_type(resource)};
+    
+    if (length < 12) {
+        result.error_message = "DNS响应数据包太小";
+        return result;
+    }
+    
+    DnsPacketView view(data, length);
+    if (!view.isResponse()) {
+        result.error_message = "不是DNS响应数据包";
+        return result;
+    }
+    if (!view.valid()) {
+        result.error_message = "DNS响应数据包格式错误";
+        return result;
+    }
+    
+    result.rcode = view.rcode();
+    
+    // 问题部分
+    char name[256];
+    result.domains.reserve(view.qdcount());
+    for (auto question : view.questions()) {
+        result.domains.emplace_back(name, question.name.decode(name, sizeof(name)));
+    }
+    
+    // 回答部分
+    result.records.reserve(view.ancount());
+    for (auto answer : view.answers()) {
+        result.records.emplace_back();
+        copyRecord(answer, result.records.back());
+        
+        // 提取IP地址
+        char ip[INET6_ADDRSTRLEN];
+        if (answer.recordType() == DnsRecordType::A && answer.rdata_length == 4) {
+            inet_ntop(AF_INET, answer.rdata, ip, INET_ADDRSTRLEN);
+            result.addresses.emplace_back(ip);
+        } else if (answer.recordType() == DnsRecordType::AAAA && answer.rdata_length == 16) {
+            inet_ntop(AF_INET6, answer.rdata, ip, INET6_ADDRSTRLEN);
+            result.addresses.emplace_back(ip);
+        }
+    }
+    
+    // 权威部分
+    result.authorities.reserve(view.nscount());
+    for (auto authority : view.authorities()) {
+        result.authorities.emplace_back();
+        copyRecord(authority, result.authorities.back());
+    }
+    
+    // 附加部分：OPT记录TTL的最高字节为扩展响应码
+    result.truncated = view.isTruncated();
+    for (auto additional : view.additionals()) {
+        if (additional.recordType() == DnsRecordType::OPT) {
+            result.rcode = static_cast<uint16_t>(((additional.ttl >> 24) << 4) | result.rcode);
+            break;
+        }
+    }
+    
+    if (result.rcode != 0) {
+        result.error_message = "DNS响应错误，错误码: ";
+        char code[8];
+        snprintf(code, sizeof(code), "%u", static_cast<unsigned>(result.rcode));
+        result.error_message += code;
+        return result;
+    }
+    
+    result.success = true;
+    return result;
+}
+
+pmr::DnsPacket DnsPacketBuilder::parsePacket(const uint8_t* data, size_t length,
+                                             std::pmr::memory_resource* resource) {
+    pmr::DnsPacket packet{pmr::DnsPacket::allocator_type(resource)};
+    
+    DnsPacketView view(data, length);
+    if (!view.valid()) return packet;
+    
+    packet.id = view.id();
+    packet.flags = view.flags();
+    packet.qdcount = view.qdcount();
+    packet.ancount = view.ancount();
+    packet.nscount = view.nscount();
+    packet.arcount = view.arcount();
+    
+    char name[256];
+    packet.questions.reserve(packet.qdcount);
+    for (auto question : view.questions()) {
+        packet.questions.emplace_back(name, question.name.decode(name, sizeof(name)));
+    }
+    
+    packet.answers.reserve(packet.ancount);
+    for (auto record : view.answers()) {
+        packet.answers.emplace_back();
+        copyRecord(record, packet.answers.back());
+    }
+    
+    packet.authorities.reserve(packet.nscount);
+    for (auto record : view.authorities()) {
+        packet.authorities.emplace_back();
+        copyRecord(record, packet.authorities.back());
+    }
+    
+    packet.additionals.reserve(packet.arcount);
+    for (auto record : view.additionals()) {
+        packet.additionals.emplace_back();
+        copyRecord(record, packet.additionals.back());
+    }
+    
+    return packet;
+}
+
 uint16_t DnsPacketBuilder::generateTransactionId() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<uint16_t> dis(1, 65535);
+    // 每个线程独立的随机数生成器，多线程构建查询时无需加锁
+    static thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<uint16_t> dis(1, 65535);
     return dis(gen);
 }
 
@@ -295,28 +629,62 @@ std::string DnsPacketBuilder::decodeDomain(const std::vector<uint8_t>& data, siz
     return domain;
 }
 
-std::vector<uint8_t> DnsPacketBuilder::encodeRecord(const DnsRecord& record) {
-    std::vector<uint8_t> encoded;
+void DnsPacketBuilder::encodeName(const std::string& domain, std::vector<uint8_t>& data,
+                                  NameCompressionTable& names) {
+    size_t length = domain.size();
+    if (length > 0 && domain[length - 1] == '.') {
+        --length;
+    }
     
+    std::string lowered(length, '\0');
+    simd::toLowerAscii(domain.data(), length, &lowered[0]);
+    
+    size_t start = 0;
+    while (start < length) {
+        // 后缀已经出现过时写入指向它的压缩指针
+        std::string suffix = lowered.substr(start);
+        auto it = names.find(suffix);
+        if (it != names.end()) {
+            data.push_back(static_cast<uint8_t>(0xC0 | (it->second >> 8)));
+            data.push_back(static_cast<uint8_t>(it->second & 0xFF));
+            return;
+        }
+        
+        // 压缩指针只有14位，超出范围的偏移不能被引用
+        if (data.size() <= 0x3FFF) {
+            names.emplace(std::move(suffix), static_cast<uint16_t>(data.size()));
+        }
+        
+        size_t end = domain.find('.', start);
+        if (end == std::string::npos || end > length) {
+            end = length;
+        }
+        data.push_back(static_cast<uint8_t>(end - start));
+        data.insert(data.end(), domain.begin() + start, domain.begin() + end);
+        start = end + 1;
+    }
+    
+    data.push_back(0); // 结束标记
+}
+
+void DnsPacketBuilder::encodeRecord(const DnsRecord& record, std::vector<uint8_t>& data,
+                                    NameCompressionTable& names) {
     // 编码域名
-    std::vector<uint8_t> encoded_name = encodeDomain(record.name);
-    encoded.insert(encoded.end(), encoded_name.begin(), encoded_name.end());
+    encodeName(record.name, data, names);
     
     // 类型和类
     uint16_t network_type = htons(static_cast<uint16_t>(record.type));
     uint16_t network_class = htons(static_cast<uint16_t>(record.class_));
     uint32_t network_ttl = htonl(record.ttl);
     
-    encoded.insert(encoded.end(), (uint8_t*)&network_type, (uint8_t*)&network_type + 2);
-    encoded.insert(encoded.end(), (uint8_t*)&network_class, (uint8_t*)&network_class + 2);
-    encoded.insert(encoded.end(), (uint8_t*)&network_ttl, (uint8_t*)&network_ttl + 4);
+    data.insert(data.end(), (uint8_t*)&network_type, (uint8_t*)&network_type + 2);
+    data.insert(data.end(), (uint8_t*)&network_class, (uint8_t*)&network_class + 2);
+    data.insert(data.end(), (uint8_t*)&network_ttl, (uint8_t*)&network_ttl + 4);
     
     // 数据长度和数据
     uint16_t data_length = htons(static_cast<uint16_t>(record.data.length()));
-    encoded.insert(encoded.end(), (uint8_t*)&data_length, (uint8_t*)&data_length + 2);
-    encoded.insert(encoded.end(), record.data.begin(), record.data.end());
-    
-    return encoded;
+    data.insert(data.end(), (uint8_t*)&data_length, (uint8_t*)&data_length + 2);
+    data.insert(data.end(), record.data.begin(), record.data.end());
 }
 
 DnsRecord DnsPacketBuilder::decodeRecord(const std::vector<uint8_t>& data, size_t& offset) {
@@ -340,7 +708,15 @@ DnsRecord DnsPacketBuilder::decodeRecord(const std::vector<uint8_t>& data, size_
     offset += 2;
     
     if (offset + data_length <= data.size()) {
-        record.data = std::string(data.begin() + offset, data.begin() + offset + data_length);
+        // 在栈上展开后一次性赋值，每条记录只分配一次
+        uint8_t expanded[kExpandedRdataSize];
+        size_t expanded_length = expandRecordData(record.type, data.data(), data.size(), offset, data_length,
+                                                  expanded);
+        if (expanded_length > 0) {
+            record.data.assign(reinterpret_cast<const char*>(expanded), expanded_length);
+        } else {
+            record.data = std::string(data.begin() + offset, data.begin() + offset + data_length);
+        }
         offset += data_length;
     }
     
@@ -350,42 +726,522 @@ DnsRecord DnsPacketBuilder::decodeRecord(const std::vector<uint8_t>& data, size_
 
 
 // DNS数据包发送器实现
-DnsPacketSender::DnsPacketSender() : retry_count_(3) {}
+DnsPacketSender::DnsPacketSender(size_t pool_size)
+    : timeout_ms_(DNS_TIMEOUT), pool_size_(pool_size > 0 ? pool_size : 1), metrics_(nullptr),
+      tcp_(std::make_unique<DnsTcpTransport>()) {}
 
-DnsPacketSender::~DnsPacketSender() = default;
+DnsPacketSender::~DnsPacketSender() {
+    for (auto& sock : sockets_) {
+        if (sock->sockfd >= 0) {
+            close(sock->sockfd);
+        }
+    }
+}
 
 DnsResult DnsPacketSender::sendPacket(const std::string& server, uint16_t port,
                                      const std::vector<uint8_t>& packet, int timeout_ms) {
     DnsResult result;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
     
-    int sockfd = createSocket();
-    if (sockfd < 0) {
-        result.error_message = "Create socket failed";
+    // 不足头部长度的数据包（如buildQueryPacket拒绝域名时返回的空数据包）不发送
+    if (packet.size() < 12) {
+        result.error_message = "Invalid DNS query packet";
         return result;
     }
     
-    // 发送数据
-    if (!sendData(sockfd, packet, server, port)) {
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
         result.error_message = "Send DNS packet failed";
-        close(sockfd);
         return result;
     }
     
-    // 接收响应
-    std::vector<uint8_t> response = receiveData(sockfd, timeout_ms);
-    close(sockfd);
+    // 总超时拆分为多次尝试，每次重传更换socket（源端口）和事务ID
+    std::vector<int> timeouts = retryPolicy().attemptTimeouts(timeout_ms);
+    std::vector<uint8_t> response;
+    std::vector<uint8_t> retransmit;
+    PooledSocket* sock = nullptr;
+    for (size_t attempt = 0; attempt < timeouts.size() && response.empty(); ++attempt) {
+        sock = acquireSocket(sock);
+        if (!sock) {
+            result.error_message = "Create socket failed";
+            return result;
+        }
+        
+        const std::vector<uint8_t>* attempt_packet = &packet;
+        if (attempt > 0 && packet.size() >= 12) {
+            retransmit = packet;
+            uint16_t id = DnsPacketBuilder::generateTransactionId();
+            retransmit[0] = static_cast<uint8_t>(id >> 8);
+            retransmit[1] = static_cast<uint8_t>(id & 0xFF);
+            attempt_packet = &retransmit;
+        }
+        
+        // 注册等待者
+        Waiter waiter;
+        waiter.server_addr = server_addr;
+        std::vector<uint8_t> rewritten;
+        const std::vector<uint8_t>* query;
+        {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            query = registerWaiter(*sock, waiter, *attempt_packet, rewritten);
+        }
+        
+        // 发送数据
+        if (!sendData(sock->sockfd, *query, waiter.server_addr)) {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            sock->waiters.erase(waiter.key);
+            result.error_message = "Send DNS packet failed";
+            continue;
+        }
+        if (metrics_) {
+            (attempt == 0 ? metrics_->queries : metrics_->retransmits).add();
+        }
+        
+        // 接收响应，最后一次尝试等到总超时
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        std::vector<Waiter*> waiters(1, &waiter);
+        receiveData(*sock, waiters, attempt + 1 == timeouts.size() ? std::max(remaining, 0)
+                                                                   : std::min(timeouts[attempt], remaining));
+        
+        if (waiter.done) {
+            response = std::move(waiter.response);
+        } else {
+            result.error_message = "Receive DNS response timeout";
+            if (metrics_) metrics_->timeouts.add();
+        }
+    }
     
     if (response.empty()) {
-        result.error_message = "Receive DNS response timeout";
         return result;
     }
     
-    // 解析响应
-    return DnsPacketBuilder::parseResponsePacket(response);
+    // 解析响应，被截断的应答通过TCP重新查询
+    result = DnsPacketBuilder::parseResponsePacket(response);
+    if (result.truncated) {
+        if (metrics_) metrics_->tcp_fallbacks.add();
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        return tcp_->query(server, port, packet, std::max(remaining, 0));
+    }
+    return result;
+}
+
+DnsResult DnsPacketSender::sendPacketHedged(const DnsServer& primary, const DnsServer& secondary,
+                                           const std::vector<uint8_t>& packet, int hedge_delay_ms,
+                                           int timeout_ms, int& winner) {
+    DnsResult result;
+    winner = -1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    
+    if (packet.size() < 12) {
+        result.error_message = "Invalid DNS query packet";
+        return result;
+    }
+    
+    Waiter waiters[2];
+    const DnsServer* servers[2] = {&primary, &secondary};
+    for (int i = 0; i < 2; ++i) {
+        waiters[i].server_addr.sin_family = AF_INET;
+        waiters[i].server_addr.sin_port = htons(servers[i]->port);
+        if (inet_pton(AF_INET, servers[i]->address.c_str(), &waiters[i].server_addr.sin_addr) <= 0) {
+            result.error_message = "Send DNS packet failed";
+            return result;
+        }
+    }
+    
+    PooledSocket* sock = acquireSocket();
+    if (!sock) {
+        result.error_message = "Create socket failed";
+        return result;
+    }
+    
+    // 两个查询在同一socket上等待，第二个查询的事务ID会被更换
+    std::vector<uint8_t> rewritten[2];
+    std::vector<Waiter*> pending;
+    auto send = [&](int i) {
+        const std::vector<uint8_t>* query;
+        {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            query = registerWaiter(*sock, waiters[i], packet, rewritten[i]);
+        }
+        if (!sendData(sock->sockfd, *query, waiters[i].server_addr)) {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            sock->waiters.erase(waiters[i].key);
+            return;
+        }
+        pending.push_back(&waiters[i]);
+        if (metrics_) metrics_->queries.add();
+    };
+    
+    // 首选服务器在竞速延迟内应答则不再发送第二个查询；首选服务器发送失败时立即改发次选服务器
+    send(0);
+    if (!pending.empty()) {
+        receiveData(*sock, pending, std::min(hedge_delay_ms, timeout_ms), true, false);
+    }
+    int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count());
+    if (!waiters[0].done && remaining > 0) {
+        send(1);
+    }
+    receiveData(*sock, pending, std::max(remaining, 0), true, true);
+    
+    winner = waiters[0].done ? 0 : (waiters[1].done ? 1 : -1);
+    if (winner < 0 && metrics_) {
+        metrics_->timeouts.add(pending.size());
+    }
+    if (winner < 0) {
+        result.error_message = pending.empty() ? "Send DNS packet failed" : "Receive DNS response timeout";
+        return result;
+    }
+    
+    // 被截断的应答通过TCP向应答的服务器重新查询
+    result = DnsPacketBuilder::parseResponsePacket(waiters[winner].response);
+    if (result.truncated) {
+        if (metrics_) metrics_->tcp_fallbacks.add();
+        remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        return tcp_->query(servers[winner]->address, servers[winner]->port, packet, std::max(remaining, 0));
+    }
+    return result;
+}
+
+std::vector<DnsResult> DnsPacketSender::sendParallel(const std::string& server, uint16_t port,
+                                                     const std::vector<std::vector<uint8_t>>& packets,
+                                                     int grace_ms, int timeout_ms) {
+    std::vector<DnsResult> results(packets.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
+        for (auto& result : results) {
+            result.error_message = "Send DNS packet failed";
+        }
+        return results;
+    }
+    
+    PooledSocket* sock = acquireSocket();
+    if (!sock) {
+        for (auto& result : results) {
+            result.error_message = "Create socket failed";
+        }
+        return results;
+    }
+    
+    // 所有查询在同一socket上等待
+    std::vector<Waiter> waiters(packets.size());
+    std::vector<std::vector<uint8_t>> rewritten(packets.size());
+    std::vector<Waiter*> pending;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (packets[i].size() < 12) {
+            results[i].error_message = "Invalid DNS query packet";
+            continue;
+        }
+        waiters[i].server_addr = server_addr;
+        const std::vector<uint8_t>* query;
+        {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            query = registerWaiter(*sock, waiters[i], packets[i], rewritten[i]);
+        }
+        if (!sendData(sock->sockfd, *query, server_addr)) {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            sock->waiters.erase(waiters[i].key);
+            results[i].error_message = "Send DNS packet failed";
+            continue;
+        }
+        pending.push_back(&waiters[i]);
+        if (metrics_) metrics_->queries.add();
+    }
+    
+    // 每收到一个应答就处理，第一个带地址的应答把截止时间提前到宽限期结束
+    bool grace = false;
+    while (!pending.empty()) {
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        if (remaining <= 0) break;
+        receiveData(*sock, pending, remaining, true, false);
+        
+        for (size_t k = 0; k < pending.size();) {
+            if (!pending[k]->done) {
+                ++k;
+                continue;
+            }
+            
+            DnsResult& result = results[pending[k] - waiters.data()];
+            result = DnsPacketBuilder::parseResponsePacket(pending[k]->response);
+            if (!grace && result.success && !result.addresses.empty()) {
+                grace = true;
+                deadline = std::min(deadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(grace_ms));
+            }
+            {
+                std::lock_guard<std::mutex> lock(sock->mutex);
+                sock->waiters.erase(pending[k]->key);
+            }
+            pending.erase(pending.begin() + k);
+        }
+    }
+    
+    if (!pending.empty()) {
+        std::lock_guard<std::mutex> lock(sock->mutex);
+        for (Waiter* waiter : pending) {
+            sock->waiters.erase(waiter->key);
+            results[waiter - waiters.data()].error_message = "Receive DNS response timeout";
+        }
+        
+        // 宽限期结束后放弃的查询不计为超时
+        if (metrics_ && !grace) {
+            metrics_->timeouts.add(pending.size());
+        }
+    }
+    
+    // 被截断的应答通过TCP重新查询
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].truncated) {
+            if (metrics_) metrics_->tcp_fallbacks.add();
+            int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            results[i] = tcp_->query(server, port, packets[i], std::max(remaining, 0));
+        }
+    }
+    return results;
+}
+
+DnsResult DnsPacketSender::sendPacketTcp(const std::string& server, uint16_t port,
+                                        const std::vector<uint8_t>& packet, int timeout_ms) {
+    return tcp_->query(server, port, packet, timeout_ms);
+}
+
+std::vector<DnsResult> DnsPacketSender::sendBatch(const std::string& server, uint16_t port,
+                                                  const std::vector<std::vector<uint8_t>>& packets,
+                                                  int timeout_ms, std::vector<double>* rtts) {
+    std::vector<DnsResult> results(packets.size());
+    if (rtts) {
+        rtts->assign(packets.size(), -1);
+    }
+    if (packets.empty()) {
+        return results;
+    }
+    
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
+        for (auto& result : results) {
+            result.error_message = "Send DNS packet failed";
+        }
+        return results;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::vector<int> timeouts = retryPolicy().attemptTimeouts(timeout_ms);
+    // 不足头部长度的数据包不发送
+    std::vector<size_t> pending;
+    pending.reserve(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (packets[i].size() < 12) {
+            results[i].error_message = "Invalid DNS query packet";
+            continue;
+        }
+        pending.push_back(i);
+    }
+    
+    // 每次尝试只重传尚未收到应答的查询，并更换socket（源端口）和事务ID
+    PooledSocket* sock = nullptr;
+    for (size_t attempt = 0; attempt < timeouts.size() && !pending.empty(); ++attempt) {
+        sock = acquireSocket(sock);
+        if (!sock) {
+            for (size_t i : pending) {
+                results[i].error_message = "Create socket failed";
+            }
+            break;
+        }
+        
+        // 一次性注册所有等待者
+        size_t count = pending.size();
+        std::vector<Waiter> waiters(count);
+        std::vector<std::vector<uint8_t>> retransmit(count);
+        std::vector<std::vector<uint8_t>> rewritten(count);
+        std::vector<struct iovec> iovs(count);
+        std::vector<struct mmsghdr> msgs(count);
+        {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            for (size_t k = 0; k < count; ++k) {
+                const std::vector<uint8_t>* packet = &packets[pending[k]];
+                if (attempt > 0 && packet->size() >= 12) {
+                    retransmit[k] = *packet;
+                    uint16_t id = DnsPacketBuilder::generateTransactionId();
+                    retransmit[k][0] = static_cast<uint8_t>(id >> 8);
+                    retransmit[k][1] = static_cast<uint8_t>(id & 0xFF);
+                    packet = &retransmit[k];
+                }
+                
+                waiters[k].server_addr = server_addr;
+                const std::vector<uint8_t>* query = registerWaiter(*sock, waiters[k], *packet, rewritten[k]);
+                
+                iovs[k].iov_base = const_cast<uint8_t*>(query->data());
+                iovs[k].iov_len = query->size();
+                memset(&msgs[k], 0, sizeof(msgs[k]));
+                msgs[k].msg_hdr.msg_name = &server_addr;
+                msgs[k].msg_hdr.msg_namelen = sizeof(server_addr);
+                msgs[k].msg_hdr.msg_iov = &iovs[k];
+                msgs[k].msg_hdr.msg_iovlen = 1;
+            }
+        }
+        
+        // 批量发送，发送缓冲区满时等待可写
+        auto sent_at = std::chrono::steady_clock::now();
+        size_t sent = 0;
+        while (sent < count) {
+            unsigned int batch = static_cast<unsigned int>(std::min<size_t>(count - sent, DNS_MMSG_BATCH));
+            int n = sendmmsg(sock->sockfd, &msgs[sent], batch, 0);
+            if (n > 0) {
+                sent += n;
+                continue;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                break;
+            }
+            
+            int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            struct pollfd pfd;
+            pfd.fd = sock->sockfd;
+            pfd.events = POLLOUT;
+            if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) {
+                break;
+            }
+        }
+        
+        if (metrics_) {
+            (attempt == 0 ? metrics_->queries : metrics_->retransmits).add(sent);
+        }
+        
+        // 未能发送的查询留到下一次尝试
+        std::vector<size_t> next;
+        if (sent < count) {
+            std::lock_guard<std::mutex> lock(sock->mutex);
+            for (size_t k = sent; k < count; ++k) {
+                sock->waiters.erase(waiters[k].key);
+                results[pending[k]].error_message = "Send DNS packet failed";
+                next.push_back(pending[k]);
+            }
+        }
+        
+        // 等待已发送查询的响应，最后一次尝试等到总超时
+        std::vector<Waiter*> sent_waiters;
+        sent_waiters.reserve(sent);
+        for (size_t k = 0; k < sent; ++k) {
+            sent_waiters.push_back(&waiters[k]);
+        }
+        int remaining = std::max(0, static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count()));
+        receiveData(*sock, sent_waiters,
+                    attempt + 1 == timeouts.size() ? remaining : std::min(timeouts[attempt], remaining));
+        
+        for (size_t k = 0; k < sent; ++k) {
+            size_t i = pending[k];
+            if (!waiters[k].done) {
+                results[i].error_message = "Receive DNS response timeout";
+                next.push_back(i);
+                if (metrics_) metrics_->timeouts.add();
+                continue;
+            }
+            results[i] = DnsPacketBuilder::parseResponsePacket(waiters[k].response);
+            if (rtts) {
+                (*rtts)[i] = std::chrono::duration<double, std::milli>(waiters[k].received - sent_at).count();
+            }
+        }
+        pending.swap(next);
+    }
+    
+    // 被截断的应答在同一TCP连接上流水线重新查询
+    std::vector<size_t> truncated;
+    std::vector<std::vector<uint8_t>> tcp_packets;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].truncated) {
+            truncated.push_back(i);
+            tcp_packets.push_back(packets[i]);
+        }
+    }
+    if (!truncated.empty()) {
+        if (metrics_) metrics_->tcp_fallbacks.add(truncated.size());
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        std::vector<DnsResult> tcp_results = tcp_->queryBatch(server, port, tcp_packets, std::max(remaining, 0));
+        for (size_t k = 0; k < truncated.size(); ++k) {
+            results[truncated[k]] = std::move(tcp_results[k]);
+        }
+    }
+    
+    return results;
 }
 
 void DnsPacketSender::setRetryCount(int count) {
-    retry_count_ = count;
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    retry_policy_.retries = count;
+}
+
+void DnsPacketSender::setMetrics(ResolverMetrics* metrics) {
+    metrics_ = metrics;
+}
+
+void DnsPacketSender::setRetryPolicy(const RetryPolicy& policy) {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    retry_policy_ = policy;
+}
+
+RetryPolicy DnsPacketSender::retryPolicy() {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return retry_policy_;
+}
+
+std::string DnsPacketSender::makeWaiterKey(const uint8_t* data, size_t length) {
+    std::string key;
+    if (length < 12) {
+        return key;
+    }
+    
+    // 事务ID
+    key.append(reinterpret_cast<const char*>(data), 2);
+    
+    uint16_t qdcount = static_cast<uint16_t>((data[4] << 8) | data[5]);
+    if (qdcount == 0) {
+        return key;
+    }
+    
+    // 第一个问题的域名（不区分大小写，兼容0x20编码）
+    size_t offset = 12;
+    while (offset < length) {
+        uint8_t label_length = data[offset];
+        if (label_length == 0 || (label_length & 0xC0) != 0) {
+            size_t end = std::min(length, offset + (label_length == 0 ? 1 : 2));
+            key.append(reinterpret_cast<const char*>(data + offset), end - offset);
+            offset = end;
+            break;
+        }
+        
+        size_t end = std::min(length, offset + 1 + label_length);
+        key.push_back(static_cast<char>(label_length));
+        for (size_t i = offset + 1; i < end; ++i) {
+            uint8_t c = data[i];
+            key.push_back(static_cast<char>((c >= 'A' && c <= 'Z') ? c + 32 : c));
+        }
+        offset = end;
+    }
+    
+    // 查询类型和类
+    if (offset + 4 <= length) {
+        key.append(reinterpret_cast<const char*>(data + offset), 4);
+    }
+    
+    return key;
 }
 
 int DnsPacketSender::createSocket() {
@@ -396,45 +1252,191 @@ int DnsPacketSender::createSocket() {
     int flags = fcntl(sockfd, F_GETFL, 0);
     fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
     
+    // 加大接收缓冲区，避免大量在途查询的响应集中到达时被丢弃
+    int rcvbuf = DNS_SOCKET_RCVBUF;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    
+    // 绑定随机源端口，多次冲突后交由内核分配
+    static thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<int> dis(1024, 65535);
+    
+    struct sockaddr_in local_addr;
+    memset(&local_addr, 0, sizeof(local_addr));
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        local_addr.sin_port = htons(static_cast<uint16_t>(dis(gen)));
+        if (bind(sockfd, (struct sockaddr*)&local_addr, sizeof(local_addr)) == 0) {
+            return sockfd;
+        }
+    }
+    
+    local_addr.sin_port = 0;
+    bind(sockfd, (struct sockaddr*)&local_addr, sizeof(local_addr));
     return sockfd;
 }
 
-bool DnsPacketSender::sendData(int sockfd, const std::vector<uint8_t>& data,
-                              const std::string& server, uint16_t port) {
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(port);
+DnsPacketSender::PooledSocket* DnsPacketSender::acquireSocket(PooledSocket* previous) {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    
+    // 首次使用时创建socket池
+    if (sockets_.empty()) {
+        for (size_t i = 0; i < pool_size_; ++i) {
+            int sockfd = createSocket();
+            if (sockfd < 0) continue;
+            
+            auto sock = std::make_unique<PooledSocket>();
+            sock->sockfd = sockfd;
+            sockets_.push_back(std::move(sock));
+        }
+    }
     
-    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
-        return false;
+    if (sockets_.empty()) {
+        return nullptr;
     }
     
+    // 重传时避开上一次使用的socket，使源端口不同
+    static thread_local std::mt19937 gen(std::random_device{}());
+    size_t index = gen() % sockets_.size();
+    if (sockets_[index].get() == previous && sockets_.size() > 1) {
+        index = (index + 1) % sockets_.size();
+    }
+    return sockets_[index].get();
+}
+
+bool DnsPacketSender::sendData(int sockfd, const std::vector<uint8_t>& data,
+                              const struct sockaddr_in& server_addr) {
     ssize_t sent = sendto(sockfd, data.data(), data.size(), 0,
-                          (struct sockaddr*)&server_addr, sizeof(server_addr));
+                          (const struct sockaddr*)&server_addr, sizeof(server_addr));
     
     return sent == static_cast<ssize_t>(data.size());
 }
 
-std::vector<uint8_t> DnsPacketSender::receiveData(int sockfd, int timeout_ms = DNS_TIMEOUT) {
-    std::vector<uint8_t> buffer(4096);
-    
-    struct pollfd pfd;
-    pfd.fd = sockfd;
-    pfd.events = POLLIN;
-    
-    int poll_result = poll(&pfd, 1, timeout_ms);
-    if (poll_result <= 0) {
-        return std::vector<uint8_t>();
+const std::vector<uint8_t>* DnsPacketSender::registerWaiter(PooledSocket& sock, Waiter& waiter,
+                                                           const std::vector<uint8_t>& packet,
+                                                           std::vector<uint8_t>& rewritten) {
+    const std::vector<uint8_t>* query = &packet;
+    waiter.key = makeWaiterKey(packet.data(), packet.size());
+    
+    // 同一socket上已有相同事务ID和问题的查询在等待，更换事务ID避免响应串包
+    while (sock.waiters.count(waiter.key) && packet.size() >= 12) {
+        rewritten = packet;
+        uint16_t id = DnsPacketBuilder::generateTransactionId();
+        rewritten[0] = static_cast<uint8_t>(id >> 8);
+        rewritten[1] = static_cast<uint8_t>(id & 0xFF);
+        waiter.key = makeWaiterKey(rewritten.data(), rewritten.size());
+        query = &rewritten;
     }
-    
-    ssize_t received = recv(sockfd, buffer.data(), buffer.size(), 0);
-    if (received <= 0) {
-        return std::vector<uint8_t>();
+    sock.waiters[waiter.key] = &waiter;
+    return query;
+}
+
+void DnsPacketSender::receiveData(PooledSocket& sock, std::vector<Waiter*>& waiters, int timeout_ms,
+                                  bool any, bool unregister) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    size_t next = 0;   // 第一个尚未完成的等待者
+    
+    std::unique_lock<std::mutex> lock(sock.mutex);
+    while (true) {
+        while (next < waiters.size() && waiters[next]->done) {
+            ++next;
+        }
+        if (next == waiters.size()) break;
+        if (any && std::any_of(waiters.begin(), waiters.end(), [](Waiter* w) { return w->done; })) break;
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+        
+        // 其他线程正在读取，等待其分发响应或让出读取权
+        if (sock.reading) {
+            sock.cv.wait_until(lock, deadline);
+            continue;
+        }
+        
+        sock.reading = true;
+        lock.unlock();
+        
+        int remaining = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        
+        std::vector<std::pair<struct sockaddr_in, std::vector<uint8_t>>> datagrams;
+        struct pollfd pfd;
+        pfd.fd = sock.sockfd;
+        pfd.events = POLLIN;
+        
+        if (poll(&pfd, 1, remaining) > 0) {
+            readDatagrams(sock, datagrams);
+        }
+        
+        lock.lock();
+        dispatch(sock, datagrams);
+        sock.reading = false;
+        sock.cv.notify_all();
     }
     
-    buffer.resize(received);
-    return buffer;
+    if (unregister) {
+        for (Waiter* waiter : waiters) {
+            sock.waiters.erase(waiter->key);
+        }
+    }
+}
+
+void DnsPacketSender::readDatagrams(PooledSocket& sock,
+                                    std::vector<std::pair<struct sockaddr_in, std::vector<uint8_t>>>& datagrams) {
+    // 使用recvmmsg一次读取多个数据报，接收缓冲区随socket保留，避免每次唤醒都分配并清零
+    std::vector<uint8_t>& buffer = sock.buffer;
+    if (buffer.empty()) {
+        buffer.resize(DNS_MMSG_RECV_BATCH * DNS_UDP_BUFFER_SIZE);
+    }
+    struct mmsghdr msgs[DNS_MMSG_RECV_BATCH];
+    struct iovec iovs[DNS_MMSG_RECV_BATCH];
+    struct sockaddr_in addrs[DNS_MMSG_RECV_BATCH];
+    
+    while (true) {
+        for (size_t i = 0; i < DNS_MMSG_RECV_BATCH; ++i) {
+            iovs[i].iov_base = buffer.data() + i * DNS_UDP_BUFFER_SIZE;
+            iovs[i].iov_len = DNS_UDP_BUFFER_SIZE;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        
+        int count = recvmmsg(sock.sockfd, msgs, DNS_MMSG_RECV_BATCH, MSG_DONTWAIT, nullptr);
+        if (count <= 0) break;
+        
+        for (int i = 0; i < count; ++i) {
+            const uint8_t* data = static_cast<const uint8_t*>(iovs[i].iov_base);
+            datagrams.emplace_back(addrs[i], std::vector<uint8_t>(data, data + msgs[i].msg_len));
+        }
+        
+        if (count < static_cast<int>(DNS_MMSG_RECV_BATCH)) break;
+    }
+}
+
+void DnsPacketSender::dispatch(PooledSocket& sock,
+                               std::vector<std::pair<struct sockaddr_in, std::vector<uint8_t>>>& datagrams) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& datagram : datagrams) {
+        auto it = sock.waiters.find(makeWaiterKey(datagram.second.data(), datagram.second.size()));
+        if (it == sock.waiters.end()) {
+            continue; // 迟到或伪造的响应
+        }
+        
+        Waiter* waiter = it->second;
+        const struct sockaddr_in& from = datagram.first;
+        if (waiter->done ||
+            from.sin_addr.s_addr != waiter->server_addr.sin_addr.s_addr ||
+            from.sin_port != waiter->server_addr.sin_port) {
+            continue;
+        }
+        
+        waiter->response = std::move(datagram.second);
+        waiter->received = now;
+        waiter->done = true;
+    }
 }
 
-} // namespace zjpdns 
\ No newline at end of file
+} // namespace zjpdns
@@ -0,0 +1,188 @@
+#include "dns_packet_view.h"
+
+namespace zjpdns {
+
+// 域名视图实现
+std::string DnsNameView::toString() const {
+    char buffer[256];
+    size_t length = decode(buffer, sizeof(buffer));
+    return std::string(buffer, length);
+}
+
+size_t DnsNameView::decode(char* out, size_t capacity) const {
+    size_t written = 0;
+    bool overflow = false;
+
+    bool ok = forEachLabel([&](const uint8_t* label, uint8_t length) {
+        if (written + length + 1 > capacity) {
+            overflow = true;
+            return false;
+        }
+        for (uint8_t i = 0; i < length; ++i) {
+            out[written++] = static_cast<char>(label[i]);
+        }
+        out[written++] = '.';
+        return true;
+    });
+
+    return (ok && !overflow) ? written : 0;
+}
+
+bool DnsNameView::equals(std::string_view name) const {
+    if (!name.empty() && name.back() == '.') {
+        name.remove_suffix(1);
+    }
+
+    size_t pos = 0;
+    bool matched = true;
+    bool ok = forEachLabel([&](const uint8_t* label, uint8_t length) {
+        // 前一个标签之后必须是点
+        if (pos > 0) {
+            if (pos >= name.size() || name[pos] != '.') {
+                matched = false;
+                return false;
+            }
+            ++pos;
+        }
+
+        if (pos + length > name.size()) {
+            matched = false;
+            return false;
+        }
+        for (uint8_t i = 0; i < length; ++i) {
+            uint8_t a = label[i];
+            uint8_t b = static_cast<uint8_t>(name[pos + i]);
+            if (a >= 'A' && a <= 'Z') a += 32;
+            if (b >= 'A' && b <= 'Z') b += 32;
+            if (a != b) {
+                matched = false;
+                return false;
+            }
+        }
+        pos += length;
+        return true;
+    });
+
+    return ok && matched && pos == name.size();
+}
+
+// 数据包视图实现
+DnsPacketView::DnsPacketView(const uint8_t* data, size_t length)
+    : data_(data), length_(length), valid_(false),
+      answers_offset_(0), authorities_offset_(0), additionals_offset_(0) {
+    if (!data_ || length_ < 12) {
+        return;
+    }
+
+    // 问题部分
+    size_t offset = 12;
+    for (uint16_t i = 0; i < qdcount(); ++i) {
+        offset = skipName(data_, length_, offset);
+        if (offset == 0 || offset + 4 > length_) return;
+        offset += 4;
+    }
+    answers_offset_ = offset;
+
+    // 记录部分
+    authorities_offset_ = skipRecords(answers_offset_, ancount());
+    if (authorities_offset_ == 0) return;
+    additionals_offset_ = skipRecords(authorities_offset_, nscount());
+    if (additionals_offset_ == 0) return;
+    if (skipRecords(additionals_offset_, arcount()) == 0) return;
+
+    valid_ = true;
+}
+
+DnsPacketView::QuestionIterator& DnsPacketView::QuestionIterator::operator++() {
+    offset_ = skipName(view_->data_, view_->length_, offset_) + 4;
+    --remaining_;
+    return *this;
+}
+
+DnsPacketView::RecordIterator& DnsPacketView::RecordIterator::operator++() {
+    offset_ = view_->skipRecords(offset_, 1);
+    --remaining_;
+    return *this;
+}
+
+DnsPacketView::Range<DnsPacketView::QuestionIterator> DnsPacketView::questions() const {
+    size_t count = valid_ ? qdcount() : 0;
+    return Range<QuestionIterator>{QuestionIterator(this, 12, count), QuestionIterator(this, 0, 0)};
+}
+
+DnsPacketView::Range<DnsPacketView::RecordIterator> DnsPacketView::answers() const {
+    return recordRange(answers_offset_, ancount());
+}
+
+DnsPacketView::Range<DnsPacketView::RecordIterator> DnsPacketView::authorities() const {
+    return recordRange(authorities_offset_, nscount());
+}
+
+DnsPacketView::Range<DnsPacketView::RecordIterator> DnsPacketView::additionals() const {
+    return recordRange(additionals_offset_, arcount());
+}
+
+DnsQuestionView DnsPacketView::questionAt(size_t offset) const {
+    DnsQuestionView question;
+    question.name = DnsNameView(data_, length_, offset);
+    question.offset = offset;
+
+    size_t end = skipName(data_, length_, offset);
+    question.type = read16(end);
+    question.class_ = read16(end + 2);
+    return question;
+}
+
+DnsRecordView DnsPacketView::recordAt(size_t offset) const {
+    DnsRecordView record;
+    record.name = DnsNameView(data_, length_, offset);
+    record.offset = offset;
+
+    size_t end = skipName(data_, length_, offset);
+    record.type = read16(end);
+    record.class_ = read16(end + 2);
+    record.ttl = (static_cast<uint32_t>(read16(end + 4)) << 16) | read16(end + 6);
+    record.rdata_length = read16(end + 8);
+    record.rdata_offset = end + 10;
+    record.rdata = data_ + record.rdata_offset;
+    record.packet = data_;
+    record.packet_length = length_;
+    return record;
+}
+
+size_t DnsPacketView::skipName(const uint8_t* data, size_t length, size_t offset) {
+    while (offset < length) {
+        uint8_t label_length = data[offset];
+        if (label_length == 0) {
+            return offset + 1;
+        }
+        if ((label_length & 0xC0) == 0xC0) {
+            return offset + 2 <= length ? offset + 2 : 0;
+        }
+        if ((label_length & 0xC0) != 0) {
+            return 0;
+        }
+        offset += 1 + label_length;
+    }
+    return 0;
+}
+
+size_t DnsPacketView::skipRecords(size_t offset, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        offset = skipName(data_, length_, offset);
+        if (offset == 0 || offset + 10 > length_) return 0;
+
+        uint16_t rdata_length = read16(offset + 8);
+        offset += 10 + rdata_length;
+        if (offset > length_) return 0;
+    }
+    return offset;
+}
+
+DnsPacketView::Range<DnsPacketView::RecordIterator> DnsPacketView::recordRange(size_t offset,
+                                                                                uint16_t count) const {
+    size_t remaining = valid_ ? count : 0;
+    return Range<RecordIterator>{RecordIterator(this, offset, remaining), RecordIterator(this, 0, 0)};
+}
+
+} // namespace zjpdns
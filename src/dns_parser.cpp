@@ -2,15 +2,45 @@
 #include "dns_resolver.h"
 #include "async_resolver.h"
 
+#include <algorithm>
+#include <random>
+
 namespace zjpdns {
 
+std::vector<int> RetryPolicy::attemptTimeouts(int timeout_ms) const {
+    std::vector<int> timeouts;
+    if (retries <= 0 || initial_timeout_ms <= 0) {
+        timeouts.push_back(timeout_ms);
+        return timeouts;
+    }
+    
+    static thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_real_distribution<double> dis(-1.0, 1.0);
+    
+    int remaining = timeout_ms;
+    double timeout = initial_timeout_ms;
+    for (int attempt = 0; attempt < retries; ++attempt) {
+        int jittered = std::max(1, static_cast<int>(timeout * (1.0 + jitter * dis(gen))));
+        if (jittered >= remaining) {
+            break;
+        }
+        timeouts.push_back(jittered);
+        remaining -= jittered;
+        timeout *= backoff;
+    }
+    
+    // 最后一次尝试使用剩余时间
+    timeouts.push_back(remaining);
+    return timeouts;
+}
+
 // 工厂函数实现
 std::unique_ptr<DnsResolver> createDnsResolver() {
     return std::make_unique<DnsResolverImpl>();
 }
 
-std::unique_ptr<AsyncDnsResolver> createAsyncDnsResolver() {
-    auto resolver = std::make_unique<AsyncDnsResolverImpl>();
+std::unique_ptr<AsyncDnsResolver> createAsyncDnsResolver(size_t thread_count) {
+    auto resolver = std::make_unique<AsyncDnsResolverImpl>(thread_count);
     resolver->start(); // 启动工作线程
     return resolver;
 }
@@ -0,0 +1,154 @@
+#include "dns_rdata.h"
+#include "dns_packet_view.h"
+
+namespace zjpdns {
+namespace rdata {
+
+static inline uint16_t read16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// 读取offset处的域名，域名必须在end之前结束
+static bool readName(const uint8_t* packet, size_t length, size_t& offset, size_t end, std::string& out) {
+    size_t next = DnsPacketView::skipName(packet, length, offset);
+    if (next == 0 || next > end) {
+        return false;
+    }
+
+    // 根域名
+    if (packet[offset] == 0) {
+        out.clear();
+        offset = next;
+        return true;
+    }
+
+    char buffer[256];
+    size_t written = DnsNameView(packet, length, offset).decode(buffer, sizeof(buffer));
+    if (written == 0) {
+        return false;
+    }
+    out.assign(buffer, written);
+    offset = next;
+    return true;
+}
+
+// RDATA必须完整位于数据包内
+static inline bool checkBounds(size_t length, size_t rdata_offset, size_t rdata_length) {
+    return rdata_offset <= length && rdata_length <= length - rdata_offset;
+}
+
+bool decodeMx(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, MxData& out) {
+    size_t end = rdata_offset + rdata_length;
+    if (!checkBounds(length, rdata_offset, rdata_length) || rdata_length < 3) return false;
+
+    out.preference = read16(packet + rdata_offset);
+    size_t offset = rdata_offset + 2;
+    return readName(packet, length, offset, end, out.exchange) && offset == end;
+}
+
+bool decodeSrv(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, SrvData& out) {
+    size_t end = rdata_offset + rdata_length;
+    if (!checkBounds(length, rdata_offset, rdata_length) || rdata_length < 7) return false;
+
+    out.priority = read16(packet + rdata_offset);
+    out.weight = read16(packet + rdata_offset + 2);
+    out.port = read16(packet + rdata_offset + 4);
+    size_t offset = rdata_offset + 6;
+    return readName(packet, length, offset, end, out.target) && offset == end;
+}
+
+bool decodeSoa(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, SoaData& out) {
+    size_t end = rdata_offset + rdata_length;
+    if (!checkBounds(length, rdata_offset, rdata_length)) return false;
+
+    size_t offset = rdata_offset;
+    if (!readName(packet, length, offset, end, out.mname) ||
+        !readName(packet, length, offset, end, out.rname) ||
+        offset + 20 != end) {
+        return false;
+    }
+
+    out.serial = read32(packet + offset);
+    out.refresh = read32(packet + offset + 4);
+    out.retry = read32(packet + offset + 8);
+    out.expire = read32(packet + offset + 12);
+    out.minimum = read32(packet + offset + 16);
+    return true;
+}
+
+bool decodeTxt(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, TxtData& out) {
+    size_t end = rdata_offset + rdata_length;
+    if (!checkBounds(length, rdata_offset, rdata_length) || rdata_length == 0) return false;
+
+    // 一个或多个<长度><字符串>
+    out.strings.clear();
+    size_t offset = rdata_offset;
+    while (offset < end) {
+        size_t string_length = packet[offset++];
+        if (string_length > end - offset) return false;
+        out.strings.emplace_back(reinterpret_cast<const char*>(packet + offset), string_length);
+        offset += string_length;
+    }
+    return true;
+}
+
+bool decodeCaa(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, CaaData& out) {
+    if (!checkBounds(length, rdata_offset, rdata_length) || rdata_length < 2) return false;
+
+    const uint8_t* p = packet + rdata_offset;
+    size_t tag_length = p[1];
+    if (tag_length == 0 || tag_length > rdata_length - 2) return false;
+
+    out.flags = p[0];
+    out.tag.assign(reinterpret_cast<const char*>(p + 2), tag_length);
+    out.value.assign(reinterpret_cast<const char*>(p + 2 + tag_length), rdata_length - 2 - tag_length);
+    return true;
+}
+
+bool decodeName(const uint8_t* packet, size_t length, size_t rdata_offset, size_t rdata_length, std::string& out) {
+    size_t end = rdata_offset + rdata_length;
+    if (!checkBounds(length, rdata_offset, rdata_length) || rdata_length == 0) return false;
+
+    size_t offset = rdata_offset;
+    return readName(packet, length, offset, end, out) && offset == end;
+}
+
+} // namespace rdata
+
+// DnsRecord的RDATA访问：data是独立的RDATA（解析时已展开压缩域名）
+template <typename Decoder, typename Output>
+static bool decodeRecordData(const DnsRecord& record, Decoder decoder, Output& out) {
+    return decoder(reinterpret_cast<const uint8_t*>(record.data.data()), record.data.size(), 0,
+                   record.data.size(), out);
+}
+
+bool DnsRecord::mx(MxData& out) const {
+    return type == DnsRecordType::MX && decodeRecordData(*this, rdata::decodeMx, out);
+}
+
+bool DnsRecord::srv(SrvData& out) const {
+    return type == DnsRecordType::SRV && decodeRecordData(*this, rdata::decodeSrv, out);
+}
+
+bool DnsRecord::soa(SoaData& out) const {
+    return type == DnsRecordType::SOA && decodeRecordData(*this, rdata::decodeSoa, out);
+}
+
+bool DnsRecord::txt(TxtData& out) const {
+    return type == DnsRecordType::TXT && decodeRecordData(*this, rdata::decodeTxt, out);
+}
+
+bool DnsRecord::caa(CaaData& out) const {
+    return type == DnsRecordType::CAA && decodeRecordData(*this, rdata::decodeCaa, out);
+}
+
+bool DnsRecord::target(std::string& out) const {
+    return (type == DnsRecordType::CNAME || type == DnsRecordType::NS || type == DnsRecordType::PTR) &&
+           decodeRecordData(*this, rdata::decodeName, out);
+}
+
+} // namespace zjpdns
@@ -1,17 +1,24 @@
 #include "dns_resolver.h"
 #include "dns_packet.h"
-#include <netdb.h>
+#include "dns_simd.h"
+#include "dns_system.h"
 #include <cstring>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <arpa/inet.h>
+#include <mutex>
+#include <chrono>
 
 namespace zjpdns {
 
 DnsResolverImpl::DnsResolverImpl() 
-    : dns_server_(DNS_SERVER), dns_port_(DNS_PORT), timeout_ms_(DNS_TIMEOUT) {
+    : metrics_(MetricsRegistry::instance().create("sync")), upstreams_({DnsServer(DNS_SERVER, DNS_PORT)}),
+      hedging_(false), timeout_ms_(DNS_TIMEOUT), edns_payload_size_(DNS_EDNS_PAYLOAD_SIZE) {
     sender_ = std::make_unique<DnsPacketSender>();
+    cache_ = std::make_unique<DnsCache>(DNS_CACHE_SIZE);
+    sender_->setMetrics(metrics_.get());
+    upstreams_.setMetrics(metrics_.get());
 }
 
 DnsResolverImpl::~DnsResolverImpl() = default;
@@ -21,24 +28,31 @@ DnsResult DnsResolverImpl::resolve(const std::string& domain,
                                   ResolveMethod method) {
     DnsResult result;
     result.domains.push_back(domain);
+    auto start = std::chrono::steady_clock::now();
     
     // 验证域名格式
     if (!isValidDomain(domain)) {
         result.error_message = "无效的域名格式";
+        metrics_->recordResult(result, start);
         return result;
     }
     
     switch (method) {
         case ResolveMethod::GETHOSTBYNAME:
-            return resolveWithGethostbyname(domain);
+            result = resolveWithSystem(domain, type);
+            break;
         case ResolveMethod::DNS_PACKET:
-            return resolveWithDnsPacket(domain, type);
+            result = resolveWithDnsPacket(domain, type);
+            break;
         case ResolveMethod::CUSTOM_PACKET:
             result.error_message = "CUSTOM_PACKET方法需要调用resolveWithPacket接口";
             return result;
+        default:
+            result.error_message = "未知的解析方法";
+            return result;
     }
     
-    result.error_message = "未知的解析方法";
+    metrics_->recordResult(result, start);
     return result;
 }
 
@@ -54,82 +68,298 @@ DnsResult DnsResolverImpl::resolveWithPacket(const DnsPacket& packet) {
     std::vector<uint8_t> packet_data = DnsPacketBuilder::buildCustomPacket(packet);
     
     // 发送数据包
-    return sender_->sendPacket(dns_server_, dns_port_, packet_data, timeout_ms_);
+    auto start = std::chrono::steady_clock::now();
+    DnsResult response = sendToUpstream(packet_data);
+    metrics_->recordResult(response, start);
+    return response;
+}
+
+std::vector<DnsResult> DnsResolverImpl::resolveBatch(const std::vector<DnsQuery>& queries) {
+    std::vector<DnsResult> results(queries.size());
+    std::vector<size_t> pending;
+    std::vector<std::vector<uint8_t>> packets;
+    auto start = std::chrono::steady_clock::now();
+    
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const DnsQuery& query = queries[i];
+        results[i].domains.push_back(query.domain);
+        
+        // 验证域名格式
+        if (!isValidDomain(query.domain)) {
+            results[i].error_message = "无效的域名格式";
+            metrics_->recordResult(results[i], start);
+            continue;
+        }
+        
+        // 优先使用缓存结果
+        if (cache_->lookup(query.domain, query.type, DnsRecordClass::IN, results[i])) {
+            metrics_->cache_hits.add();
+            metrics_->recordResult(results[i], start);
+            continue;
+        }
+        
+        metrics_->cache_misses.add();
+        pending.push_back(i);
+        packets.push_back(DnsPacketBuilder::buildQueryPacket(query.domain, query.type, DnsRecordClass::IN,
+                                                             0, edns_payload_size_));
+    }
+    
+    if (packets.empty()) {
+        return results;
+    }
+    
+    // 一次批量发送所有未命中缓存的查询，整批使用同一个上游服务器
+    size_t upstream = upstreams_.select();
+    if (upstream == UpstreamSelector::npos) {
+        for (size_t i : pending) {
+            results[i].error_message = "未设置DNS服务器";
+            metrics_->recordResult(results[i], start);
+        }
+        return results;
+    }
+    DnsServer server = upstreams_.server(upstream);
+    std::vector<double> rtts;
+    std::vector<DnsResult> responses = sender_->sendBatch(server.address, server.port, packets, timeout_ms_, &rtts);
+    upstreams_.reportBatch(upstream, responses, rtts);
+    
+    // 不支持EDNS的服务器拒绝的查询去掉OPT记录再批量发送一次
+    std::vector<size_t> fallback;
+    std::vector<std::vector<uint8_t>> fallback_packets;
+    for (size_t k = 0; k < pending.size(); ++k) {
+        if (edns_payload_size_ && needsEdnsFallback(responses[k])) {
+            const DnsQuery& query = queries[pending[k]];
+            fallback.push_back(k);
+            fallback_packets.push_back(DnsPacketBuilder::buildQueryPacket(query.domain, query.type));
+        }
+    }
+    if (!fallback.empty()) {
+        std::vector<DnsResult> retried = sender_->sendBatch(server.address, server.port, fallback_packets, timeout_ms_);
+        for (size_t k = 0; k < fallback.size(); ++k) {
+            responses[fallback[k]] = std::move(retried[k]);
+        }
+    }
+    
+    for (size_t k = 0; k < pending.size(); ++k) {
+        size_t i = pending[k];
+        results[i] = std::move(responses[k]);
+        cache_->insert(queries[i].domain, queries[i].type, DnsRecordClass::IN, results[i]);
+        metrics_->recordResult(results[i], start);
+    }
+    
+    return results;
+}
+
+DnsResult DnsResolverImpl::resolveDual(const std::string& domain, int grace_ms) {
+    const DnsRecordType types[2] = {DnsRecordType::AAAA, DnsRecordType::A};
+    DnsResult results[2];
+    
+    // 验证域名格式
+    if (!isValidDomain(domain)) {
+        DnsResult result;
+        result.domains.push_back(domain);
+        result.error_message = "无效的域名格式";
+        return result;
+    }
+    
+    // 优先使用缓存结果，只发送未命中缓存的查询
+    auto start = std::chrono::steady_clock::now();
+    std::vector<size_t> pending;
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t i = 0; i < 2; ++i) {
+        if (cache_->lookup(domain, types[i], DnsRecordClass::IN, results[i])) {
+            metrics_->cache_hits.add();
+            continue;
+        }
+        metrics_->cache_misses.add();
+        pending.push_back(i);
+        packets.push_back(DnsPacketBuilder::buildQueryPacket(domain, types[i], DnsRecordClass::IN,
+                                                             0, edns_payload_size_));
+    }
+    
+    // 已缓存的地址族有地址时也只等待宽限期
+    bool cached_addresses = pending.size() < 2 && hasAddresses(results[pending.empty() ? 0 : 1 - pending[0]]);
+    if (!packets.empty()) {
+        size_t upstream = upstreams_.select();
+        if (upstream == UpstreamSelector::npos) {
+            for (size_t i : pending) {
+                results[i].error_message = "未设置DNS服务器";
+            }
+            return mergeDualResults(results[0], results[1]);
+        }
+        
+        DnsServer server = upstreams_.server(upstream);
+        int timeout_ms = cached_addresses ? std::min(grace_ms, timeout_ms_) : timeout_ms_;
+        std::vector<DnsResult> responses = sender_->sendParallel(server.address, server.port, packets,
+                                                                 grace_ms, timeout_ms);
+        if (std::all_of(responses.begin(), responses.end(), UpstreamSelector::isServerFailure)) {
+            upstreams_.reportFailure(upstream);
+        } else {
+            upstreams_.reportRtt(upstream, std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        
+        for (size_t k = 0; k < pending.size(); ++k) {
+            size_t i = pending[k];
+            results[i] = std::move(responses[k]);
+            if (edns_payload_size_ && needsEdnsFallback(results[i])) {
+                results[i] = sendToUpstream(DnsPacketBuilder::buildQueryPacket(domain, types[i]));
+            }
+            cache_->insert(domain, types[i], DnsRecordClass::IN, results[i]);
+        }
+    }
+    
+    DnsResult result = mergeDualResults(results[0], results[1]);
+    metrics_->recordResult(result, start);
+    return result;
 }
 
 void DnsResolverImpl::setDnsServer(const std::string& server, uint16_t port) {
-    dns_server_ = server;
-    dns_port_ = port;
+    setDnsServers({DnsServer(server, port)});
+}
+
+void DnsResolverImpl::setDnsServers(const std::vector<DnsServer>& servers) {
+    upstreams_.setServers(servers);
+    
+    // 更换服务器后旧的缓存结果不再可信
+    cache_->clear();
+}
+
+void DnsResolverImpl::setHedging(bool enabled) {
+    hedging_ = enabled;
+}
+
+void DnsResolverImpl::setRetryPolicy(const RetryPolicy& policy) {
+    sender_->setRetryPolicy(policy);
 }
 
 void DnsResolverImpl::setTimeout(int timeout_ms) {
     timeout_ms_ = timeout_ms;
 }
 
-DnsResult DnsResolverImpl::resolveWithGethostbyname(const std::string& domain) {
+void DnsResolverImpl::setCacheSize(size_t max_entries) {
+    cache_->setMaxEntries(max_entries);
+}
+
+void DnsResolverImpl::setEdnsPayloadSize(uint16_t payload_size) {
+    edns_payload_size_ = clampEdnsPayloadSize(payload_size);
+}
+
+uint16_t DnsResolverImpl::clampEdnsPayloadSize(uint16_t payload_size) {
+    if (payload_size == 0) {
+        return 0;
+    }
+    return std::min<uint16_t>(std::max<uint16_t>(payload_size, 512), DNS_UDP_BUFFER_SIZE);
+}
+
+bool DnsResolverImpl::needsEdnsFallback(const DnsResult& result) {
+    return !result.edns.present && (result.rcode == 1 || result.rcode == 4);
+}
+
+DnsResult DnsResolverImpl::mergeDualResults(const DnsResult& aaaa, const DnsResult& a) {
+    // 有地址的一方优先，其次是成功的一方
+    const DnsResult& primary = hasAddresses(aaaa) || (!hasAddresses(a) && aaaa.success && !a.success) ? aaaa : a;
     DnsResult result;
-    result.domains.push_back(domain);
-    
-    struct hostent* he = gethostbyname(domain.c_str());
-    if (!he) {
-        result.error_message = "gethostbyname失败: " + std::string(hstrerror(h_errno));
-        return result;
+    result.success = aaaa.success || a.success;
+    result.rcode = primary.rcode;
+    result.edns = primary.edns;
+    if (!result.success) {
+        result.error_message = primary.error_message;
     }
     
-    // 提取IP地址
-    for (int i = 0; he->h_addr_list[i] != nullptr; ++i) {
-        char ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, he->h_addr_list[i], ip, INET_ADDRSTRLEN);
-        result.addresses.push_back(ip);
-        
-        // 创建DNS记录
-        DnsRecord record;
-        record.name = domain;
-        record.type = DnsRecordType::A;
-        record.class_ = DnsRecordClass::IN;
-        record.ttl = 300; // 默认TTL
-        record.data = std::string(he->h_addr_list[i], he->h_length);
-        result.records.push_back(record);
+    for (const DnsResult* part : {&aaaa, &a}) {
+        for (const auto& domain : part->domains) {
+            if (std::find(result.domains.begin(), result.domains.end(), domain) == result.domains.end()) {
+                result.domains.push_back(domain);
+            }
+        }
+        result.records.insert(result.records.end(), part->records.begin(), part->records.end());
+        result.authorities.insert(result.authorities.end(), part->authorities.begin(), part->authorities.end());
     }
     
-    result.success = true;
+    // 地址族交替排列，IPv6在前
+    for (size_t i = 0; i < std::max(aaaa.addresses.size(), a.addresses.size()); ++i) {
+        if (i < aaaa.addresses.size()) result.addresses.push_back(aaaa.addresses[i]);
+        if (i < a.addresses.size()) result.addresses.push_back(a.addresses[i]);
+    }
     return result;
 }
 
+bool DnsResolverImpl::hasAddresses(const DnsResult& result) {
+    return result.success && !result.addresses.empty();
+}
+
+DnsResult DnsResolverImpl::resolveWithSystem(const std::string& domain, DnsRecordType type) {
+    // getaddrinfo可重入，多个线程可同时解析
+    return SystemResolver::lookup(domain, type);
+}
+
 DnsResult DnsResolverImpl::resolveWithDnsPacket(const std::string& domain, DnsRecordType type) {
-    // 构建DNS查询数据包
-    std::vector<uint8_t> packet = DnsPacketBuilder::buildQueryPacket(domain, type);
+    // 优先使用缓存结果
+    DnsResult result;
+    if (cache_->lookup(domain, type, DnsRecordClass::IN, result)) {
+        metrics_->cache_hits.add();
+        return result;
+    }
+    metrics_->cache_misses.add();
+    
+    // 构建DNS查询数据包，默认附加EDNS(0) OPT记录以接收超过512字节的UDP应答
+    std::vector<uint8_t> packet = DnsPacketBuilder::buildQueryPacket(domain, type, DnsRecordClass::IN,
+                                                                     0, edns_payload_size_);
     
     // 发送数据包
-    return sender_->sendPacket(dns_server_, dns_port_, packet, timeout_ms_);
+    result = sendToUpstream(packet);
+    if (edns_payload_size_ && needsEdnsFallback(result)) {
+        packet = DnsPacketBuilder::buildQueryPacket(domain, type);
+        result = sendToUpstream(packet);
+    }
+    cache_->insert(domain, type, DnsRecordClass::IN, result);
+    return result;
 }
 
-bool DnsResolverImpl::isValidDomain(const std::string& domain) {
-    if (domain.empty() || domain.length() > 253) {
-        return false;
+DnsResult DnsResolverImpl::sendToUpstream(const std::vector<uint8_t>& packet) {
+    DnsResult result;
+    size_t primary = upstreams_.select();
+    if (primary == UpstreamSelector::npos) {
+        result.error_message = "未设置DNS服务器";
+        return result;
     }
     
-    // 检查是否包含有效字符
-    for (char c : domain) {
-        if (!((c >= 'a' && c <= 'z') || 
-              (c >= 'A' && c <= 'Z') || 
-              (c >= '0' && c <= '9') || 
-              c == '-' || c == '.')) {
-            return false;
-        }
-    }
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
     
-    // 检查是否以点开头或结尾
-    if (domain.front() == '.' || domain.back() == '.') {
-        return false;
+    size_t secondary = hedging_ ? upstreams_.select(primary) : UpstreamSelector::npos;
+    if (secondary == UpstreamSelector::npos) {
+        DnsServer server = upstreams_.server(primary);
+        result = sender_->sendPacket(server.address, server.port, packet, timeout_ms_);
+        upstreams_.report(primary, result, elapsedMs());
+        return result;
     }
     
-    // 检查是否包含连续的点
-    if (domain.find("..") != std::string::npos) {
-        return false;
+    int hedge_delay = upstreams_.hedgeDelay(primary, timeout_ms_);
+    int winner;
+    result = sender_->sendPacketHedged(upstreams_.server(primary), upstreams_.server(secondary), packet,
+                                       hedge_delay, timeout_ms_, winner);
+    double elapsed = elapsedMs();
+    if (winner == 0) {
+        upstreams_.report(primary, result, elapsed);
+    } else if (winner == 1) {
+        // 首选服务器至少慢于本次耗时
+        upstreams_.reportRtt(primary, elapsed);
+        upstreams_.report(secondary, result, elapsed - hedge_delay);
+    } else {
+        upstreams_.reportFailure(primary);
+        if (elapsed >= hedge_delay) {
+            upstreams_.reportFailure(secondary);
+        }
     }
-    
-    return true;
+    return result;
+}
+
+bool DnsResolverImpl::isValidDomain(const std::string& domain) {
+    // 字符集、空标签和标签长度在一次向量化扫描中完成检查
+    return simd::scanDomain(domain.data(), domain.size());
 }
 
 std::string DnsResolverImpl::getDefaultDnsServer() {
@@ -0,0 +1,310 @@
+#include "dns_simd.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZJPDNS_SIMD_X86 1
+#endif
+
+namespace zjpdns {
+namespace simd {
+
+#define DNS_MAX_DOMAIN_LENGTH 253
+#define DNS_MAX_LABEL_LENGTH 63
+
+static inline bool isDomainChar(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '.';
+}
+
+static inline char lowerChar(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c;
+}
+
+// 遇到点时结束当前标签，检查标签长度
+static inline bool closeLabel(size_t dot, size_t& label_start) {
+    size_t label_length = dot - label_start;
+    if (label_length == 0 || label_length > DNS_MAX_LABEL_LENGTH) {
+        return false;
+    }
+    label_start = dot + 1;
+    return true;
+}
+
+// 最后一个标签不能为空（即不以点结尾）
+static inline bool closeLastLabel(size_t length, size_t label_start) {
+    size_t label_length = length - label_start;
+    return label_length > 0 && label_length <= DNS_MAX_LABEL_LENGTH;
+}
+
+// 标量实现
+static bool scanDomainScalar(const char* name, size_t length, char* lowered) {
+    if (length == 0 || length > DNS_MAX_DOMAIN_LENGTH) {
+        return false;
+    }
+
+    size_t label_start = 0;
+    for (size_t i = 0; i < length; ++i) {
+        char c = name[i];
+        if (!isDomainChar(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        if (c == '.' && !closeLabel(i, label_start)) {
+            return false;
+        }
+        if (lowered) {
+            lowered[i] = lowerChar(c);
+        }
+    }
+    return closeLastLabel(length, label_start);
+}
+
+static void toLowerAsciiScalar(const char* in, size_t length, char* out) {
+    for (size_t i = 0; i < length; ++i) {
+        out[i] = lowerChar(in[i]);
+    }
+}
+
+#ifdef ZJPDNS_SIMD_X86
+
+// 依次处理块内所有点的位置
+static inline bool closeLabels(uint32_t dots, size_t base, size_t& label_start) {
+    while (dots) {
+        if (!closeLabel(base + __builtin_ctz(dots), label_start)) {
+            return false;
+        }
+        dots &= dots - 1;
+    }
+    return true;
+}
+
+// SSE2实现：每次处理16字节
+__attribute__((target("sse2")))
+static inline __m128i upperMask128(__m128i c) {
+    return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                         _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+}
+
+__attribute__((target("sse2")))
+static bool scanDomainSse2(const char* name, size_t length, char* lowered) {
+    if (length == 0 || length > DNS_MAX_DOMAIN_LENGTH) {
+        return false;
+    }
+
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    size_t label_start = 0;
+
+    for (size_t i = 0; i < length; i += 16) {
+        // 末尾不足一个向量时：总长足够则与前一块重叠读取，否则复制到以'a'填充的缓冲区
+        size_t chunk = length - i < 16 ? length - i : 16;
+        size_t skip = 0;
+        alignas(16) char tail[16];
+        const char* src = name + i;
+        if (chunk < 16) {
+            if (length >= 16) {
+                skip = 16 - chunk;
+                src = name + length - 16;
+            } else {
+                memset(tail, 'a', sizeof(tail));
+                memcpy(tail, src, chunk);
+                src = tail;
+            }
+        }
+
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i upper = upperMask128(c);
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+        __m128i dash = _mm_cmpeq_epi8(c, _mm_set1_epi8('-'));
+        __m128i dot = _mm_cmpeq_epi8(c, _mm_set1_epi8('.'));
+        __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(dash, dot)));
+
+        if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            return false;
+        }
+        if (!closeLabels(static_cast<uint32_t>(_mm_movemask_epi8(dot)) >> skip, i, label_start)) {
+            return false;
+        }
+        if (lowered) {
+            __m128i folded = _mm_or_si128(c, _mm_and_si128(upper, case_bit));
+            if (chunk == 16 || skip > 0) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(lowered + i - skip), folded);
+            } else {
+                alignas(16) char out[16];
+                _mm_store_si128(reinterpret_cast<__m128i*>(out), folded);
+                memcpy(lowered + i, out, chunk);
+            }
+        }
+    }
+    return closeLastLabel(length, label_start);
+}
+
+__attribute__((target("sse2")))
+static void toLowerAsciiSse2(const char* in, size_t length, char* out) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_or_si128(c, _mm_and_si128(upperMask128(c), case_bit)));
+    }
+    toLowerAsciiScalar(in + i, length - i, out + i);
+}
+
+// AVX2实现：每次处理32字节
+__attribute__((target("avx2")))
+static inline __m256i upperMask256(__m256i c) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+}
+
+__attribute__((target("avx2")))
+static bool scanDomainAvx2(const char* name, size_t length, char* lowered) {
+    if (length == 0 || length > DNS_MAX_DOMAIN_LENGTH) {
+        return false;
+    }
+
+    // 不足一个32字节向量的域名用16字节向量处理，避免复制到填充缓冲区
+    if (length < 32) {
+        return scanDomainSse2(name, length, lowered);
+    }
+
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    size_t label_start = 0;
+
+    for (size_t i = 0; i < length; i += 32) {
+        // 末尾不足一个向量时：总长足够则与前一块重叠读取，否则复制到以'a'填充的缓冲区
+        size_t chunk = length - i < 32 ? length - i : 32;
+        size_t skip = 0;
+        alignas(32) char tail[32];
+        const char* src = name + i;
+        if (chunk < 32) {
+            if (length >= 32) {
+                skip = 32 - chunk;
+                src = name + length - 32;
+            } else {
+                memset(tail, 'a', sizeof(tail));
+                memcpy(tail, src, chunk);
+                src = tail;
+            }
+        }
+
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        __m256i upper = upperMask256(c);
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        __m256i dash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-'));
+        __m256i dot = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('.'));
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                        _mm256_or_si256(digit, _mm256_or_si256(dash, dot)));
+
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xFFFFFFFFu) {
+            return false;
+        }
+        if (!closeLabels(static_cast<uint32_t>(_mm256_movemask_epi8(dot)) >> skip, i, label_start)) {
+            return false;
+        }
+        if (lowered) {
+            __m256i folded = _mm256_or_si256(c, _mm256_and_si256(upper, case_bit));
+            if (chunk == 32 || skip > 0) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lowered + i - skip), folded);
+            } else {
+                alignas(32) char out[32];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(out), folded);
+                memcpy(lowered + i, out, chunk);
+            }
+        }
+    }
+    return closeLastLabel(length, label_start);
+}
+
+__attribute__((target("avx2")))
+static void toLowerAsciiAvx2(const char* in, size_t length, char* out) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_or_si256(c, _mm256_and_si256(upperMask256(c), case_bit)));
+    }
+    toLowerAsciiSse2(in + i, length - i, out + i);
+}
+
+#endif // ZJPDNS_SIMD_X86
+
+static Kernel detectKernel() {
+#ifdef ZJPDNS_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Kernel::SSE2;
+    }
+#endif
+    return Kernel::SCALAR;
+}
+
+Kernel activeKernel() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+// 请求的内核超出平台支持时退回当前平台的内核
+static inline Kernel supportedKernel(Kernel kernel) {
+    Kernel active = activeKernel();
+    return static_cast<int>(kernel) > static_cast<int>(active) ? active : kernel;
+}
+
+bool scanDomain(const char* name, size_t length, char* lowered) {
+    return scanDomain(activeKernel(), name, length, lowered);
+}
+
+bool scanDomain(Kernel kernel, const char* name, size_t length, char* lowered) {
+    switch (supportedKernel(kernel)) {
+#ifdef ZJPDNS_SIMD_X86
+    case Kernel::AVX2:
+        return scanDomainAvx2(name, length, lowered);
+    case Kernel::SSE2:
+        return scanDomainSse2(name, length, lowered);
+#endif
+    default:
+        return scanDomainScalar(name, length, lowered);
+    }
+}
+
+void toLowerAscii(const char* in, size_t length, char* out) {
+    toLowerAscii(activeKernel(), in, length, out);
+}
+
+void toLowerAscii(Kernel kernel, const char* in, size_t length, char* out) {
+    switch (supportedKernel(kernel)) {
+#ifdef ZJPDNS_SIMD_X86
+    case Kernel::AVX2:
+        toLowerAsciiAvx2(in, length, out);
+        return;
+    case Kernel::SSE2:
+        toLowerAsciiSse2(in, length, out);
+        return;
+#endif
+    default:
+        toLowerAsciiScalar(in, length, out);
+        return;
+    }
+}
+
+const char* kernelName(Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AVX2: return "avx2";
+    case Kernel::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+} // namespace simd
+} // namespace zjpdns
@@ -0,0 +1,136 @@
+#include "dns_system.h"
+#include <algorithm>
+#include <cstring>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace zjpdns {
+
+SystemResolver::SystemResolver(size_t thread_count)
+    : max_threads_(thread_count > 0 ? thread_count : 1), idle_(0), stopped_(false) {}
+
+SystemResolver::~SystemResolver() {
+    stop();
+}
+
+DnsResult SystemResolver::lookup(const std::string& domain, DnsRecordType type) {
+    DnsResult result;
+    result.domains.push_back(domain);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = type == DnsRecordType::A ? AF_INET : (type == DnsRecordType::AAAA ? AF_INET6 : AF_UNSPEC);
+    hints.ai_socktype = SOCK_DGRAM;    // 每个地址只返回一次
+
+    struct addrinfo* info = nullptr;
+    int error = getaddrinfo(domain.c_str(), nullptr, &hints, &info);
+    if (error != 0) {
+        result.error_message = "getaddrinfo失败: " + std::string(gai_strerror(error));
+        return result;
+    }
+
+    for (struct addrinfo* ai = info; ai != nullptr; ai = ai->ai_next) {
+        const void* address;
+        size_t length;
+        DnsRecordType record_type;
+        if (ai->ai_family == AF_INET) {
+            address = &reinterpret_cast<struct sockaddr_in*>(ai->ai_addr)->sin_addr;
+            length = 4;
+            record_type = DnsRecordType::A;
+        } else if (ai->ai_family == AF_INET6) {
+            address = &reinterpret_cast<struct sockaddr_in6*>(ai->ai_addr)->sin6_addr;
+            length = 16;
+            record_type = DnsRecordType::AAAA;
+        } else {
+            continue;
+        }
+
+        char ip[INET6_ADDRSTRLEN];
+        inet_ntop(ai->ai_family, address, ip, sizeof(ip));
+        if (std::find(result.addresses.begin(), result.addresses.end(), ip) != result.addresses.end()) {
+            continue;
+        }
+        result.addresses.push_back(ip);
+
+        // 创建DNS记录
+        DnsRecord record;
+        record.name = domain;
+        record.type = record_type;
+        record.class_ = DnsRecordClass::IN;
+        record.ttl = DNS_SYSTEM_RESOLVER_TTL;
+        record.data = std::string(static_cast<const char*>(address), length);
+        result.records.push_back(record);
+    }
+    freeaddrinfo(info);
+
+    result.success = true;
+    return result;
+}
+
+void SystemResolver::resolve(const std::string& domain, DnsRecordType type, Completion completion) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopped_) {
+            jobs_.push_back(Job{domain, type, std::move(completion)});
+
+            // 没有空闲线程时新建线程，线程数有上限
+            if (idle_ < jobs_.size() && threads_.size() < max_threads_) {
+                threads_.emplace_back(&SystemResolver::workerThread, this);
+            }
+            cv_.notify_one();
+            return;
+        }
+    }
+
+    // 已停止，直接在调用线程中解析
+    completion(lookup(domain, type));
+}
+
+void SystemResolver::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = false;
+}
+
+void SystemResolver::stop() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        threads.swap(threads_);
+    }
+    cv_.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+size_t SystemResolver::threadCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+}
+
+void SystemResolver::workerThread() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        ++idle_;
+        cv_.wait(lock, [this]() { return !jobs_.empty() || stopped_; });
+        --idle_;
+
+        // 停止时执行完队列中剩余的查询
+        if (jobs_.empty()) {
+            return;
+        }
+
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        job.completion(lookup(job.domain, job.type));
+
+        lock.lock();
+    }
+}
+
+} // namespace zjpdns
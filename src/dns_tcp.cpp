@@ -0,0 +1,362 @@
+#include "dns_tcp.h"
+#include "dns_packet.h"
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+
+namespace zjpdns {
+
+static int remainingMs(std::chrono::steady_clock::time_point deadline) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now()).count();
+    return remaining > 0 ? static_cast<int>(remaining) : 0;
+}
+
+DnsTcpTransport::Connection::~Connection() {
+    if (sockfd >= 0) {
+        close(sockfd);
+    }
+}
+
+DnsTcpTransport::DnsTcpTransport() = default;
+
+DnsTcpTransport::~DnsTcpTransport() {
+    closeAll();
+}
+
+DnsResult DnsTcpTransport::query(const std::string& server, uint16_t port,
+                                 const std::vector<uint8_t>& packet, int timeout_ms) {
+    std::vector<std::vector<uint8_t>> packets(1, packet);
+    return std::move(queryBatch(server, port, packets, timeout_ms)[0]);
+}
+
+std::vector<DnsResult> DnsTcpTransport::queryBatch(const std::string& server, uint16_t port,
+                                                   const std::vector<std::vector<uint8_t>>& packets,
+                                                   int timeout_ms) {
+    std::vector<DnsResult> results(packets.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    // 不足头部长度的数据包不发送
+    std::vector<size_t> pending;
+    pending.reserve(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        if (packets[i].size() < 12) {
+            results[i].error_message = "Invalid DNS query packet";
+            continue;
+        }
+        pending.push_back(i);
+    }
+
+    // 复用的连接可能已被服务器因空闲关闭，此时在新连接上重试一次
+    for (int attempt = 0; attempt < 2 && !pending.empty(); ++attempt) {
+        bool reused = false;
+        std::shared_ptr<Connection> conn = acquireConnection(server, port, remainingMs(deadline), reused);
+        if (!conn) {
+            for (size_t i : pending) {
+                results[i].error_message = "Connect DNS server failed";
+            }
+            break;
+        }
+
+        std::vector<Waiter> waiters(pending.size());
+        std::vector<Waiter*> waiter_ptrs(pending.size());
+        std::vector<const std::vector<uint8_t>*> queries(pending.size());
+        for (size_t k = 0; k < pending.size(); ++k) {
+            waiter_ptrs[k] = &waiters[k];
+            queries[k] = &packets[pending[k]];
+        }
+
+        bool retry = reused && attempt == 0;
+        if (!sendQueries(*conn, queries, waiter_ptrs, remainingMs(deadline))) {
+            if (retry) continue;
+            for (size_t i : pending) {
+                results[i].error_message = "Send DNS packet failed";
+            }
+            break;
+        }
+
+        receiveData(*conn, waiter_ptrs, remainingMs(deadline));
+
+        std::vector<size_t> failed;
+        for (size_t k = 0; k < pending.size(); ++k) {
+            size_t i = pending[k];
+            if (waiters[k].done) {
+                results[i] = DnsPacketBuilder::parseResponsePacket(waiters[k].response);
+            } else if (waiters[k].failed && retry) {
+                failed.push_back(i);
+            } else if (waiters[k].failed) {
+                results[i].error_message = "TCP connection closed";
+            } else {
+                results[i].error_message = "Receive DNS response timeout";
+            }
+        }
+        pending.swap(failed);
+    }
+
+    return results;
+}
+
+size_t DnsTcpTransport::connectionCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (auto& entry : connections_) {
+        std::lock_guard<std::mutex> conn_lock(entry.second->mutex);
+        if (!entry.second->broken) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void DnsTcpTransport::closeAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : connections_) {
+        // 只关闭读写，正在等待的线程读到连接关闭后结束，socket在最后一个使用者释放时关闭
+        std::lock_guard<std::mutex> conn_lock(entry.second->mutex);
+        entry.second->broken = true;
+        shutdown(entry.second->sockfd, SHUT_RDWR);
+    }
+    connections_.clear();
+}
+
+std::shared_ptr<DnsTcpTransport::Connection> DnsTcpTransport::acquireConnection(const std::string& server,
+                                                                                uint16_t port,
+                                                                                int timeout_ms,
+                                                                                bool& reused) {
+    std::string key = server + ":" + std::to_string(port);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = connections_.find(key);
+        if (it != connections_.end()) {
+            std::lock_guard<std::mutex> conn_lock(it->second->mutex);
+            if (!it->second->broken) {
+                reused = true;
+                return it->second;
+            }
+        }
+    }
+
+    // 在锁外建立连接，避免慢速服务器阻塞其他服务器的查询
+    int sockfd = connectServer(server, port, timeout_ms);
+    if (sockfd < 0) {
+        return nullptr;
+    }
+
+    auto conn = std::make_shared<Connection>();
+    conn->sockfd = sockfd;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_[key] = conn;
+    reused = false;
+    return conn;
+}
+
+int DnsTcpTransport::connectServer(const std::string& server, uint16_t port, int timeout_ms) {
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server.c_str(), &server_addr.sin_addr) <= 0) {
+        return -1;
+    }
+
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) return -1;
+
+    // 设置非阻塞模式
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+
+    // 查询很小，立即发送
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        if (errno != EINPROGRESS) {
+            close(sockfd);
+            return -1;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = sockfd;
+        pfd.events = POLLOUT;
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (poll(&pfd, 1, timeout_ms) <= 0 ||
+            getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            close(sockfd);
+            return -1;
+        }
+    }
+
+    return sockfd;
+}
+
+bool DnsTcpTransport::sendQueries(Connection& conn, const std::vector<const std::vector<uint8_t>*>& packets,
+                                  std::vector<Waiter*>& waiters, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    // 注册等待者并拼接所有消息，每个消息前加2字节长度
+    std::vector<uint8_t> data;
+    {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        if (conn.broken) {
+            return false;
+        }
+
+        for (size_t i = 0; i < packets.size(); ++i) {
+            const std::vector<uint8_t>& packet = *packets[i];
+            size_t start = data.size();
+            data.push_back(static_cast<uint8_t>(packet.size() >> 8));
+            data.push_back(static_cast<uint8_t>(packet.size() & 0xFF));
+            data.insert(data.end(), packet.begin(), packet.end());
+
+            // 同一连接上已有相同事务ID和问题的查询在等待，更换事务ID避免响应串包
+            uint8_t* message = data.data() + start + 2;
+            waiters[i]->key = DnsPacketSender::makeWaiterKey(message, packet.size());
+            while (conn.waiters.count(waiters[i]->key) && packet.size() >= 12) {
+                uint16_t id = DnsPacketBuilder::generateTransactionId();
+                message[0] = static_cast<uint8_t>(id >> 8);
+                message[1] = static_cast<uint8_t>(id & 0xFF);
+                waiters[i]->key = DnsPacketSender::makeWaiterKey(message, packet.size());
+            }
+            conn.waiters[waiters[i]->key] = waiters[i];
+        }
+    }
+
+    // 发送缓冲区满时等待可写
+    bool ok = true;
+    {
+        std::lock_guard<std::mutex> lock(conn.write_mutex);
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(conn.sockfd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += n;
+                continue;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                ok = false;
+                break;
+            }
+
+            struct pollfd pfd;
+            pfd.fd = conn.sockfd;
+            pfd.events = POLLOUT;
+            int remaining = remainingMs(deadline);
+            if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (!ok) {
+        // 部分写入的消息会破坏分帧，连接不能再使用
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        conn.broken = true;
+        for (Waiter* waiter : waiters) {
+            conn.waiters.erase(waiter->key);
+        }
+        shutdown(conn.sockfd, SHUT_RDWR);
+    }
+    return ok;
+}
+
+void DnsTcpTransport::receiveData(Connection& conn, std::vector<Waiter*>& waiters, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    size_t next = 0;   // 第一个尚未完成的等待者
+
+    std::unique_lock<std::mutex> lock(conn.mutex);
+    while (true) {
+        while (next < waiters.size() && (waiters[next]->done || waiters[next]->failed)) {
+            ++next;
+        }
+        if (next == waiters.size()) break;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+
+        // 其他线程正在读取，等待其分发响应或让出读取权
+        if (conn.reading) {
+            conn.cv.wait_until(lock, deadline);
+            continue;
+        }
+
+        conn.reading = true;
+        lock.unlock();
+
+        std::vector<std::vector<uint8_t>> messages;
+        bool open = true;
+        struct pollfd pfd;
+        pfd.fd = conn.sockfd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, remainingMs(deadline) + 1) > 0) {
+            open = readMessages(conn, messages);
+        }
+
+        lock.lock();
+        for (auto& message : messages) {
+            auto it = conn.waiters.find(DnsPacketSender::makeWaiterKey(message.data(), message.size()));
+            if (it == conn.waiters.end() || it->second->done) {
+                continue; // 已超时的查询的迟到响应
+            }
+            it->second->response = std::move(message);
+            it->second->done = true;
+        }
+
+        // 连接断开：所有尚未收到响应的查询失败
+        if (!open) {
+            conn.broken = true;
+            for (auto& entry : conn.waiters) {
+                if (!entry.second->done) {
+                    entry.second->failed = true;
+                }
+            }
+        }
+        conn.reading = false;
+        conn.cv.notify_all();
+    }
+
+    for (Waiter* waiter : waiters) {
+        conn.waiters.erase(waiter->key);
+    }
+}
+
+bool DnsTcpTransport::readMessages(Connection& conn, std::vector<std::vector<uint8_t>>& messages) {
+    bool open = true;
+    while (true) {
+        size_t size = conn.stream.size();
+        conn.stream.resize(size + DNS_TCP_READ_BUFFER_SIZE);
+        ssize_t n = recv(conn.sockfd, conn.stream.data() + size, DNS_TCP_READ_BUFFER_SIZE, MSG_DONTWAIT);
+        conn.stream.resize(size + (n > 0 ? n : 0));
+
+        if (n > 0) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        open = false;
+        break;
+    }
+
+    // 按2字节长度前缀拆分完整消息，剩余部分留待下次读取
+    size_t offset = 0;
+    while (conn.stream.size() - offset >= 2) {
+        size_t length = (conn.stream[offset] << 8) | conn.stream[offset + 1];
+        if (conn.stream.size() - offset - 2 < length) break;
+        messages.emplace_back(conn.stream.begin() + offset + 2, conn.stream.begin() + offset + 2 + length);
+        offset += 2 + length;
+    }
+    conn.stream.erase(conn.stream.begin(), conn.stream.begin() + offset);
+
+    return open;
+}
+
+} // namespace zjpdns
@@ -0,0 +1,153 @@
+#include "dns_upstream.h"
+#include <algorithm>
+#include <cmath>
+
+namespace zjpdns {
+
+const size_t UpstreamSelector::npos;
+
+UpstreamSelector::UpstreamSelector(const std::vector<DnsServer>& servers) {
+    setServers(servers);
+}
+
+void UpstreamSelector::setServers(const std::vector<DnsServer>& servers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    upstreams_.clear();
+    for (const auto& server : servers) {
+        upstreams_.emplace_back(server);
+        if (metrics_) {
+            upstreams_.back().rtt = &metrics_->upstreamRtt(server.address + ":" + std::to_string(server.port));
+        }
+    }
+}
+
+void UpstreamSelector::setMetrics(ResolverMetrics* metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_ = metrics;
+    for (auto& upstream : upstreams_) {
+        upstream.rtt = metrics ? &metrics->upstreamRtt(upstream.server.address + ":" +
+                                                       std::to_string(upstream.server.port))
+                               : nullptr;
+    }
+}
+
+std::vector<DnsServer> UpstreamSelector::servers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DnsServer> servers;
+    for (const auto& upstream : upstreams_) {
+        servers.push_back(upstream.server);
+    }
+    return servers;
+}
+
+size_t UpstreamSelector::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return upstreams_.size();
+}
+
+size_t UpstreamSelector::select(size_t exclude) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t best = npos;
+    for (size_t i = 0; i < upstreams_.size(); ++i) {
+        if (i == exclude) continue;
+        if (best == npos || upstreams_[i].srtt < upstreams_[best].srtt) {
+            best = i;
+        }
+    }
+
+    // 未被选中的服务器SRTT衰减，一段时间后重新被探测
+    for (size_t i = 0; i < upstreams_.size(); ++i) {
+        if (i != best && i != exclude) {
+            upstreams_[i].srtt *= DNS_UPSTREAM_SRTT_DECAY;
+        }
+    }
+    return best;
+}
+
+DnsServer UpstreamSelector::server(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index < upstreams_.size() ? upstreams_[index].server : DnsServer("", 0);
+}
+
+void UpstreamSelector::reportRtt(size_t index, double rtt_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= upstreams_.size()) return;
+
+    // RFC 6298的平滑方式，第一个样本直接作为SRTT
+    Upstream& upstream = upstreams_[index];
+    if (upstream.samples == 0) {
+        upstream.srtt = rtt_ms;
+        upstream.rttvar = rtt_ms / 2;
+    } else {
+        upstream.rttvar = 0.75 * upstream.rttvar + 0.25 * std::fabs(upstream.srtt - rtt_ms);
+        upstream.srtt = 0.875 * upstream.srtt + 0.125 * rtt_ms;
+    }
+    ++upstream.samples;
+    upstream.failures = 0;
+    if (upstream.rtt) {
+        upstream.rtt->record(static_cast<uint64_t>(rtt_ms * 1000));
+    }
+}
+
+void UpstreamSelector::reportFailure(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= upstreams_.size()) return;
+
+    Upstream& upstream = upstreams_[index];
+    upstream.srtt = std::min<double>(upstream.srtt * 2 + DNS_UPSTREAM_FAILURE_PENALTY, DNS_UPSTREAM_MAX_SRTT);
+    ++upstream.samples;
+    ++upstream.failures;
+}
+
+void UpstreamSelector::report(size_t index, const DnsResult& result, double rtt_ms) {
+    if (isServerFailure(result)) {
+        reportFailure(index);
+    } else {
+        reportRtt(index, rtt_ms);
+    }
+}
+
+void UpstreamSelector::reportBatch(size_t index, const std::vector<DnsResult>& results,
+                                   const std::vector<double>& rtts) {
+    double first = -1;
+    for (size_t i = 0; i < results.size() && i < rtts.size(); ++i) {
+        if (!isServerFailure(results[i]) && rtts[i] >= 0 && (first < 0 || rtts[i] < first)) {
+            first = rtts[i];
+        }
+    }
+    if (first >= 0) {
+        reportRtt(index, first);
+    } else {
+        reportFailure(index);
+    }
+}
+
+int UpstreamSelector::hedgeDelay(size_t index, int timeout_ms) const {
+    double delay = DNS_HEDGE_DEFAULT_DELAY;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index < upstreams_.size() && upstreams_[index].samples > 0) {
+            delay = upstreams_[index].srtt + 4 * upstreams_[index].rttvar;
+        }
+    }
+    int upper = std::max(timeout_ms / 2, DNS_HEDGE_MIN_DELAY);
+    return std::min(std::max(static_cast<int>(delay), DNS_HEDGE_MIN_DELAY), upper);
+}
+
+double UpstreamSelector::srtt(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index < upstreams_.size() ? upstreams_[index].srtt : 0;
+}
+
+uint32_t UpstreamSelector::failures(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index < upstreams_.size() ? upstreams_[index].failures : 0;
+}
+
+bool UpstreamSelector::isServerFailure(const DnsResult& result) {
+    // 没有应答（rcode为0且失败），或SERVFAIL(2)、REFUSED(5)
+    return (!result.success && result.rcode == 0) || result.rcode == 2 || result.rcode == 5;
+}
+
+} // namespace zjpdns
@@ -0,0 +1,49 @@
+#include "mpsc_queue.h"
+
+namespace zjpdns {
+
+MpscQueue::MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+void MpscQueue::push(MpscNode* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    // 交换之后到链接前驱之前，消费者看到的链表暂时断开，此时pop返回nullptr
+    MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+MpscNode* MpscQueue::pop() {
+    MpscNode* tail = tail_;
+    MpscNode* next = tail->next.load(std::memory_order_acquire);
+
+    // 跳过占位节点
+    if (tail == &stub_) {
+        if (next == nullptr) {
+            return nullptr;
+        }
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+
+    // tail是最后一个已链接的节点：之后还有节点正在入队时稍后重试
+    if (tail != head_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    // tail是队列中唯一的节点，重新放入占位节点后才能取出它
+    push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+} // namespace zjpdns
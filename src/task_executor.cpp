@@ -0,0 +1,171 @@
+#include "task_executor.h"
+
+namespace zjpdns {
+
+// 当前线程所属的执行器及工作线程序号
+static thread_local WorkStealingExecutor* current_executor = nullptr;
+static thread_local size_t current_worker = 0;
+
+WorkStealingExecutor::WorkStealingExecutor(size_t thread_count)
+    : next_worker_(0), pending_(0), sleepers_(0), running_(false) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    stop();
+}
+
+void WorkStealingExecutor::start() {
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        std::lock_guard<std::mutex> lock(workers_[i]->mutex);
+        workers_[i]->closed = false;
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&WorkStealingExecutor::workerThread, this, i);
+    }
+}
+
+void WorkStealingExecutor::stop() {
+    if (!running_) {
+        return;
+    }
+
+    running_ = false;
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+    }
+    idle_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // 关闭所有队列，执行停止过程中新提交的任务
+    for (auto& worker : workers_) {
+        std::deque<Job> remaining;
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->closed = true;
+            remaining.swap(worker->jobs);
+        }
+        for (auto& job : remaining) {
+            --pending_;
+            job();
+        }
+    }
+}
+
+void WorkStealingExecutor::submit(Job job) {
+    // 工作线程提交的任务放入自己的队列，外部提交的任务轮流分配
+    size_t index;
+    if (current_executor == this) {
+        index = current_worker;
+    } else {
+        index = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    }
+
+    Worker& worker = *workers_[index];
+    bool accepted = false;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.closed) {
+            worker.jobs.push_back(std::move(job));
+            ++pending_;
+            accepted = true;
+        }
+    }
+
+    // 执行器已停止，直接在调用线程中执行
+    if (!accepted) {
+        job();
+        return;
+    }
+
+    notifyIdle();
+}
+
+size_t WorkStealingExecutor::threadCount() const {
+    return workers_.size();
+}
+
+bool WorkStealingExecutor::inWorkerThread() const {
+    return current_executor == this;
+}
+
+void WorkStealingExecutor::workerThread(size_t index) {
+    current_executor = this;
+    current_worker = index;
+
+    while (true) {
+        Job job;
+        if (popLocal(index, job) || steal(index, job)) {
+            --pending_;
+            job();
+            continue;
+        }
+
+        // 所有队列都为空时休眠
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        ++sleepers_;
+        idle_cv_.wait(lock, [this] { return pending_ > 0 || !running_; });
+        --sleepers_;
+
+        if (!running_ && pending_ == 0) {
+            break;
+        }
+    }
+
+    current_executor = nullptr;
+}
+
+bool WorkStealingExecutor::popLocal(size_t index, Job& job) {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.jobs.empty()) {
+        return false;
+    }
+
+    job = std::move(worker.jobs.back());
+    worker.jobs.pop_back();
+    return true;
+}
+
+bool WorkStealingExecutor::steal(size_t index, Job& job) {
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        Worker& victim = *workers_[(index + i) % workers_.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.jobs.empty()) {
+            continue;
+        }
+
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingExecutor::notifyIdle() {
+    if (sleepers_ == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+    }
+    idle_cv_.notify_one();
+}
+
+} // namespace zjpdns
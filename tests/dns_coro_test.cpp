@@ -0,0 +1,113 @@
+#include "dns_coro.h"
+#include "local_responder.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+using namespace zjpdns;
+
+// 不等待结果的协程（测试用）
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// 等待计数达到目标值，超时返回false
+static bool waitFor(const std::atomic<int>& counter, int target, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (counter < target) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+Detached resolveOnce(AsyncDnsResolver& resolver, std::string domain, std::atomic<int>& done,
+                     std::thread::id& resumed_on) {
+    DnsResult result = co_await resolveCo(resolver, domain);
+    assert(result.success);
+    assert(result.addresses.size() == 1 && result.addresses[0] == "127.0.0.1");
+    resumed_on = std::this_thread::get_id();
+    ++done;
+}
+
+Detached resolveTruncated(AsyncDnsResolver& resolver, std::atomic<int>& done, std::thread::id& resumed_on) {
+    // 截断的UDP应答在工作线程中改用TCP重查
+    DnsResult result = co_await resolveCo(resolver, "big.test");
+    assert(result.success && !result.truncated);
+    assert(result.addresses.size() == DNS_TEST_BIG_ANSWERS);
+    resumed_on = std::this_thread::get_id();
+    ++done;
+}
+
+Detached resolveSequence(AsyncDnsResolver& resolver, std::atomic<int>& done) {
+    // 同一协程中连续等待多个查询
+    for (int i = 0; i < 10; ++i) {
+        DnsResult result = co_await resolveCo(resolver, "seq" + std::to_string(i) + ".test");
+        assert(result.success);
+    }
+    DnsResult invalid = co_await resolveCo(resolver, "invalid..test");
+    assert(!invalid.success);
+    ++done;
+}
+
+void testCoroutineResolve() {
+    std::cout << "test coroutine resolve..." << std::endl;
+
+    LocalResponder responder;
+    auto resolver = createAsyncDnsResolver(1);
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(2000);
+
+    // 挂起后在事件循环线程中恢复（应答延迟，确保在await_suspend返回后才完成）
+    std::atomic<int> done{0};
+    std::thread::id resumed_on;
+    responder.setDelay(50);
+    resolveOnce(*resolver, "coro.test", done, resumed_on);
+    assert(done == 0);
+    assert(waitFor(done, 1, 2000));
+    assert(resumed_on != std::this_thread::get_id());
+    assert(responder.queries() == 1);
+    responder.setDelay(0);
+
+    // 缓存命中时不挂起，在当前线程继续
+    resolveOnce(*resolver, "coro.test", done, resumed_on);
+    assert(done == 2);
+    assert(resumed_on == std::this_thread::get_id());
+    assert(responder.queries() == 1);
+
+    // 大量并发协程
+    std::thread::id ignored;
+    for (int i = 0; i < 200; ++i) {
+        resolveOnce(*resolver, "many" + std::to_string(i) + ".test", done, ignored);
+    }
+    assert(waitFor(done, 202, 5000));
+
+    resolveSequence(*resolver, done);
+    assert(waitFor(done, 203, 5000));
+
+    // TCP重查的应答同样回到事件循环线程恢复
+    std::thread::id loop_thread;
+    resolveOnce(*resolver, "loop.test", done, loop_thread);
+    assert(waitFor(done, 204, 2000));
+    std::thread::id tcp_resumed_on;
+    resolveTruncated(*resolver, done, tcp_resumed_on);
+    assert(waitFor(done, 205, 5000));
+    assert(tcp_resumed_on == loop_thread);
+
+    std::cout << "coroutine resolve test passed!" << std::endl;
+}
+
+int main() {
+    testCoroutineResolve();
+    std::cout << "all coroutine tests passed!" << std::endl;
+    return 0;
+}
@@ -1,10 +1,31 @@
 #include "dns_parser.h"
 #include "dns_packet.h"
+#include "dns_cache.h"
+#include "task_executor.h"
+#include "dns_packet_view.h"
+#include "dns_capture.h"
+#include "dns_simd.h"
+#include "dns_tcp.h"
+#include "dns_upstream.h"
+#include "dns_resolver.h"
+#include "dns_system.h"
+#include "dns_metrics.h"
+#include "async_resolver.h"
+#include "mpsc_queue.h"
+#include "local_responder.h"
+#include <future>
 #include <iostream>
 #include <cassert>
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <vector>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <algorithm>
 
 using namespace zjpdns;
 
@@ -28,6 +49,1702 @@ void testDnsPacketBuilder() {
     std::cout << "DNS packet builder test passed!" << std::endl;
 }
 
+void testQueryIntoBuffer() {
+    std::cout << "test query encoding into buffer..." << std::endl;
+    
+    uint8_t buffer[DNS_QUERY_BUFFER_SIZE];
+    size_t length = DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), "www.Example.com.",
+                                                       DnsRecordType::AAAA, DnsRecordClass::IN, 777);
+    auto expected = DnsPacketBuilder::buildQueryPacket("www.Example.com", DnsRecordType::AAAA,
+                                                       DnsRecordClass::IN, 777);
+    assert(length == expected.size());
+    assert(memcmp(buffer, expected.data(), length) == 0);
+    
+    DnsPacketView view(buffer, length);
+    assert(view.valid());
+    assert(view.id() == 777);
+    assert(view.flags() == 0x0100);
+    assert((*view.questions().begin()).name.equals("www.example.com"));
+    assert((*view.questions().begin()).recordType() == DnsRecordType::AAAA);
+    
+    // 根域名
+    assert(DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), ".", DnsRecordType::NS) == 17);
+    
+    // 缓冲区不足、空标签、超长标签
+    assert(DnsPacketBuilder::buildQueryPacket(buffer, length - 1, "www.Example.com") == 0);
+    assert(DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), "www..com") == 0);
+    assert(DnsPacketBuilder::buildQueryPacket("www..com").empty());
+    assert(DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), std::string(64, 'a') + ".com") == 0);
+    assert(DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), std::string(63, 'a') + ".com") > 0);
+    
+    std::cout << "query encoding into buffer test passed!" << std::endl;
+}
+
+void testNameCompression() {
+    std::cout << "test name compression..." << std::endl;
+    
+    // 同一区域下20条记录，所有者域名共享后缀
+    DnsPacket packet;
+    packet.id = 4321;
+    packet.flags = 0x8180;
+    packet.qdcount = 1;
+    packet.questions.push_back("example.com");
+    size_t uncompressed = 12 + DnsPacketBuilder::encodeDomain("example.com").size() + 4;
+    for (int i = 0; i < 20; ++i) {
+        DnsRecord record;
+        record.name = "host" + std::to_string(i) + ".svc.Example.COM.";
+        record.type = DnsRecordType::A;
+        record.class_ = DnsRecordClass::IN;
+        record.ttl = 300;
+        record.data = std::string("\x0a\x00\x00", 3) + static_cast<char>(i);
+        packet.answers.push_back(record);
+        uncompressed += DnsPacketBuilder::encodeDomain(record.name).size() + 10 + 4;
+    }
+    packet.ancount = 20;
+    
+    auto data = DnsPacketBuilder::buildCustomPacket(packet);
+    assert(uncompressed > 512);
+    assert(data.size() < 512);
+    assert(data.size() < uncompressed);
+    
+    // 解码后的域名与原始域名一致（后缀匹配不区分大小写）
+    DnsPacketView view(data);
+    assert(view.valid());
+    int index = 0;
+    for (const auto& record : view.answers()) {
+        assert(record.name.equals("host" + std::to_string(index) + ".svc.example.com"));
+        assert(record.rdata[3] == index);
+        ++index;
+    }
+    assert(index == 20);
+    
+    DnsPacket parsed = DnsPacketBuilder::parsePacket(data);
+    assert(parsed.answers.size() == 20);
+    assert(parsed.answers[0].name == "host0.svc.example.com.");
+    assert(parsed.answers[19].name == "host19.svc.example.com.");
+    
+    std::cout << "name compression test passed!" << std::endl;
+}
+
+void testSimdDomainScan() {
+    std::cout << "test SIMD domain scan..." << std::endl;
+    
+    const simd::Kernel kernels[] = {simd::Kernel::SCALAR, simd::Kernel::SSE2, simd::Kernel::AVX2};
+    
+    std::vector<std::string> names = {
+        "a", "example.com", "WWW.Example.COM", "a-b.c-d.e", "0.1.2.3.in-addr.arpa",
+        std::string(63, 'x') + ".com", std::string(64, 'x') + ".com", "com." + std::string(63, 'Y'),
+        "", ".", ".com", "com.", "a..b", "under_score.com", "sp ace.com", "caf\xc3\xa9.com",
+        "ex\x7f.com", "a.b.c.d.e.f.g.h.i.j.k.l.m.n.o.p.q.r.s.t.u.v.w.x.y.z.A.B.C.D.E.F.G"
+    };
+    // 最大长度附近
+    std::string long_name;
+    while (long_name.size() < 253) long_name += "abcdefghi.";
+    names.push_back(long_name.substr(0, 253));
+    names.push_back(long_name.substr(0, 254));
+    
+    // 随机名称：字符集偏向合法字符，包含跨越向量块边界的长标签
+    std::mt19937 gen(12345);
+    const std::string alphabet = "abcXYZ019-..-_!\x80";
+    for (int i = 0; i < 5000; ++i) {
+        std::string name(gen() % 100, 'a');
+        for (char& c : name) {
+            c = gen() % 8 == 0 ? alphabet[gen() % alphabet.size()] : static_cast<char>('a' + gen() % 26);
+        }
+        names.push_back(name);
+    }
+    
+    for (const auto& name : names) {
+        bool expected = simd::scanDomain(simd::Kernel::SCALAR, name.data(), name.size());
+        std::string expected_lower(name.size(), '\0');
+        simd::toLowerAscii(simd::Kernel::SCALAR, name.data(), name.size(), &expected_lower[0]);
+        
+        for (simd::Kernel kernel : kernels) {
+            std::string lowered(name.size(), '\0');
+            assert(simd::scanDomain(kernel, name.data(), name.size(), &lowered[0]) == expected);
+            if (expected) {
+                assert(lowered == expected_lower);
+            }
+            std::string folded(name.size(), '\0');
+            simd::toLowerAscii(kernel, name.data(), name.size(), &folded[0]);
+            assert(folded == expected_lower);
+        }
+    }
+    
+    assert(simd::scanDomain("WWW.Example.COM", 15));
+    assert(!simd::scanDomain("a..b", 4));
+    assert(!simd::scanDomain(names[6].data(), names[6].size()));
+    assert(simd::scanDomain(names[5].data(), names[5].size()));
+    std::string lowered(15, '\0');
+    simd::scanDomain("WWW.Example.COM", 15, &lowered[0]);
+    assert(lowered == "www.example.com");
+    
+    std::cout << "SIMD domain scan test passed (" << simd::kernelName(simd::activeKernel())
+              << ")!" << std::endl;
+}
+
+void testTypedRdata() {
+    std::cout << "test typed RDATA..." << std::endl;
+    
+    // 问题域名example.com位于偏移12，RDATA中的域名用压缩指针0xC00C引用它
+    auto makeRecord = [](DnsRecordType type, const std::vector<uint8_t>& rdata) {
+        DnsRecord record;
+        record.name = "example.com";
+        record.type = type;
+        record.ttl = 300;
+        record.data.assign(rdata.begin(), rdata.end());
+        return record;
+    };
+    
+    DnsPacket packet;
+    packet.id = 99;
+    packet.flags = 0x8180;
+    packet.qdcount = 1;
+    packet.questions.push_back("example.com");
+    packet.answers.push_back(makeRecord(DnsRecordType::MX, {0, 10, 4, 'm', 'a', 'i', 'l', 0xC0, 0x0C}));
+    packet.answers.push_back(makeRecord(DnsRecordType::SRV, {0, 1, 0, 5, 0x13, 0xC4, 3, 's', 'i', 'p', 0xC0, 0x0C}));
+    packet.answers.push_back(makeRecord(DnsRecordType::TXT, {5, 'h', 'e', 'l', 'l', 'o', 0, 3, 'a', '=', 'b'}));
+    packet.answers.push_back(makeRecord(DnsRecordType::CAA, {0x80, 5, 'i', 's', 's', 'u', 'e',
+                                                             'c', 'a', '.', 'o', 'r', 'g'}));
+    packet.answers.push_back(makeRecord(DnsRecordType::CNAME, {0xC0, 0x0C}));
+    packet.answers.push_back(makeRecord(DnsRecordType::PTR, {4, 'h', 'o', 's', 't', 3, 'n', 'e', 't', 0}));
+    packet.ancount = 6;
+    packet.authorities.push_back(makeRecord(DnsRecordType::SOA, {
+        3, 'n', 's', '1', 0xC0, 0x0C, 10, 'h', 'o', 's', 't', 'm', 'a', 's', 't', 'e', 'r', 0xC0, 0x0C,
+        0, 0, 0, 42, 0, 0, 0x0E, 0x10, 0, 0, 0x03, 0x84, 0, 0x09, 0x3A, 0x80, 0, 0, 0x01, 0x2C}));
+    packet.authorities.push_back(makeRecord(DnsRecordType::NS, {3, 'n', 's', '2', 0xC0, 0x0C}));
+    packet.nscount = 2;
+    std::vector<uint8_t> data = DnsPacketBuilder::buildCustomPacket(packet);
+    
+    DnsResult result = DnsPacketBuilder::parseResponsePacket(data);
+    assert(result.success);
+    assert(result.records.size() == 6);
+    
+    MxData mx;
+    assert(result.records[0].mx(mx));
+    assert(mx.preference == 10 && mx.exchange == "mail.example.com.");
+    
+    SrvData srv;
+    assert(result.records[1].srv(srv));
+    assert(srv.priority == 1 && srv.weight == 5 && srv.port == 5060 && srv.target == "sip.example.com.");
+    assert(!result.records[1].mx(mx));
+    
+    TxtData txt;
+    assert(result.records[2].txt(txt));
+    assert(txt.strings.size() == 3 && txt.strings[0] == "hello" && txt.strings[1].empty() && txt.strings[2] == "a=b");
+    
+    CaaData caa;
+    assert(result.records[3].caa(caa));
+    assert(caa.flags == 0x80 && caa.tag == "issue" && caa.value == "ca.org");
+    
+    std::string target;
+    assert(result.records[4].target(target) && target == "example.com.");
+    assert(result.records[5].target(target) && target == "host.net.");
+    
+    SoaData soa;
+    assert(result.authorities[0].soa(soa));
+    assert(soa.mname == "ns1.example.com." && soa.rname == "hostmaster.example.com.");
+    assert(soa.serial == 42 && soa.refresh == 3600 && soa.retry == 900 &&
+           soa.expire == 604800 && soa.minimum == 300);
+    assert(result.authorities[1].target(target) && target == "ns2.example.com.");
+    
+    // 解析时已展开压缩域名，拷贝后的记录不依赖原始数据包
+    DnsRecord copy = result.records[0];
+    result = DnsResult();
+    assert(copy.mx(mx) && mx.exchange == "mail.example.com.");
+    assert(copy.data.size() == 2 + 18);
+    
+    // pmr解析路径得到相同的展开后RDATA
+    std::pmr::monotonic_buffer_resource resource;
+    zjpdns::pmr::DnsResult pmr_result = DnsPacketBuilder::parseResponsePacket(data.data(), data.size(), &resource);
+    DnsResult reparsed = DnsPacketBuilder::parseResponsePacket(data);
+    assert(pmr_result.records.size() == reparsed.records.size());
+    for (size_t i = 0; i < reparsed.records.size(); ++i) {
+        assert(std::string(pmr_result.records[i].data) == reparsed.records[i].data);
+    }
+    assert(std::string(pmr_result.authorities[0].data) == reparsed.authorities[0].data);
+    zjpdns::pmr::DnsPacket pmr_packet = DnsPacketBuilder::parsePacket(data.data(), data.size(), &resource);
+    assert(std::string(pmr_packet.answers[4].data) == DnsPacketBuilder::parsePacket(data).answers[4].data);
+    
+    // 零拷贝视图上的同名访问接口
+    DnsPacketView view(data);
+    auto it = view.answers().begin();
+    assert((*it).mx(mx) && mx.exchange == "mail.example.com.");
+    ++it;
+    assert((*it).srv(srv) && srv.target == "sip.example.com.");
+    assert((*view.authorities().begin()).soa(soa) && soa.minimum == 300);
+    
+    // 手工构造的记录，RDATA中的域名不能含压缩指针
+    DnsRecord manual = makeRecord(DnsRecordType::MX, {0, 5, 2, 'm', 'x', 3, 'o', 'r', 'g', 0});
+    assert(manual.mx(mx) && mx.preference == 5 && mx.exchange == "mx.org.");
+    
+    // RDATA截断或多余数据
+    assert(!makeRecord(DnsRecordType::MX, {0, 5, 2, 'm'}).mx(mx));
+    assert(!makeRecord(DnsRecordType::SRV, {0, 1, 0, 5, 0x13}).srv(srv));
+    assert(!makeRecord(DnsRecordType::TXT, {5, 'a'}).txt(txt));
+    assert(!makeRecord(DnsRecordType::CNAME, {1, 'a', 0, 7}).target(target));
+    
+    std::cout << "typed RDATA test passed!" << std::endl;
+}
+
+void testDnsPacketView() {
+    std::cout << "test DNS packet view..." << std::endl;
+    
+    // 响应：www.example.com CNAME web.example.com, web.example.com A 93.184.216.34
+    const uint8_t response[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+        0x00, 0x01, 0x00, 0x01,
+        0xC0, 0x0C, 0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x06,
+        3, 'w', 'e', 'b', 0xC0, 0x10,
+        0xC0, 0x2D, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04,
+        93, 184, 216, 34
+    };
+    
+    zjpdns::DnsPacketView view(response, sizeof(response));
+    assert(view.valid());
+    assert(view.id() == 0x1234);
+    assert(view.isResponse() && view.rcode() == 0);
+    
+    int questions = 0;
+    for (auto question : view.questions()) {
+        assert(question.name.equals("WWW.example.com."));
+        assert(question.recordType() == DnsRecordType::A);
+        ++questions;
+    }
+    assert(questions == 1);
+    
+    std::vector<zjpdns::DnsRecordView> answers;
+    for (auto record : view.answers()) {
+        answers.push_back(record);
+    }
+    assert(answers.size() == 2);
+    assert(answers[0].recordType() == DnsRecordType::CNAME);
+    assert(answers[0].name.toString() == "www.example.com.");
+    assert(answers[0].ttl == 3600);
+    
+    // RDATA中的压缩域名同样可以按需解码
+    zjpdns::DnsNameView target(view.data(), view.size(), answers[0].rdata_offset);
+    assert(target.toString() == "web.example.com.");
+    assert(answers[1].name.equals("web.example.com"));
+    assert(!answers[1].name.equals("web.example.co"));
+    assert(answers[1].rdata_length == 4 && answers[1].rdata == response + sizeof(response) - 4);
+    
+    char buffer[8];
+    assert(answers[1].name.decode(buffer, sizeof(buffer)) == 0);
+    
+    // 截断的数据包无效
+    zjpdns::DnsPacketView truncated(response, sizeof(response) - 1);
+    assert(!truncated.valid());
+    assert(truncated.answers().begin() == truncated.answers().end());
+    
+    // 指针环不会死循环
+    const uint8_t loop[] = {0, 0, 0x81, 0x80, 0, 1, 0, 0, 0, 0, 0, 0, 0xC0, 0x0C, 0, 1, 0, 1};
+    zjpdns::DnsPacketView looped(loop, sizeof(loop));
+    assert(looped.valid());
+    assert((*looped.questions().begin()).name.toString().empty());
+    
+    std::cout << "DNS packet view test passed!" << std::endl;
+}
+
+void testPmrParse() {
+    std::cout << "test pmr parse..." << std::endl;
+    
+    // 响应：www.example.com A 93.184.216.34
+    const uint8_t response[] = {
+        0x12, 0x34, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+        3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+        0x00, 0x01, 0x00, 0x01,
+        0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04,
+        93, 184, 216, 34
+    };
+    std::vector<uint8_t> data(response, response + sizeof(response));
+    auto expected = DnsPacketBuilder::parseResponsePacket(data);
+    
+    // 上游为null_memory_resource，任何超出栈缓冲区的分配都会抛出异常
+    alignas(std::max_align_t) char buffer[4096];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    
+    for (int i = 0; i < 4; ++i) {
+        auto result = DnsPacketBuilder::parseResponsePacket(response, sizeof(response), &arena);
+        assert(result.success == expected.success);
+        assert(result.domains.size() == 1 && std::string_view(result.domains[0]) == expected.domains[0]);
+        assert(result.addresses.size() == 1 && std::string_view(result.addresses[0]) == expected.addresses[0]);
+        assert(result.records.size() == 1);
+        assert(std::string_view(result.records[0].name) == expected.records[0].name);
+        assert(result.records[0].ttl == 60);
+        assert(std::string_view(result.records[0].data) == expected.records[0].data);
+        assert(result.records.get_allocator().resource() == &arena);
+    }
+    
+    auto packet = DnsPacketBuilder::parsePacket(response, sizeof(response), &arena);
+    assert(packet.id == 0x1234);
+    assert(packet.questions.size() == 1 && packet.questions[0] == "www.example.com.");
+    assert(packet.answers.size() == 1 && packet.answers[0].type == DnsRecordType::A);
+    
+    std::cout << "pmr parse test passed!" << std::endl;
+}
+
+void testEdns() {
+    std::cout << "test EDNS(0)..." << std::endl;
+    
+    // 查询附加OPT记录，两种编码方式结果一致
+    auto query = DnsPacketBuilder::buildQueryPacket("example.com", DnsRecordType::TXT, DnsRecordClass::IN,
+                                                    99, DNS_EDNS_PAYLOAD_SIZE);
+    uint8_t buffer[DNS_QUERY_BUFFER_SIZE];
+    size_t length = DnsPacketBuilder::buildQueryPacket(buffer, sizeof(buffer), "example.com", DnsRecordType::TXT,
+                                                       DnsRecordClass::IN, 99, DNS_EDNS_PAYLOAD_SIZE);
+    assert(length == query.size());
+    assert(memcmp(buffer, query.data(), length) == 0);
+    assert(query.size() == DnsPacketBuilder::buildQueryPacket("example.com", DnsRecordType::TXT).size() +
+                           DNS_OPT_RECORD_SIZE);
+    
+    DnsPacketView view(query);
+    assert(view.valid());
+    assert(view.arcount() == 1);
+    auto opt = *view.additionals().begin();
+    assert(opt.recordType() == DnsRecordType::OPT);
+    assert(opt.class_ == DNS_EDNS_PAYLOAD_SIZE);
+    assert(opt.ttl == 0);
+    assert(opt.rdata_length == 0);
+    
+    // 应答：TC标志、扩展响应码BADVERS(16)、DO位和一个选项
+    DnsPacket packet;
+    packet.id = 99;
+    packet.flags = 0x8380;
+    packet.qdcount = 1;
+    packet.questions.push_back("example.com");
+    DnsRecord record = DnsPacketBuilder::buildOptRecord(4096, {EdnsOption(10, "cookie01")}, true);
+    record.ttl |= 1u << 24;
+    packet.additionals.push_back(record);
+    packet.arcount = 1;
+    
+    auto data = DnsPacketBuilder::buildCustomPacket(packet);
+    DnsResult result = DnsPacketBuilder::parseResponsePacket(data);
+    assert(!result.success);
+    assert(result.truncated);
+    assert(result.rcode == 16);
+    assert(result.edns.present);
+    assert(result.edns.payload_size == 4096);
+    assert(result.edns.version == 0);
+    assert(result.edns.dnssec_ok);
+    assert(result.edns.options.size() == 1);
+    assert(result.edns.options[0].code == 10);
+    assert(result.edns.options[0].data == "cookie01");
+    
+    std::pmr::monotonic_buffer_resource resource;
+    auto pmr_result = DnsPacketBuilder::parseResponsePacket(data.data(), data.size(), &resource);
+    assert(pmr_result.truncated);
+    assert(pmr_result.rcode == 16);
+    
+    // 截断的成功应答不缓存
+    packet.additionals.clear();
+    packet.arcount = 0;
+    result = DnsPacketBuilder::parseResponsePacket(DnsPacketBuilder::buildCustomPacket(packet));
+    assert(result.success && result.truncated && !result.edns.present);
+    DnsCache cache(16);
+    cache.insert("example.com", DnsRecordType::TXT, DnsRecordClass::IN, result);
+    assert(cache.size() == 0);
+    
+    // 端到端：默认带OPT查询；服务器返回FORMERR时去掉OPT重试
+    LocalResponder responder;
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(500);
+    
+    result = resolver->resolve("edns.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(result.success && result.edns.present);
+    assert(result.edns.payload_size == DNS_EDNS_PAYLOAD_SIZE);
+    
+    result = resolver->resolve("noedns.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(result.success && !result.edns.present);
+    assert(responder.queries() == 3);
+    
+    resolver->setEdnsPayloadSize(0);
+    result = resolver->resolve("plain.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(result.success && !result.edns.present);
+    assert(responder.queries() == 4);
+    
+    auto async_resolver = zjpdns::createAsyncDnsResolver(1);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(500);
+    result = async_resolver->resolveAsync("noedns.async.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).get();
+    assert(result.success && !result.edns.present);
+    auto batch = async_resolver->resolveBatchAsync({DnsQuery("noedns.batch.test"), DnsQuery("edns.batch.test")}).get();
+    assert(batch[0].success && !batch[0].edns.present);
+    assert(batch[1].success && batch[1].edns.present);
+    
+    std::cout << "EDNS(0) test passed!" << std::endl;
+}
+
+void testDnsCache() {
+    std::cout << "test DNS cache..." << std::endl;
+    
+    zjpdns::DnsResult result;
+    result.success = true;
+    result.domains.push_back("www.example.com.");
+    result.addresses.push_back("93.184.216.34");
+    zjpdns::DnsRecord record;
+    record.name = "www.example.com.";
+    record.ttl = 60;
+    record.data = std::string("\x5d\xb8\xd8\x22", 4);
+    result.records.push_back(record);
+    
+    zjpdns::DnsCache cache(2);
+    cache.insert("www.example.com", DnsRecordType::A, DnsRecordClass::IN, result);
+    
+    // 命中缓存（域名不区分大小写，忽略末尾的点）
+    zjpdns::DnsResult cached;
+    assert(cache.lookup("WWW.Example.com.", DnsRecordType::A, DnsRecordClass::IN, cached));
+    assert(cached.success);
+    assert(cached.addresses.size() == 1);
+    assert(cached.records[0].ttl <= 60);
+    
+    // 类型不同不命中
+    assert(!cache.lookup("www.example.com", DnsRecordType::AAAA, DnsRecordClass::IN, cached));
+    
+    // TTL为0或失败结果不缓存
+    zjpdns::DnsResult zero_ttl = result;
+    zero_ttl.records[0].ttl = 0;
+    cache.insert("zero.example.com", DnsRecordType::A, DnsRecordClass::IN, zero_ttl);
+    assert(!cache.lookup("zero.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    zjpdns::DnsResult failed;
+    cache.insert("failed.example.com", DnsRecordType::A, DnsRecordClass::IN, failed);
+    assert(!cache.lookup("failed.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    
+    // 超出容量时淘汰最久未使用的条目
+    cache.insert("a.example.com", DnsRecordType::A, DnsRecordClass::IN, result);
+    cache.insert("b.example.com", DnsRecordType::A, DnsRecordClass::IN, result);
+    assert(cache.size() == 2);
+    assert(!cache.lookup("www.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    
+    // 容量为0时关闭缓存
+    cache.setMaxEntries(0);
+    assert(cache.size() == 0);
+    cache.insert("c.example.com", DnsRecordType::A, DnsRecordClass::IN, result);
+    assert(!cache.lookup("c.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    
+    std::cout << "DNS cache test passed!" << std::endl;
+}
+
+void testNegativeCache() {
+    std::cout << "test negative cache..." << std::endl;
+    
+    // 构造SOA记录：MNAME, RNAME, SERIAL, REFRESH, RETRY, EXPIRE, MINIMUM(30)
+    auto mname = DnsPacketBuilder::encodeDomain("ns1.example.com");
+    auto rname = DnsPacketBuilder::encodeDomain("hostmaster.example.com");
+    zjpdns::DnsRecord soa;
+    soa.name = "example.com";
+    soa.type = DnsRecordType::SOA;
+    soa.ttl = 3600;
+    soa.data.assign(mname.begin(), mname.end());
+    soa.data.append(rname.begin(), rname.end());
+    const uint8_t timers[20] = {0, 0, 0, 1, 0, 0, 0x0e, 0x10, 0, 0, 0x07, 0x08,
+                                0, 0x09, 0x3a, 0x80, 0, 0, 0, 30};
+    soa.data.append(reinterpret_cast<const char*>(timers), sizeof(timers));
+    
+    // NXDOMAIN响应
+    zjpdns::DnsPacket response;
+    response.id = 4321;
+    response.flags = 0x8183; // QR, RD, RA, RCODE=3
+    response.qdcount = 1;
+    response.nscount = 1;
+    response.questions.push_back("missing.example.com");
+    response.authorities.push_back(soa);
+    
+    auto data = DnsPacketBuilder::buildCustomPacket(response);
+    auto result = DnsPacketBuilder::parseResponsePacket(data);
+    assert(!result.success);
+    assert(result.rcode == 3);
+    assert(result.authorities.size() == 1);
+    assert(result.authorities[0].type == DnsRecordType::SOA);
+    
+    zjpdns::DnsCache cache;
+    cache.insert("missing.example.com", DnsRecordType::A, DnsRecordClass::IN, result);
+    zjpdns::DnsResult cached;
+    assert(cache.lookup("missing.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    assert(!cached.success);
+    assert(cached.rcode == 3);
+    assert(cached.authorities[0].ttl <= 3600);
+    
+    // NODATA响应同样缓存
+    response.flags = 0x8180;
+    auto nodata = DnsPacketBuilder::parseResponsePacket(DnsPacketBuilder::buildCustomPacket(response));
+    assert(nodata.success && nodata.records.empty());
+    cache.insert("missing.example.com", DnsRecordType::AAAA, DnsRecordClass::IN, nodata);
+    assert(cache.lookup("missing.example.com", DnsRecordType::AAAA, DnsRecordClass::IN, cached));
+    assert(cached.success && cached.addresses.empty());
+    
+    // 没有SOA记录或SERVFAIL不缓存
+    response.authorities.clear();
+    response.nscount = 0;
+    response.flags = 0x8183;
+    cache.insert("nosoa.example.com", DnsRecordType::A, DnsRecordClass::IN,
+                 DnsPacketBuilder::parseResponsePacket(DnsPacketBuilder::buildCustomPacket(response)));
+    assert(!cache.lookup("nosoa.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    response.authorities.push_back(soa);
+    response.nscount = 1;
+    response.flags = 0x8182;
+    cache.insert("servfail.example.com", DnsRecordType::A, DnsRecordClass::IN,
+                 DnsPacketBuilder::parseResponsePacket(DnsPacketBuilder::buildCustomPacket(response)));
+    assert(!cache.lookup("servfail.example.com", DnsRecordType::A, DnsRecordClass::IN, cached));
+    
+    std::cout << "negative cache test passed!" << std::endl;
+}
+
+void testPacketSenderPool() {
+    std::cout << "test packet sender pool..." << std::endl;
+    
+    LocalResponder responder;
+    
+    // 分发键不区分域名大小写
+    auto lower = DnsPacketBuilder::buildQueryPacket("www.example.com", DnsRecordType::A,
+                                                    DnsRecordClass::IN, 100);
+    auto upper = DnsPacketBuilder::buildQueryPacket("WWW.Example.COM", DnsRecordType::A,
+                                                    DnsRecordClass::IN, 100);
+    assert(DnsPacketSender::makeWaiterKey(lower.data(), lower.size()) ==
+           DnsPacketSender::makeWaiterKey(upper.data(), upper.size()));
+    
+    // 多线程共享少量socket并发查询，响应按事务ID和问题分发
+    DnsPacketSender sender(2);
+    std::atomic<int> succeeded{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&sender, &responder, &succeeded, t]() {
+            for (int i = 0; i < 20; ++i) {
+                std::string domain = "host" + std::to_string(t) + "-" + std::to_string(i) + ".test";
+                auto packet = DnsPacketBuilder::buildQueryPacket(domain);
+                auto result = sender.sendPacket("127.0.0.1", responder.port(), packet, 2000);
+                if (result.success && result.domains.size() == 1 &&
+                    result.domains[0] == domain + "." && result.addresses.size() == 1) {
+                    ++succeeded;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(succeeded == 160);
+    
+    // 相同事务ID和问题的并发查询也能正确完成
+    std::atomic<int> duplicates{0};
+    threads.clear();
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&sender, &responder, &duplicates, &lower]() {
+            auto result = sender.sendPacket("127.0.0.1", responder.port(), lower, 2000);
+            if (result.success) ++duplicates;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(duplicates == 4);
+    
+    // 无效域名得到的空数据包不发送
+    std::vector<uint8_t> empty = DnsPacketBuilder::buildQueryPacket(std::string(64, 'a') + ".com");
+    assert(empty.empty());
+    int sent_before = responder.queries();
+    assert(sender.sendPacket("127.0.0.1", responder.port(), empty, 500).error_message == "Invalid DNS query packet");
+    std::vector<DnsResult> mixed = sender.sendBatch("127.0.0.1", responder.port(), {empty, lower}, 2000);
+    assert(mixed[0].error_message == "Invalid DNS query packet" && mixed[1].success);
+    assert(responder.queries() == sent_before + 1);
+    
+    // 解析器缓存命中时不再发送查询
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    int before = responder.queries();
+    auto first = resolver->resolve("cached.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    auto second = resolver->resolve("cached.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(first.success && second.success);
+    assert(second.addresses == first.addresses);
+    assert(responder.queries() == before + 1);
+    
+    std::cout << "packet sender pool test passed!" << std::endl;
+}
+
+void testAsyncEventLoop() {
+    std::cout << "test async event loop..." << std::endl;
+    
+    LocalResponder responder;
+    responder.setSlowDelay(300);
+    
+    auto async_resolver = zjpdns::createAsyncDnsResolver();
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(1000);
+    
+    // 慢速查询和丢弃的查询不阻塞其他查询
+    auto slow = async_resolver->resolveAsync("slow.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    auto dropped = async_resolver->resolveAsync("drop.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    
+    std::vector<std::future<zjpdns::DnsResult>> futures;
+    for (int i = 0; i < 500; ++i) {
+        futures.push_back(async_resolver->resolveAsync("fast" + std::to_string(i) + ".test",
+                                                       DnsRecordType::A, ResolveMethod::DNS_PACKET));
+    }
+    for (int i = 0; i < 500; ++i) {
+        auto result = futures[i].get();
+        assert(result.success);
+        assert(result.domains[0] == "fast" + std::to_string(i) + ".test.");
+    }
+    assert(slow.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready);
+    
+    // 慢速应答乱序到达
+    auto slow_result = slow.get();
+    assert(slow_result.success);
+    assert(dropped.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready);
+    
+    // 丢弃的查询按自身超时失败
+    auto dropped_result = dropped.get();
+    assert(!dropped_result.success);
+    assert(dropped_result.error_message == "Receive DNS response timeout");
+    
+    // 回调方式与缓存命中
+    std::promise<zjpdns::DnsResult> callback_promise;
+    async_resolver->resolveWithCallback("fast0.test",
+        [&callback_promise](const zjpdns::DnsResult& result) {
+            callback_promise.set_value(result);
+        },
+        DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    int before = responder.queries();
+    assert(callback_promise.get_future().get().success);
+    assert(responder.queries() == before);
+    
+    std::cout << "async event loop test passed!" << std::endl;
+}
+
+void testWorkStealingExecutor() {
+    std::cout << "test work stealing executor..." << std::endl;
+    
+    zjpdns::WorkStealingExecutor executor(4);
+    executor.start();
+    
+    // 多个外部线程提交，任务中再提交子任务
+    std::atomic<int> executed{0};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&executor, &executed]() {
+            for (int i = 0; i < 1000; ++i) {
+                executor.submit([&executor, &executed]() {
+                    ++executed;
+                    executor.submit([&executed]() { ++executed; });
+                });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    
+    // 停止时执行完所有已提交的任务
+    executor.stop();
+    assert(executed == 8000);
+    
+    // 停止后提交的任务在调用线程中直接执行
+    executor.submit([&executed]() { ++executed; });
+    assert(executed == 8001);
+    
+    std::cout << "work stealing executor test passed!" << std::endl;
+}
+
+void testMultiThreadAsyncResolver() {
+    std::cout << "test multi-thread async resolver..." << std::endl;
+    
+    LocalResponder responder;
+    auto async_resolver = zjpdns::createAsyncDnsResolver(4);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(2000);
+    async_resolver->setCacheSize(0);
+    
+    std::atomic<int> callbacks{0};
+    std::vector<std::future<zjpdns::DnsResult>> futures;
+    for (int i = 0; i < 400; ++i) {
+        std::string domain = "mt" + std::to_string(i) + ".test";
+        if (i % 2 == 0) {
+            futures.push_back(async_resolver->resolveAsync(domain, DnsRecordType::A,
+                                                           ResolveMethod::DNS_PACKET));
+        } else {
+            async_resolver->resolveWithCallback(domain,
+                [&callbacks](const zjpdns::DnsResult& result) {
+                    if (result.success) ++callbacks;
+                },
+                DnsRecordType::A, ResolveMethod::DNS_PACKET);
+        }
+    }
+    for (auto& future : futures) {
+        assert(future.get().success);
+    }
+    for (int i = 0; i < 50 && callbacks < 200; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    assert(callbacks == 200);
+    assert(responder.queries() == 400);
+    
+    // 析构时未完成的查询以失败结束，不会丢失回调
+    std::atomic<int> cancelled{0};
+    for (int i = 0; i < 10; ++i) {
+        async_resolver->resolveWithCallback("slow" + std::to_string(i) + ".test",
+            [&cancelled](const zjpdns::DnsResult& result) {
+                if (!result.success) ++cancelled;
+            },
+            DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    }
+    async_resolver.reset();
+    assert(cancelled == 10);
+    
+    std::cout << "multi-thread async resolver test passed!" << std::endl;
+}
+
+void testBatchResolve() {
+    std::cout << "test batch resolve..." << std::endl;
+    
+    LocalResponder responder;
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(500);
+    
+    // 预先缓存一个域名
+    assert(resolver->resolve("cached.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    assert(responder.queries() == 1);
+    
+    std::vector<zjpdns::DnsQuery> queries;
+    queries.emplace_back("invalid..test");
+    queries.emplace_back("cached.test");
+    queries.emplace_back("drop.test");
+    for (int i = 0; i < 300; ++i) {
+        queries.emplace_back("batch" + std::to_string(i) + ".test");
+    }
+    
+    auto results = resolver->resolveBatch(queries);
+    assert(results.size() == queries.size());
+    assert(!results[0].success);
+    assert(results[1].success);
+    assert(!results[2].success);
+    assert(results[2].error_message == "Receive DNS response timeout");
+    for (size_t i = 3; i < queries.size(); ++i) {
+        assert(results[i].success);
+        assert(results[i].domains[0] == queries[i].domain + ".");
+    }
+    // 没有应答的drop.test在第一次尝试超时后重传一次
+    assert(responder.queries() == 1 + 301 + 1);
+    
+    // 异步批量解析
+    auto async_resolver = zjpdns::createAsyncDnsResolver(2);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(500);
+    
+    auto async_results = async_resolver->resolveBatchAsync(queries).get();
+    assert(async_results.size() == queries.size());
+    assert(!async_results[0].success);
+    assert(!async_results[2].success);
+    for (size_t i = 3; i < queries.size(); ++i) {
+        assert(async_results[i].success);
+        assert(async_results[i].domains[0] == queries[i].domain + ".");
+    }
+    assert(async_resolver->resolveBatchAsync({}).get().empty());
+    
+    std::cout << "batch resolve test passed!" << std::endl;
+}
+
+void testTcpFallback() {
+    std::cout << "test TCP fallback..." << std::endl;
+    
+    LocalResponder responder;
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(1000);
+    
+    // 截断的UDP应答通过TCP重新查询，后续查询复用同一连接
+    DnsResult result = resolver->resolve("big.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(result.success && !result.truncated);
+    assert(result.addresses.size() == DNS_TEST_BIG_ANSWERS);
+    result = resolver->resolve("big2.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(result.success && result.addresses.size() == DNS_TEST_BIG_ANSWERS);
+    assert(responder.tcpConnections() == 1);
+    assert(responder.tcpQueries() == 2);
+    
+    // 批量解析中只有被截断的查询走TCP
+    std::vector<zjpdns::DnsQuery> queries;
+    for (int i = 0; i < 10; ++i) {
+        queries.emplace_back((i % 2 ? "big" : "small") + std::to_string(i) + ".test");
+    }
+    auto results = resolver->resolveBatch(queries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(results[i].success);
+        assert(results[i].domains[0] == queries[i].domain + ".");
+        assert(results[i].addresses.size() == (i % 2 ? DNS_TEST_BIG_ANSWERS : 1u));
+    }
+    assert(responder.tcpConnections() == 1);
+    assert(responder.tcpQueries() == 7);
+    
+    // 流水线：同一连接上的多个查询，应答乱序到达时按事务ID和问题匹配
+    zjpdns::DnsTcpTransport transport;
+    std::vector<std::vector<uint8_t>> packets;
+    for (int i = 0; i < 20; ++i) {
+        packets.push_back(DnsPacketBuilder::buildQueryPacket("pipe" + std::to_string(i) + ".test",
+                                                             DnsRecordType::A, DnsRecordClass::IN, 100));
+    }
+    results = transport.queryBatch("127.0.0.1", responder.port(), packets, 1000);
+    for (size_t i = 0; i < results.size(); ++i) {
+        assert(results[i].success);
+        assert(results[i].domains[0] == "pipe" + std::to_string(i) + ".test.");
+    }
+    assert(transport.connectionCount() == 1);
+    assert(responder.tcpConnections() == 2);
+    
+    // 服务器关闭空闲连接后自动重连
+    responder.closeTcpClients();
+    result = transport.query("127.0.0.1", responder.port(), packets[0], 1000);
+    assert(result.success);
+    assert(responder.tcpConnections() == 3);
+    
+    // 连接失败
+    transport.closeAll();
+    assert(transport.connectionCount() == 0);
+    result = transport.query("127.0.0.1", 1, packets[0], 200);
+    assert(!result.success);
+    
+    // 异步解析在工作线程中走TCP
+    auto async_resolver = zjpdns::createAsyncDnsResolver(2);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(1000);
+    result = async_resolver->resolveAsync("big.async.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).get();
+    assert(result.success && result.addresses.size() == DNS_TEST_BIG_ANSWERS);
+    auto async_results = async_resolver->resolveBatchAsync(queries).get();
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(async_results[i].success);
+        assert(async_results[i].addresses.size() == (i % 2 ? DNS_TEST_BIG_ANSWERS : 1u));
+    }
+    
+    std::cout << "TCP fallback test passed!" << std::endl;
+}
+
+void testUpstreamSelection() {
+    std::cout << "test upstream selection..." << std::endl;
+    
+    // 尚无样本的服务器优先，之后选择SRTT最小的服务器
+    zjpdns::UpstreamSelector selector({DnsServer("10.0.0.1"), DnsServer("10.0.0.2", 5353)});
+    assert(selector.size() == 2);
+    assert(selector.select() == 0);
+    selector.reportRtt(0, 50);
+    assert(selector.select() == 1);
+    selector.reportRtt(1, 5);
+    assert(selector.select() == 1);
+    assert(selector.select(1) == 0);
+    assert(selector.server(1).port == 5353);
+    assert(selector.server(7).address.empty());
+    
+    // 失败后改选其他服务器，失败的服务器SRTT衰减后重新被探测
+    selector.reportFailure(1);
+    selector.reportFailure(1);
+    assert(selector.failures(1) == 2);
+    assert(selector.select() == 0);
+    int probes = 0;
+    while (selector.select() == 0 && ++probes < 1000) {}
+    assert(probes > 0 && probes < 1000);
+    selector.reportRtt(1, 5);
+    assert(selector.failures(1) == 0);
+    
+    // 竞速延迟
+    assert(selector.hedgeDelay(0, 1000) >= DNS_HEDGE_MIN_DELAY);
+    assert(selector.hedgeDelay(0, 40) <= 20);
+    zjpdns::UpstreamSelector empty;
+    assert(empty.select() == zjpdns::UpstreamSelector::npos);
+    assert(empty.hedgeDelay(0, 1000) == DNS_HEDGE_DEFAULT_DELAY);
+    
+    DnsResult servfail;
+    servfail.rcode = 2;
+    DnsResult nxdomain;
+    nxdomain.rcode = 3;
+    assert(zjpdns::UpstreamSelector::isServerFailure(DnsResult()));
+    assert(zjpdns::UpstreamSelector::isServerFailure(servfail));
+    assert(!zjpdns::UpstreamSelector::isServerFailure(nxdomain));
+    
+    // 批量查询整批只记录一次：部分超时不算失败，RTT取最早的有效应答
+    zjpdns::UpstreamSelector batch({DnsServer("10.0.0.3")});
+    batch.reportBatch(0, {DnsResult(), nxdomain, nxdomain, DnsResult()}, {-1, 30, 20, -1});
+    assert(batch.failures(0) == 0 && batch.srtt(0) == 20);
+    batch.reportBatch(0, {DnsResult(), servfail}, {-1, 10});
+    assert(batch.failures(0) == 1);
+    
+    // 慢速首选服务器：竞速查询从快速服务器拿到应答，之后首选快速服务器
+    LocalResponder slow;
+    LocalResponder fast;
+    slow.setDelay(400);
+    std::vector<DnsServer> servers = {DnsServer("127.0.0.1", slow.port()), DnsServer("127.0.0.1", fast.port())};
+    
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServers(servers);
+    resolver->setTimeout(1000);
+    resolver->setHedging(true);
+    resolver->setCacheSize(0);
+    
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        DnsResult result = resolver->resolve("hedge" + std::to_string(i) + ".test", DnsRecordType::A,
+                                             ResolveMethod::DNS_PACKET);
+        assert(result.success);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(elapsed.count() < 400);
+    assert(slow.queries() == 1);
+    assert(fast.queries() == 5);
+    
+    // 不竞速：不可达的服务器超时一次后不再被首选
+    auto failover = zjpdns::createDnsResolver();
+    failover->setDnsServers({DnsServer("127.0.0.1", 1), DnsServer("127.0.0.1", fast.port())});
+    failover->setTimeout(200);
+    assert(!failover->resolve("dead.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    assert(failover->resolve("alive.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    assert(failover->resolve("alive2.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    
+    // 异步竞速
+    auto async_resolver = zjpdns::createAsyncDnsResolver(1);
+    async_resolver->setDnsServers(servers);
+    async_resolver->setTimeout(1000);
+    async_resolver->setHedging(true);
+    start = std::chrono::steady_clock::now();
+    DnsResult result = async_resolver->resolveAsync("async-hedge.test", DnsRecordType::A,
+                                                    ResolveMethod::DNS_PACKET).get();
+    assert(result.success);
+    for (int i = 0; i < 4; ++i) {
+        assert(async_resolver->resolveAsync("async-hedge" + std::to_string(i) + ".test", DnsRecordType::A,
+                                            ResolveMethod::DNS_PACKET).get().success);
+    }
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(elapsed.count() < 400);
+    assert(slow.queries() == 2);
+    
+    // 没有上游服务器时批量和自定义数据包查询同样报告未设置服务器
+    std::vector<zjpdns::DnsQuery> queries = {{"empty-batch.test", DnsRecordType::A}};
+    resolver->setDnsServers({});
+    assert(resolver->resolveBatch(queries)[0].error_message == "未设置DNS服务器");
+    async_resolver->setDnsServers({});
+    assert(async_resolver->resolveBatchAsync(queries).get()[0].error_message == "未设置DNS服务器");
+    zjpdns::DnsPacket custom;
+    custom.questions.push_back("empty-custom.test");
+    custom.qdcount = 1;
+    assert(async_resolver->resolveWithPacketAsync(custom).get().error_message == "未设置DNS服务器");
+    
+    std::cout << "upstream selection test passed!" << std::endl;
+}
+
+void testRetryPolicy() {
+    std::cout << "test retry policy..." << std::endl;
+    
+    // 每次尝试的超时指数增长，总和等于总超时
+    zjpdns::RetryPolicy policy;
+    policy.initial_timeout_ms = 100;
+    policy.jitter = 0;
+    std::vector<int> timeouts = policy.attemptTimeouts(2000);
+    assert(timeouts.size() == 4);
+    assert(timeouts[0] == 100 && timeouts[1] == 200 && timeouts[2] == 400 && timeouts[3] == 1300);
+    policy.jitter = 0.2;
+    for (int i = 0; i < 100; ++i) {
+        timeouts = policy.attemptTimeouts(2000);
+        int total = 0;
+        for (int timeout : timeouts) total += timeout;
+        assert(total == 2000);
+        assert(timeouts[0] >= 80 && timeouts[0] <= 120);
+    }
+    assert(policy.attemptTimeouts(50).size() == 1);
+    zjpdns::RetryPolicy no_retry;
+    no_retry.retries = 0;
+    assert(no_retry.attemptTimeouts(2000) == std::vector<int>(1, 2000));
+    
+    // 第一次查询丢失：在第一次尝试超时后重传，重传使用不同的事务ID和源端口
+    LocalResponder responder;
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(2000);
+    resolver->setCacheSize(0);
+    resolver->setRetryPolicy(policy);
+    
+    auto start = std::chrono::steady_clock::now();
+    DnsResult result = resolver->resolve("lose.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert(elapsed.count() < 500);
+    auto queries = responder.lossQueries();
+    assert(queries.size() == 2);
+    assert(queries[0].first != queries[1].first);
+    assert(queries[0].second != queries[1].second);
+    
+    // 不重传时丢失的查询只能超时
+    resolver->setRetryPolicy(no_retry);
+    resolver->setTimeout(300);
+    result = resolver->resolve("lose-once.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(!result.success);
+    resolver->setRetryPolicy(policy);
+    resolver->setTimeout(2000);
+    
+    // 批量查询只重传未应答的查询
+    auto batch = resolver->resolveBatch({DnsQuery("lose-batch.test"), DnsQuery("kept.test")});
+    assert(batch[0].success && batch[1].success);
+    
+    // 异步查询和异步批量查询由事件循环重传
+    auto async_resolver = zjpdns::createAsyncDnsResolver(1);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(2000);
+    async_resolver->setRetryPolicy(policy);
+    start = std::chrono::steady_clock::now();
+    result = async_resolver->resolveAsync("lose-async.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).get();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert(elapsed.count() < 500);
+    auto async_batch = async_resolver->resolveBatchAsync({DnsQuery("lose-async-batch.test"), DnsQuery("kept-async.test")}).get();
+    assert(async_batch[0].success && async_batch[1].success);
+    
+    std::cout << "retry policy test passed!" << std::endl;
+}
+
+void testDualStack() {
+    std::cout << "test dual stack resolve..." << std::endl;
+    
+    // 合并：地址按IPv6、IPv4交替排列，任一成功即为成功
+    DnsResult aaaa;
+    aaaa.success = true;
+    aaaa.domains = {"example.com."};
+    aaaa.addresses = {"::1"};
+    DnsResult a;
+    a.success = true;
+    a.domains = {"example.com."};
+    a.addresses = {"10.0.0.1", "10.0.0.2"};
+    DnsResult merged = zjpdns::DnsResolverImpl::mergeDualResults(aaaa, a);
+    assert(merged.success);
+    assert(merged.domains.size() == 1);
+    assert((merged.addresses == std::vector<std::string>{"::1", "10.0.0.1", "10.0.0.2"}));
+    DnsResult timeout;
+    timeout.error_message = "Receive DNS response timeout";
+    merged = zjpdns::DnsResolverImpl::mergeDualResults(timeout, a);
+    assert(merged.success && merged.addresses.size() == 2 && merged.error_message.empty());
+    merged = zjpdns::DnsResolverImpl::mergeDualResults(timeout, timeout);
+    assert(!merged.success && merged.error_message == timeout.error_message);
+    
+    // 两个查询同时发送：每个应答延迟100ms，总耗时接近一次往返
+    LocalResponder responder;
+    responder.setDelay(100);
+    responder.setSlowDelay(500);
+    auto resolver = zjpdns::createDnsResolver();
+    resolver->setDnsServer("127.0.0.1", responder.port());
+    resolver->setTimeout(2000);
+    
+    auto start = std::chrono::steady_clock::now();
+    DnsResult result = resolver->resolveDual("dual.test");
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert((result.addresses == std::vector<std::string>{"::1", "127.0.0.1"}));
+    assert(result.records.size() == 2);
+    assert(elapsed.count() < 190);
+    assert(responder.queries() == 2);
+    
+    // 缓存命中时不再发送查询
+    assert(resolver->resolveDual("dual.test").addresses.size() == 2);
+    assert(responder.queries() == 2);
+    
+    // AAAA应答慢：A应答后宽限期结束即返回IPv4地址
+    start = std::chrono::steady_clock::now();
+    result = resolver->resolveDual("lag6.test", 50);
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert((result.addresses == std::vector<std::string>{"127.0.0.1"}));
+    assert(elapsed.count() < 350);
+    assert(!resolver->resolveDual("invalid..test").success);
+    
+    // 异步双栈解析
+    auto async_resolver = zjpdns::createAsyncDnsResolver(1);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(2000);
+    start = std::chrono::steady_clock::now();
+    result = async_resolver->resolveDualAsync("async-dual.test").get();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert((result.addresses == std::vector<std::string>{"::1", "127.0.0.1"}));
+    assert(elapsed.count() < 190);
+    
+    start = std::chrono::steady_clock::now();
+    result = async_resolver->resolveDualAsync("lag6-async.test", 50).get();
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    assert(result.success);
+    assert((result.addresses == std::vector<std::string>{"127.0.0.1"}));
+    assert(elapsed.count() < 350);
+    
+    std::cout << "dual stack resolve test passed!" << std::endl;
+}
+
+void testSystemResolver() {
+    std::cout << "test system resolver..." << std::endl;
+    
+    // 按记录类型选择地址族，记录类型与地址一致
+    DnsResult result = zjpdns::SystemResolver::lookup("localhost", DnsRecordType::A);
+    assert(result.success);
+    assert(std::find(result.addresses.begin(), result.addresses.end(), "127.0.0.1") != result.addresses.end());
+    for (const auto& record : result.records) {
+        assert(record.type == DnsRecordType::A && record.data.size() == 4);
+        assert(record.ttl == DNS_SYSTEM_RESOLVER_TTL);
+    }
+    result = zjpdns::SystemResolver::lookup("127.0.0.1", DnsRecordType::AAAA);
+    for (const auto& record : result.records) {
+        assert(record.type == DnsRecordType::AAAA && record.data.size() == 16);
+    }
+    result = zjpdns::SystemResolver::lookup("::1", DnsRecordType::ANY);
+    assert(result.success && result.addresses.size() == 1 && result.addresses[0] == "::1");
+    assert(!zjpdns::SystemResolver::lookup("no-such-host.invalid", DnsRecordType::A).success);
+    
+    // 线程池并发解析，线程数不超过上限
+    zjpdns::SystemResolver system(4);
+    std::atomic<int> succeeded{0};
+    std::atomic<int> completed{0};
+    for (int i = 0; i < 32; ++i) {
+        system.resolve("localhost", DnsRecordType::A, [&](const DnsResult& r) {
+            if (r.success) ++succeeded;
+            ++completed;
+        });
+    }
+    assert(system.threadCount() >= 1 && system.threadCount() <= 4);
+    system.stop();
+    assert(completed == 32 && succeeded == 32);
+    
+    // 停止后在调用线程中直接解析
+    bool inline_called = false;
+    system.resolve("localhost", DnsRecordType::A, [&](const DnsResult& r) { inline_called = r.success; });
+    assert(inline_called);
+    
+    // 同步和异步解析器的系统解析方式
+    auto resolver = zjpdns::createDnsResolver();
+    assert(resolver->resolve("localhost", DnsRecordType::A, ResolveMethod::GETHOSTBYNAME).success);
+    assert(!resolver->resolve("invalid..test", DnsRecordType::A, ResolveMethod::GETHOSTBYNAME).success);
+    auto async_resolver = zjpdns::createAsyncDnsResolver(1);
+    std::vector<std::future<DnsResult>> futures;
+    for (int i = 0; i < 16; ++i) {
+        futures.push_back(async_resolver->resolveAsync("localhost", DnsRecordType::A, ResolveMethod::GETHOSTBYNAME));
+    }
+    for (auto& future : futures) {
+        assert(future.get().success);
+    }
+    assert(!async_resolver->resolveAsync("invalid..test", DnsRecordType::A, ResolveMethod::GETHOSTBYNAME).get().success);
+    
+    std::cout << "system resolver test passed!" << std::endl;
+}
+
+void testMetrics() {
+    std::cout << "test metrics..." << std::endl;
+    
+    // 每个值落在自己的桶内，桶宽不超过下界的1/DNS_METRICS_SUB_BUCKETS
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 12345ull, 1ull << 20, 123456789ull}) {
+        size_t index = zjpdns::Histogram::bucketIndex(value);
+        uint64_t lower = zjpdns::Histogram::bucketLower(index);
+        uint64_t upper = zjpdns::Histogram::bucketUpper(index);
+        assert(index < zjpdns::Histogram::kBucketCount);
+        assert(lower <= value && value < upper);
+        assert((upper - lower) * DNS_METRICS_SUB_BUCKETS <= std::max<uint64_t>(lower, DNS_METRICS_SUB_BUCKETS));
+    }
+    assert(zjpdns::Histogram::bucketIndex(~0ull) == zjpdns::Histogram::kBucketCount - 1);
+    
+    // 百分位数返回所在桶的上界，2的幂边界上的计数是精确的且包含边界值
+    zjpdns::Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value);
+    }
+    zjpdns::HistogramSnapshot snapshot = histogram.snapshot();
+    assert(snapshot.count == 1000 && snapshot.sum_us == 500500);
+    assert(snapshot.percentile(50) == 512);
+    assert(snapshot.percentile(99) == 1024);
+    assert(snapshot.percentile(100) == 1024);
+    assert(snapshot.countBelow(512) == 512);
+    zjpdns::HistogramSnapshot merged = snapshot;
+    merged.merge(snapshot);
+    assert(merged.count == 2000 && merged.countBelow(512) == 1024 && merged.percentile(50) == 512);
+    zjpdns::Histogram boundary;
+    boundary.record(512);
+    assert(boundary.snapshot().countBelow(512) == 1 && boundary.snapshot().countBelow(480) == 0);
+    
+    // 多线程计数不丢失
+    zjpdns::Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter, &histogram]() {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add();
+                histogram.record(2000);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(counter.value() == 80000);
+    assert(histogram.snapshot().count == 81000);
+    
+    // 同步解析器：查询、缓存命中、超时和上游RTT
+    LocalResponder responder;
+    std::string upstream = "127.0.0.1:" + std::to_string(responder.port());
+    zjpdns::RetryPolicy no_retry;
+    no_retry.retries = 0;
+    zjpdns::DnsResolverImpl resolver;
+    resolver.setDnsServer("127.0.0.1", responder.port());
+    resolver.setTimeout(200);
+    resolver.setRetryPolicy(no_retry);
+    assert(resolver.resolve("metrics.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    assert(resolver.resolve("metrics.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    assert(!resolver.resolve("drop.metrics.test", DnsRecordType::A, ResolveMethod::DNS_PACKET).success);
+    
+    zjpdns::MetricsSnapshot sync = resolver.metrics()->snapshot();
+    assert(sync.queries == 2 && sync.retransmits == 0 && sync.timeouts == 1);
+    assert(sync.cache_hits == 1 && sync.cache_misses == 2);
+    assert(sync.rcodes[0] == 2 && sync.failures == 1);
+    assert(sync.latency.count == 3 && sync.latency.countBelow(1 << 17) >= 2);
+    assert(sync.upstream_rtt.count(upstream) && sync.upstream_rtt[upstream].count == 1);
+    
+    // 异步解析器：任务经过执行器队列，全部完成后队列和在途查询归零
+    zjpdns::AsyncDnsResolverImpl async_resolver(2);
+    async_resolver.start();
+    async_resolver.setDnsServer("127.0.0.1", responder.port());
+    std::vector<std::future<DnsResult>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(async_resolver.resolveAsync("metrics" + std::to_string(i) + ".test", DnsRecordType::A,
+                                                      ResolveMethod::DNS_PACKET));
+    }
+    for (auto& future : futures) {
+        assert(future.get().success);
+    }
+    zjpdns::MetricsSnapshot async = async_resolver.metrics()->snapshot();
+    assert(async.queries == 10 && async.cache_misses == 10 && async.rcodes[0] == 10);
+    assert(async.latency.count == 10 && async.queue_wait.count == 10);
+    assert(async.queue_depth == 0 && async.inflight == 0);
+    assert(async.upstream_rtt[upstream].count == 10);
+    
+    // 注册表导出所有存活实例的Prometheus文本
+    std::string text = zjpdns::MetricsRegistry::instance().exportPrometheus();
+    std::string sync_label = "{resolver=\"" + sync.resolver + "\"}";
+    assert(text.find("# TYPE zjpdns_queries_total counter\n") != std::string::npos);
+    assert(text.find("zjpdns_queries_total" + sync_label + " 2\n") != std::string::npos);
+    assert(text.find("zjpdns_timeouts_total" + sync_label + " 1\n") != std::string::npos);
+    assert(text.find("zjpdns_responses_total{resolver=\"" + async.resolver + "\",rcode=\"0\"} 10\n") != std::string::npos);
+    assert(text.find("zjpdns_resolve_latency_seconds_count" + sync_label + " 3\n") != std::string::npos);
+    assert(text.find("zjpdns_upstream_rtt_seconds_bucket{resolver=\"" + async.resolver + "\",upstream=\"" +
+                     upstream + "\",le=\"+Inf\"} 10\n") != std::string::npos);
+    assert(text.find("upstream=\"8.8.8.8:53\"") == std::string::npos);
+    
+    // 桶边界输出精确值：略大于2^20微秒的样本不计入le="1.048576"
+    zjpdns::MetricsSnapshot bounds;
+    bounds.resolver = "bounds";
+    zjpdns::Histogram bounds_latency;
+    bounds_latency.record(1048577);
+    bounds.latency = bounds_latency.snapshot();
+    text = zjpdns::MetricsRegistry::formatPrometheus({bounds});
+    assert(text.find("zjpdns_resolve_latency_seconds_bucket{resolver=\"bounds\",le=\"0.000064\"} 0\n") != std::string::npos);
+    assert(text.find("zjpdns_resolve_latency_seconds_bucket{resolver=\"bounds\",le=\"1.048576\"} 0\n") != std::string::npos);
+    assert(text.find("zjpdns_resolve_latency_seconds_bucket{resolver=\"bounds\",le=\"2.097152\"} 1\n") != std::string::npos);
+    assert(text.find("zjpdns_resolve_latency_seconds_bucket{resolver=\"bounds\",le=\"33.554432\"} 1\n") != std::string::npos);
+    
+    std::cout << "metrics test passed!" << std::endl;
+}
+
+void testTaskQueue() {
+    std::cout << "test task queue..." << std::endl;
+    
+    // 单个工作线程阻塞在回调中，之后提交的任务都留在队列里
+    zjpdns::AsyncDnsResolverImpl resolver(1);
+    resolver.start();
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    auto record = [&](const DnsResult& result) {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(result.overloaded ? "dropped:" + result.domains[0] : result.domains[0]);
+    };
+    auto blockWorker = [&](std::shared_future<void> gate) {
+        std::atomic<bool> entered{false};
+        resolver.resolveWithCallback("gate..test", [&entered, gate](const DnsResult&) {
+            entered = true;
+            gate.wait();
+        }, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+        while (!entered) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+    
+    std::promise<void> release;
+    blockWorker(release.get_future().share());
+    
+    // FAIL：队列满后新任务立即以过载结束
+    resolver.setQueueLimit(4, OverloadPolicy::FAIL);
+    for (int i = 0; i < 4; ++i) {
+        resolver.resolveWithCallback("bulk" + std::to_string(i) + "..test", record, DnsRecordType::A,
+                                     ResolveMethod::DNS_PACKET, TaskPriority::BULK);
+    }
+    auto rejected = resolver.resolveAsync("rejected..test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    assert(rejected.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    DnsResult result = rejected.get();
+    assert(result.overloaded && !result.success && result.domains[0] == "rejected..test");
+    auto batch = resolver.resolveBatchAsync({DnsQuery("a.test"), DnsQuery("b.test")}, TaskPriority::BULK);
+    std::vector<DnsResult> batch_results = batch.get();
+    assert(batch_results.size() == 2 && batch_results[0].overloaded && batch_results[1].domains[0] == "b.test");
+    
+    // DROP_OLDEST：丢弃最早排队的批量任务，但不为批量任务丢弃交互式任务
+    resolver.setQueueLimit(4, OverloadPolicy::DROP_OLDEST);
+    resolver.resolveWithCallback("interactive0..test", record, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    resolver.resolveWithCallback("interactive1..test", record, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    resolver.resolveWithCallback("bulk4..test", record, DnsRecordType::A,
+                                 ResolveMethod::DNS_PACKET, TaskPriority::BULK);
+    resolver.resolveWithCallback("interactive2..test", record, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    resolver.resolveWithCallback("interactive3..test", record, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    resolver.resolveWithCallback("bulk5..test", record, DnsRecordType::A,
+                                 ResolveMethod::DNS_PACKET, TaskPriority::BULK);
+    {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        assert((order == std::vector<std::string>{"dropped:bulk0..test", "dropped:bulk1..test",
+                                                  "dropped:bulk2..test", "dropped:bulk3..test",
+                                                  "dropped:bulk4..test", "dropped:bulk5..test"}));
+        order.clear();
+    }
+    
+    // 交互式任务先于批量任务执行
+    resolver.setQueueLimit(8, OverloadPolicy::FAIL);
+    resolver.resolveWithCallback("bulk6..test", record, DnsRecordType::A,
+                                 ResolveMethod::DNS_PACKET, TaskPriority::BULK);
+    resolver.resolveWithCallback("interactive4..test", record, DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    release.set_value();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(order_mutex);
+        if (order.size() == 6) break;
+    }
+    assert((order == std::vector<std::string>{"interactive0..test", "interactive1..test", "interactive2..test",
+                                              "interactive3..test", "interactive4..test", "bulk6..test"}));
+    
+    // BLOCK：提交线程等待队列空位
+    std::promise<void> release_blocked;
+    blockWorker(release_blocked.get_future().share());
+    resolver.setQueueLimit(1, OverloadPolicy::BLOCK);
+    auto queued = resolver.resolveAsync("queued..test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    std::atomic<bool> submitted{false};
+    std::future<DnsResult> blocked;
+    std::thread producer([&]() {
+        blocked = resolver.resolveAsync("blocked..test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    assert(!submitted);
+    release_blocked.set_value();
+    producer.join();
+    assert(!queued.get().overloaded);
+    assert(!blocked.get().overloaded);
+    
+    zjpdns::MetricsSnapshot metrics = resolver.metrics()->snapshot();
+    assert(metrics.rejected == 8 && metrics.queue_depth == 0);
+    
+    std::cout << "task queue test passed!" << std::endl;
+}
+
+void testMpscQueue() {
+    std::cout << "test MPSC queue..." << std::endl;
+    
+    struct Item : zjpdns::MpscNode {
+        int producer;
+        int sequence;
+    };
+    
+    // 单线程：先进先出，空队列返回nullptr
+    zjpdns::MpscQueue queue;
+    assert(queue.pop() == nullptr);
+    Item items[3];
+    for (int i = 0; i < 3; ++i) {
+        items[i].sequence = i;
+        queue.push(&items[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        assert(static_cast<Item*>(queue.pop())->sequence == i);
+    }
+    assert(queue.pop() == nullptr);
+    queue.push(&items[0]);
+    assert(queue.pop() == &items[0] && queue.pop() == nullptr);
+    
+    // 多个生产者同时入队：不丢失、不重复，每个生产者的节点保持入队顺序
+    const int producers = 8;
+    const int per_producer = 20000;
+    std::vector<Item> nodes(producers * per_producer);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &nodes, p]() {
+            for (int i = 0; i < per_producer; ++i) {
+                Item& item = nodes[p * per_producer + i];
+                item.producer = p;
+                item.sequence = i;
+                queue.push(&item);
+            }
+        });
+    }
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    while (received < producers * per_producer) {
+        Item* item = static_cast<Item*>(queue.pop());
+        if (item == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        assert(item->sequence == next[item->producer]);
+        ++next[item->producer];
+        ++received;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(queue.pop() == nullptr);
+    
+    // 多个线程同时向解析器提交任务，全部完成且队列归零
+    zjpdns::AsyncDnsResolverImpl resolver(4);
+    resolver.start();
+    std::atomic<int> completed{0};
+    threads.clear();
+    for (int p = 0; p < 16; ++p) {
+        threads.emplace_back([&resolver, &completed, p]() {
+            for (int i = 0; i < 2000; ++i) {
+                resolver.resolveWithCallback("bad..test", [&completed](const DnsResult&) { ++completed; },
+                                             DnsRecordType::A, ResolveMethod::DNS_PACKET,
+                                             i % 4 == 0 ? TaskPriority::BULK : TaskPriority::INTERACTIVE);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    while (completed < 16 * 2000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    zjpdns::MetricsSnapshot metrics = resolver.metrics()->snapshot();
+    assert(metrics.rejected == 0 && metrics.queue_depth == 0 && metrics.queue_wait.count == 16 * 2000);
+    
+    std::cout << "MPSC queue test passed!" << std::endl;
+}
+
+void testQueryCoalescing() {
+    std::cout << "test query coalescing..." << std::endl;
+    
+    LocalResponder responder;
+    responder.setSlowDelay(200);
+    auto async_resolver = zjpdns::createAsyncDnsResolver(4);
+    async_resolver->setDnsServer("127.0.0.1", responder.port());
+    async_resolver->setTimeout(2000);
+    async_resolver->setCacheSize(0);
+    
+    // 同一查询在途时，后来的请求共享同一个响应
+    std::atomic<int> callbacks{0};
+    std::vector<std::future<zjpdns::DnsResult>> futures;
+    for (int i = 0; i < 100; ++i) {
+        if (i % 2 == 0) {
+            futures.push_back(async_resolver->resolveAsync("slow-herd.test", DnsRecordType::A,
+                                                           ResolveMethod::DNS_PACKET));
+        } else {
+            async_resolver->resolveWithCallback(i % 4 == 1 ? "SLOW-HERD.test" : "slow-herd.test",
+                [&callbacks](const zjpdns::DnsResult& result) {
+                    if (result.success) ++callbacks;
+                },
+                DnsRecordType::A, ResolveMethod::DNS_PACKET);
+        }
+    }
+    for (auto& future : futures) {
+        assert(future.get().success);
+    }
+    for (int i = 0; i < 50 && callbacks < 50; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    assert(callbacks == 50);
+    assert(responder.queries() == 1);
+    
+    // 不同类型不合并，完成后的新查询重新发送
+    auto a = async_resolver->resolveAsync("slow-herd.test", DnsRecordType::A, ResolveMethod::DNS_PACKET);
+    auto mx = async_resolver->resolveAsync("slow-herd.test", DnsRecordType::MX, ResolveMethod::DNS_PACKET);
+    a.get();
+    mx.get();
+    assert(responder.queries() == 3);
+    
+    std::cout << "query coalescing test passed!" << std::endl;
+}
+
+// 构造以太网/IP/UDP帧（校验和不填）
+static std::vector<uint8_t> buildUdpFrame(const std::vector<uint8_t>& payload, uint16_t sport,
+                                          uint16_t dport, bool ipv6, bool vlan = false) {
+    std::vector<uint8_t> frame(12, 0);
+    if (vlan) {
+        frame.insert(frame.end(), {0x81, 0x00, 0x00, 0x64});
+    }
+    frame.insert(frame.end(), {static_cast<uint8_t>(ipv6 ? 0x86 : 0x08), static_cast<uint8_t>(ipv6 ? 0xDD : 0x00)});
+    
+    size_t udp_length = 8 + payload.size();
+    if (ipv6) {
+        uint8_t header[40] = {0x60};
+        header[4] = static_cast<uint8_t>(udp_length >> 8);
+        header[5] = static_cast<uint8_t>(udp_length & 0xFF);
+        header[6] = 17;
+        header[7] = 64;
+        frame.insert(frame.end(), header, header + 40);
+    } else {
+        uint8_t header[20] = {0x45};
+        header[2] = static_cast<uint8_t>((20 + udp_length) >> 8);
+        header[3] = static_cast<uint8_t>((20 + udp_length) & 0xFF);
+        header[8] = 64;
+        header[9] = 17;
+        frame.insert(frame.end(), header, header + 20);
+    }
+    
+    frame.insert(frame.end(), {static_cast<uint8_t>(sport >> 8), static_cast<uint8_t>(sport & 0xFF),
+                               static_cast<uint8_t>(dport >> 8), static_cast<uint8_t>(dport & 0xFF),
+                               static_cast<uint8_t>(udp_length >> 8), static_cast<uint8_t>(udp_length & 0xFF),
+                               0, 0});
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return frame;
+}
+
+static void append32le(std::vector<uint8_t>& data, uint32_t value) {
+    for (int i = 0; i < 4; ++i) data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+void testCaptureReader() {
+    std::cout << "test capture reader..." << std::endl;
+    
+    std::vector<std::vector<uint8_t>> messages;
+    for (int i = 0; i < 100; ++i) {
+        messages.push_back(DnsPacketBuilder::buildQueryPacket("cap" + std::to_string(i) + ".example.com",
+                                                              DnsRecordType::A, DnsRecordClass::IN,
+                                                              static_cast<uint16_t>(i + 1)));
+    }
+    
+    // pcap：IPv4/IPv6/VLAN混合，另有非53端口帧
+    std::vector<uint8_t> pcap;
+    append32le(pcap, 0xA1B2C3D4);
+    pcap.insert(pcap.end(), {2, 0, 4, 0});
+    append32le(pcap, 0);
+    append32le(pcap, 0);
+    append32le(pcap, 65535);
+    append32le(pcap, 1);
+    for (size_t i = 0; i < messages.size(); ++i) {
+        std::vector<uint8_t> frame = buildUdpFrame(messages[i], 40000 + i, 53, i % 3 == 1, i % 5 == 0);
+        append32le(pcap, static_cast<uint32_t>(i));
+        append32le(pcap, 0);
+        append32le(pcap, static_cast<uint32_t>(frame.size()));
+        append32le(pcap, static_cast<uint32_t>(frame.size()));
+        pcap.insert(pcap.end(), frame.begin(), frame.end());
+        
+        if (i % 10 == 0) {
+            std::vector<uint8_t> other = buildUdpFrame(messages[i], 40000, 5353, false);
+            append32le(pcap, 0);
+            append32le(pcap, 0);
+            append32le(pcap, static_cast<uint32_t>(other.size()));
+            append32le(pcap, static_cast<uint32_t>(other.size()));
+            pcap.insert(pcap.end(), other.begin(), other.end());
+        }
+    }
+    std::string pcap_path = "/tmp/zjpdns_test_" + std::to_string(getpid()) + ".pcap";
+    writeFile(pcap_path, pcap);
+    
+    DnsCaptureReader reader;
+    assert(reader.open(pcap_path));
+    assert(reader.format() == DnsCaptureReader::Format::PCAP);
+    
+    size_t index = 0;
+    bool matched = true;
+    DnsCaptureStats stats = reader.read([&](const uint8_t* data, size_t length) {
+        const auto& expected = messages[index++];
+        matched = matched && length == expected.size() && memcmp(data, expected.data(), length) == 0;
+    });
+    assert(matched);
+    assert(stats.frames == 110);
+    assert(stats.payloads == 100);
+    assert(stats.skipped == 10);
+    
+    // 多线程切分结果与顺序读取一致
+    std::vector<std::atomic<int>> seen(messages.size());
+    stats = reader.readParallel(3, [&](size_t worker, const uint8_t* data, size_t length) {
+        assert(worker < 3);
+        DnsPacketView view(data, length);
+        assert(view.valid());
+        ++seen[view.id() - 1];
+    });
+    assert(stats.payloads == 100);
+    for (auto& count : seen) {
+        assert(count == 1);
+    }
+    
+    // 端口为0时提取所有UDP负载
+    reader.setPort(0);
+    assert(reader.read([](const uint8_t*, size_t) {}).payloads == 110);
+    
+    // pcapng：段头、接口描述、增强分组和简单分组块
+    std::vector<uint8_t> pcapng;
+    append32le(pcapng, 0x0A0D0D0A);
+    append32le(pcapng, 28);
+    append32le(pcapng, 0x1A2B3C4D);
+    pcapng.insert(pcapng.end(), {1, 0, 0, 0});
+    append32le(pcapng, 0xFFFFFFFF);
+    append32le(pcapng, 0xFFFFFFFF);
+    append32le(pcapng, 28);
+    append32le(pcapng, 1);
+    append32le(pcapng, 20);
+    pcapng.insert(pcapng.end(), {1, 0, 0, 0});
+    append32le(pcapng, 65535);
+    append32le(pcapng, 20);
+    for (size_t i = 0; i < messages.size(); ++i) {
+        std::vector<uint8_t> frame = buildUdpFrame(messages[i], 53, 40000, i % 2 == 0);
+        size_t padded = (frame.size() + 3) & ~static_cast<size_t>(3);
+        bool simple = i % 4 == 3;
+        uint32_t total = static_cast<uint32_t>((simple ? 16 : 32) + padded);
+        append32le(pcapng, simple ? 3 : 6);
+        append32le(pcapng, total);
+        if (!simple) {
+            append32le(pcapng, 0);
+            append32le(pcapng, 0);
+            append32le(pcapng, static_cast<uint32_t>(i));
+            append32le(pcapng, static_cast<uint32_t>(frame.size()));
+        }
+        append32le(pcapng, static_cast<uint32_t>(frame.size()));
+        pcapng.insert(pcapng.end(), frame.begin(), frame.end());
+        pcapng.resize(pcapng.size() + padded - frame.size(), 0);
+        append32le(pcapng, total);
+    }
+    std::string pcapng_path = pcap_path + "ng";
+    writeFile(pcapng_path, pcapng);
+    
+    assert(reader.open(pcapng_path));
+    assert(reader.format() == DnsCaptureReader::Format::PCAPNG);
+    stats = reader.readParallel(4, [&](size_t, const uint8_t* data, size_t length) {
+        DnsPacketView view(data, length);
+        assert(view.valid());
+        assert(length == messages[view.id() - 1].size());
+    });
+    assert(stats.frames == 100);
+    assert(stats.payloads == 100);
+    
+    // 长度前缀的原始转储
+    std::vector<uint8_t> raw;
+    for (const auto& message : messages) {
+        raw.push_back(static_cast<uint8_t>(message.size() >> 8));
+        raw.push_back(static_cast<uint8_t>(message.size() & 0xFF));
+        raw.insert(raw.end(), message.begin(), message.end());
+    }
+    std::string raw_path = pcap_path + ".raw";
+    writeFile(raw_path, raw);
+    
+    assert(reader.open(raw_path));
+    assert(reader.format() == DnsCaptureReader::Format::RAW);
+    stats = reader.read([](const uint8_t*, size_t) {});
+    assert(stats.payloads == 100);
+    
+    assert(!reader.open(pcap_path + ".missing"));
+    assert(!reader.error().empty());
+    
+    std::remove(pcap_path.c_str());
+    std::remove(pcapng_path.c_str());
+    std::remove(raw_path.c_str());
+    
+    std::cout << "capture reader test passed!" << std::endl;
+}
+
 void testDnsResolver() {
     std::cout << "test DNS resolver..." << std::endl;
     
@@ -35,7 +1752,7 @@ void testDnsResolver() {
     resolver->setDnsServer("8.8.8.8", 53);
     resolver->setTimeout(5000);
     
-    // 测试gethostbyname方式
+    // 测试系统解析方式
     auto result1 = resolver->resolve("www.google.com", 
                                    zjpdns::DnsRecordType::A,
                                    zjpdns::ResolveMethod::GETHOSTBYNAME);
@@ -169,6 +1886,30 @@ int main() {
     
     try {
         testDnsPacketBuilder();
+        testDnsPacketView();
+        testSimdDomainScan();
+        testNameCompression();
+        testQueryIntoBuffer();
+        testTypedRdata();
+        testEdns();
+        testPmrParse();
+        testDnsCache();
+        testNegativeCache();
+        testPacketSenderPool();
+        testAsyncEventLoop();
+        testWorkStealingExecutor();
+        testMultiThreadAsyncResolver();
+        testBatchResolve();
+        testQueryCoalescing();
+        testTcpFallback();
+        testUpstreamSelection();
+        testRetryPolicy();
+        testDualStack();
+        testSystemResolver();
+        testMetrics();
+        testTaskQueue();
+        testMpscQueue();
+        testCaptureReader();
         testDnsResolver();
         testAsyncDnsResolver();
         testCustomPacket();
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+
+// 本地UDP应答器（测试用）：对每个查询返回一条指向127.0.0.1的A记录
+// 以"slow"开头的域名延迟应答，以"drop"开头的域名不应答，以"lose"开头的域名丢弃第一次查询（模拟丢包）
+// AAAA查询返回::1，以"lag6"开头的域名的AAAA应答延迟（与slow相同的延迟），用于验证双栈解析的宽限期
+// 查询带OPT记录时应答也附加OPT记录；以"noedns"开头的域名模拟不支持EDNS的服务器，对带OPT的查询返回FORMERR
+// 同一端口上监听TCP：以"big"开头的域名在UDP上返回截断（TC）的空应答，在TCP上返回DNS_TEST_BIG_ANSWERS条A记录；
+// 一次读取到的多个TCP查询按相反顺序应答，用于验证乱序匹配
+#define DNS_TEST_BIG_ANSWERS 40
+
+class LocalResponder {
+public:
+    explicit LocalResponder(uint32_t ttl = 300) : ttl_(ttl), running_(false), queries_(0), port_(0) {
+        sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        int rcvbuf = 4 << 20;
+        setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(sockfd_, (struct sockaddr*)&addr, sizeof(addr));
+
+        socklen_t len = sizeof(addr);
+        getsockname(sockfd_, (struct sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+
+        listenfd_ = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        setsockopt(listenfd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        bind(listenfd_, (struct sockaddr*)&addr, sizeof(addr));
+        listen(listenfd_, 16);
+
+        running_ = true;
+        thread_ = std::thread(&LocalResponder::run, this);
+    }
+
+    ~LocalResponder() {
+        running_ = false;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        close(sockfd_);
+        close(listenfd_);
+        for (auto& client : clients_) {
+            close(client.fd);
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    int queries() const { return queries_; }
+    int tcpConnections() const { return tcp_connections_; }
+    int tcpQueries() const { return tcp_queries_; }
+
+    // 以"lose"开头的域名收到的每个查询的(事务ID, 源端口)
+    std::vector<std::pair<uint16_t, uint16_t>> lossQueries() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return loss_queries_;
+    }
+
+    // 关闭所有TCP客户端连接（模拟服务器关闭空闲连接）
+    void closeTcpClients() {
+        close_clients_ = true;
+        while (close_clients_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // 设置慢速域名的应答延迟
+    void setSlowDelay(int delay_ms) { slow_delay_ms_ = delay_ms; }
+
+    // 所有UDP应答都延迟delay_ms（模拟慢速上游），0表示不延迟
+    void setDelay(int delay_ms) { delay_ms_ = delay_ms; }
+
+private:
+    uint32_t ttl_;
+    std::atomic<bool> running_;
+    std::atomic<int> queries_;
+    uint16_t port_;
+    int sockfd_;
+    int listenfd_;
+    std::atomic<int> slow_delay_ms_{300};
+    std::atomic<int> delay_ms_{0};
+    std::atomic<int> tcp_connections_{0};
+    std::atomic<int> tcp_queries_{0};
+    std::atomic<bool> close_clients_{false};
+    std::thread thread_;
+    std::set<std::string> lost_;                                // 已丢弃过第一次查询的域名
+    std::vector<std::pair<uint16_t, uint16_t>> loss_queries_;
+    std::mutex mutex_;
+
+    struct Client {
+        int fd;
+        std::vector<uint8_t> stream;
+    };
+    std::vector<Client> clients_;
+
+    struct Delayed {
+        std::chrono::steady_clock::time_point due;
+        struct sockaddr_in to;
+        std::vector<uint8_t> response;
+    };
+    std::vector<Delayed> delayed_;
+
+    void run() {
+        std::vector<uint8_t> buffer(4096);
+        while (running_) {
+            flushDelayed();
+
+            if (close_clients_) {
+                for (auto& client : clients_) {
+                    close(client.fd);
+                }
+                clients_.clear();
+                close_clients_ = false;
+            }
+
+            std::vector<struct pollfd> pfds(2 + clients_.size());
+            pfds[0].fd = sockfd_;
+            pfds[1].fd = listenfd_;
+            for (size_t i = 0; i < clients_.size(); ++i) {
+                pfds[2 + i].fd = clients_[i].fd;
+            }
+            for (auto& pfd : pfds) {
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+            }
+            if (poll(pfds.data(), pfds.size(), delayed_.empty() ? 50 : 1) <= 0) continue;
+
+            if (pfds[1].revents & POLLIN) {
+                int fd = accept(listenfd_, nullptr, nullptr);
+                if (fd >= 0) {
+                    ++tcp_connections_;
+                    clients_.push_back(Client{fd, {}});
+                }
+            }
+            for (size_t i = clients_.size(); i-- > 0;) {
+                if (i + 2 < pfds.size() && pfds[2 + i].revents && !serveTcp(clients_[i])) {
+                    close(clients_[i].fd);
+                    clients_.erase(clients_.begin() + i);
+                }
+            }
+            if (!(pfds[0].revents & POLLIN)) continue;
+
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t received = recvfrom(sockfd_, buffer.data(), buffer.size(), 0,
+                                        (struct sockaddr*)&from, &from_len);
+            if (received < 13) continue;
+            ++queries_;
+
+            std::string first_label(reinterpret_cast<const char*>(&buffer[13]),
+                                    std::min<size_t>(buffer[12], received - 13));
+            if (first_label.compare(0, 4, "drop") == 0) continue;
+            if (first_label.compare(0, 4, "lose") == 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                loss_queries_.emplace_back(static_cast<uint16_t>((buffer[0] << 8) | buffer[1]), ntohs(from.sin_port));
+                if (lost_.insert(first_label).second) continue;
+            }
+
+            std::vector<uint8_t> response = buildResponse(buffer.data(), received);
+            bool lag = first_label.compare(0, 4, "lag6") == 0 && isAaaaQuery(buffer.data(), received);
+            int delay = first_label.compare(0, 4, "slow") == 0 || lag ? slow_delay_ms_.load() : delay_ms_.load();
+            if (delay > 0) {
+                delayed_.push_back(Delayed{std::chrono::steady_clock::now() + std::chrono::milliseconds(delay),
+                                           from, std::move(response)});
+                continue;
+            }
+            sendto(sockfd_, response.data(), response.size(), 0,
+                   (struct sockaddr*)&from, from_len);
+        }
+    }
+
+    void flushDelayed() {
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < delayed_.size();) {
+            if (delayed_[i].due > now) {
+                ++i;
+                continue;
+            }
+            sendto(sockfd_, delayed_[i].response.data(), delayed_[i].response.size(), 0,
+                   (struct sockaddr*)&delayed_[i].to, sizeof(delayed_[i].to));
+            delayed_.erase(delayed_.begin() + i);
+        }
+    }
+
+    // 读取TCP客户端的查询，应答按相反顺序发送，连接关闭时返回false
+    bool serveTcp(Client& client) {
+        uint8_t buffer[4096];
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        client.stream.insert(client.stream.end(), buffer, buffer + received);
+
+        std::vector<std::vector<uint8_t>> responses;
+        size_t offset = 0;
+        while (client.stream.size() - offset >= 2) {
+            size_t length = (client.stream[offset] << 8) | client.stream[offset + 1];
+            if (client.stream.size() - offset - 2 < length) break;
+            ++tcp_queries_;
+            responses.push_back(buildResponse(client.stream.data() + offset + 2, length, true));
+            offset += 2 + length;
+        }
+        client.stream.erase(client.stream.begin(), client.stream.begin() + offset);
+
+        std::vector<uint8_t> out;
+        for (auto it = responses.rbegin(); it != responses.rend(); ++it) {
+            out.push_back(static_cast<uint8_t>(it->size() >> 8));
+            out.push_back(static_cast<uint8_t>(it->size() & 0xFF));
+            out.insert(out.end(), it->begin(), it->end());
+        }
+        return out.empty() || send(client.fd, out.data(), out.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(out.size());
+    }
+
+    static bool isAaaaQuery(const uint8_t* query, size_t length) {
+        size_t offset = 12;
+        while (offset < length && query[offset] != 0) {
+            offset += query[offset] + 1;
+        }
+        return offset + 2 < length && query[offset + 1] == 0 && query[offset + 2] == 28;
+    }
+
+    std::vector<uint8_t> buildResponse(const uint8_t* query, size_t length, bool tcp = false) {
+        // 只保留头部和第一个问题
+        size_t offset = 12;
+        while (offset < length && query[offset] != 0) {
+            offset += query[offset] + 1;
+        }
+        offset = std::min(length, offset + 5);
+
+        bool edns = length >= 12 && (query[10] != 0 || query[11] != 0);
+        bool noedns = length > 19 && memcmp(query + 13, "noedns", 6) == 0;
+        bool big = length > 16 && memcmp(query + 13, "big", 3) == 0;
+
+        std::vector<uint8_t> response(query, query + offset);
+        response[2] = 0x81; // QR, RD
+        response[3] = 0x80; // RA
+        response[4] = 0; response[5] = 1;  // QDCOUNT
+        response[6] = 0; response[7] = 1;  // ANCOUNT
+        response[8] = response[9] = response[10] = response[11] = 0;
+
+        if (edns && noedns) {
+            response[3] = 0x81; // RA, FORMERR
+            response[7] = 0;
+            return response;
+        }
+        if (big && !tcp) {
+            response[2] |= 0x02; // TC
+            response[7] = 0;
+            return response;
+        }
+
+        const uint8_t answer[] = {
+            0xC0, 0x0C,                       // 指向问题中的域名
+            0x00, 0x01, 0x00, 0x01,           // A, IN
+            static_cast<uint8_t>(ttl_ >> 24), static_cast<uint8_t>(ttl_ >> 16),
+            static_cast<uint8_t>(ttl_ >> 8), static_cast<uint8_t>(ttl_),
+            0x00, 0x04, 127, 0, 0, 1
+        };
+        int answers = big ? DNS_TEST_BIG_ANSWERS : 1;
+        if (isAaaaQuery(query, length)) {
+            const uint8_t aaaa[] = {
+                0xC0, 0x0C, 0x00, 0x1C, 0x00, 0x01,   // AAAA, IN
+                static_cast<uint8_t>(ttl_ >> 24), static_cast<uint8_t>(ttl_ >> 16),
+                static_cast<uint8_t>(ttl_ >> 8), static_cast<uint8_t>(ttl_),
+                0x00, 0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
+            };
+            response.insert(response.end(), aaaa, aaaa + sizeof(aaaa));
+            answers = 1;
+        } else {
+            for (int i = 0; i < answers; ++i) {
+                response.insert(response.end(), answer, answer + sizeof(answer));
+                response.back() = static_cast<uint8_t>(i + 1);
+            }
+        }
+        response[6] = static_cast<uint8_t>(answers >> 8);
+        response[7] = static_cast<uint8_t>(answers & 0xFF);
+
+        if (edns) {
+            const uint8_t opt[] = {0x00, 0x00, 0x29, 0x04, 0xD0, 0, 0, 0, 0, 0x00, 0x00};
+            response[11] = 1;  // ARCOUNT
+            response.insert(response.end(), opt, opt + sizeof(opt));
+        }
+        return response;
+    }
+};